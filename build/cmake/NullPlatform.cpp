@@ -0,0 +1,245 @@
+#include "NullPlatform.h"
+#include <cstdarg>
+#include <cstdio>
+#include <graphics/sprite_renderer.h>
+#include <graphics/renderer_3d.h>
+#include <graphics/texture.h>
+#include <graphics/vertex_buffer.h>
+#include <graphics/index_buffer.h>
+#include <input/input_manager.h>
+#include <audio/audio_manager.h>
+#include <system/file.h>
+#include <system/debug_log.h>
+
+NullPlatform::NullPlatform(Int32 width, Int32 height, float frameTime) :
+	frameTime(frameTime)
+{
+	set_width(width);
+	set_height(height);
+}
+
+NullPlatform::~NullPlatform()
+{
+}
+
+bool NullPlatform::Update()
+{
+	return true;
+}
+
+float NullPlatform::GetFrameTime()
+{
+	return frameTime;
+}
+
+void NullPlatform::PreRender()
+{
+}
+
+void NullPlatform::PostRender()
+{
+}
+
+void NullPlatform::Clear() const
+{
+}
+
+//Run from media like the Windows build, so names are already relative to it
+std::string NullPlatform::FormatFilename(const std::string& filename) const
+{
+	return filename;
+}
+
+std::string NullPlatform::FormatFilename(const char* filename) const
+{
+	return std::string(filename);
+}
+
+gef::Matrix44 NullPlatform::PerspectiveProjectionFov(const float fov, const float aspect_ratio, const float near_distance, const float far_distance) const
+{
+	gef::Matrix44 projection;
+	projection.PerspectiveFovD3D(fov, aspect_ratio, near_distance, far_distance);
+	return projection;
+}
+
+gef::Matrix44 NullPlatform::PerspectiveProjectionFrustum(const float left, const float right, const float top, const float bottom, const float near_distance, const float far_distance) const
+{
+	gef::Matrix44 projection;
+	projection.PerspectiveFrustumD3D(left, right, top, bottom, near_distance, far_distance);
+	return projection;
+}
+
+gef::Matrix44 NullPlatform::OrthographicFrustum(const float left, const float right, const float top, const float bottom, const float near_distance, const float far_distance) const
+{
+	gef::Matrix44 projection;
+	projection.OrthographicFrustumD3D(left, right, top, bottom, near_distance, far_distance);
+	return projection;
+}
+
+//No shaders are ever compiled, nothing is drawn
+const char* NullPlatform::GetShaderDirectory() const
+{
+	return "shaders/null";
+}
+
+const char* NullPlatform::GetShaderFileExtension() const
+{
+	return "";
+}
+
+void NullPlatform::BeginScene() const
+{
+}
+
+void NullPlatform::EndScene() const
+{
+}
+
+//Keeps nothing, as nothing is drawn from them
+class NullVertexBuffer : public gef::VertexBuffer
+{
+public:
+	bool Init(const gef::Platform& platform, const void* vertices, const UInt32 num_vertices, const UInt32 vertex_byte_size, const bool read_only)
+	{
+		return true;
+	}
+	void Bind(const gef::Platform& platform) const
+	{
+	}
+	void Unbind(const gef::Platform& platform) const
+	{
+	}
+	void Update(const gef::Platform& platform)
+	{
+	}
+};
+
+class NullIndexBuffer : public gef::IndexBuffer
+{
+public:
+	bool Init(const gef::Platform& platform, const void* indices, const UInt32 num_indices, const UInt32 index_byte_size, const bool read_only)
+	{
+		return true;
+	}
+	void Bind(const gef::Platform& platform) const
+	{
+	}
+	void Unbind(const gef::Platform& platform) const
+	{
+	}
+	void Update(const gef::Platform& platform)
+	{
+	}
+};
+
+//Scenes, fonts and saves are still read from disk
+class StdioFile : public gef::File
+{
+public:
+	~StdioFile()
+	{
+		Close();
+	}
+	bool Open(const char* const filename)
+	{
+		Close();
+		file = fopen(filename, "rb");
+		return file != NULL;
+	}
+	bool Exists(const char* const filename)
+	{
+		FILE* existing = fopen(filename, "rb");
+		if (existing == NULL)
+			return false;
+		fclose(existing);
+		return true;
+	}
+	bool GetSize(Int32& size)
+	{
+		if (file == NULL)
+			return false;
+		long position = ftell(file);
+		fseek(file, 0, SEEK_END);
+		size = (Int32)ftell(file);
+		fseek(file, position, SEEK_SET);
+		return true;
+	}
+	bool Seek(const SeekFrom seek_from, Int32 offset)
+	{
+		if (file == NULL)
+			return false;
+		int origin = seek_from == SF_Start ? SEEK_SET : seek_from == SF_Current ? SEEK_CUR : SEEK_END;
+		return fseek(file, offset, origin) == 0;
+	}
+	bool Read(void* buffer, const Int32 size, Int32& bytes_read)
+	{
+		if (file == NULL)
+			return false;
+		bytes_read = (Int32)fread(buffer, 1, size, file);
+		return bytes_read == size;
+	}
+	bool Close()
+	{
+		if (file == NULL)
+			return false;
+		fclose(file);
+		file = NULL;
+		return true;
+	}
+private:
+	FILE* file = NULL;
+};
+
+namespace gef
+{
+	//The factories gef_d3d11 and gef_win32 define. SceneApp doesn't ask for the renderers, input or audio
+	//when it is headless, so those only answer NULL.
+	SpriteRenderer* SpriteRenderer::Create(Platform& platform)
+	{
+		return NULL;
+	}
+
+	Renderer3D* Renderer3D::Create(Platform& platform)
+	{
+		return NULL;
+	}
+
+	InputManager* InputManager::Create(Platform& platform)
+	{
+		return NULL;
+	}
+
+	AudioManager* AudioManager::Create()
+	{
+		return NULL;
+	}
+
+	//Sprites and materials take a NULL texture the same as one that failed to load
+	Texture* Texture::Create(const Platform& platform, const ImageData& image_data)
+	{
+		return NULL;
+	}
+
+	VertexBuffer* VertexBuffer::Create(Platform& platform)
+	{
+		return new NullVertexBuffer();
+	}
+
+	IndexBuffer* IndexBuffer::Create(Platform& platform)
+	{
+		return new NullIndexBuffer();
+	}
+
+	File* File::Create()
+	{
+		return new StdioFile();
+	}
+
+	void DebugOut(const char* text, ...)
+	{
+		va_list args;
+		va_start(args, text);
+		vprintf(text, args);
+		va_end(args);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <gef.h>
+#include <system/platform.h>
+#include <maths/matrix44.h>
+
+//A gef platform with no window, device or clock, for headless runs on Linux.
+//Built into gef in place of gef_d3d11 and gef_win32, so the framework's factories create nothing that draws, plays or reads devices, see NullPlatform.cpp.
+//Each Update is one fixed step, so a run plays the same however fast the machine is.
+class NullPlatform : public gef::Platform
+{
+public:
+	NullPlatform(Int32 width, Int32 height, float frameTime);
+	~NullPlatform();
+
+	bool Update();
+	float GetFrameTime();
+	void PreRender();
+	void PostRender();
+	void Clear() const;
+	std::string FormatFilename(const std::string& filename) const;
+	std::string FormatFilename(const char* filename) const;
+	//D3D style, so picking's near plane at 0 matches the Windows build
+	gef::Matrix44 PerspectiveProjectionFov(const float fov, const float aspect_ratio, const float near_distance, const float far_distance) const;
+	gef::Matrix44 PerspectiveProjectionFrustum(const float left, const float right, const float top, const float bottom, const float near_distance, const float far_distance) const;
+	gef::Matrix44 OrthographicFrustum(const float left, const float right, const float top, const float bottom, const float near_distance, const float far_distance) const;
+	const char* GetShaderDirectory() const;
+	const char* GetShaderFileExtension() const;
+	void BeginScene() const;
+	void EndScene() const;
+private:
+	float frameTime;
+};
@@ -0,0 +1,275 @@
+#include "AssetPack.h"
+#include "MemoryTracker.h"
+#include <system/debug_log.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+static const char packMagic[4] = { 'G', 'P', 'A', 'K' };
+static const unsigned int packVersion = 1;
+
+AssetPack& AssetPack::instance()
+{
+	static AssetPack pack;
+	return pack;
+}
+
+AssetPack::AssetPack()
+{
+	for (int group = 0; group < ASSET_GROUP_COUNT; group++)
+	{
+		groupOffsets[group] = 0;
+		groupSizes[group] = 0;
+		groupResident[group] = false;
+	}
+}
+
+AssetPack::~AssetPack()
+{
+	unmount();
+}
+
+bool AssetPack::build(const char* packFilename, const AssetPackSource* sources, unsigned int sourceCount)
+{
+	//Lay the data out group by group so each group is one contiguous range
+	std::vector<AssetPackSource> ordered(sources, sources + sourceCount);
+	std::stable_sort(ordered.begin(), ordered.end(), [](const AssetPackSource& a, const AssetPackSource& b) { return a.group < b.group; });
+
+	std::vector<std::vector<char> > contents(ordered.size());
+	std::vector<Entry> index(ordered.size());
+	unsigned long long offset = sizeof(Header) + sizeof(Entry) * ordered.size();
+
+	for (unsigned int i = 0; i < ordered.size(); i++)
+	{
+		FILE* source = fopen(ordered[i].filename, "rb");
+		if (!source)
+		{
+			gef::DebugOut("ERROR: Unable to open %s for the asset pack!\n", ordered[i].filename);
+			return false;
+		}
+		fseek(source, 0, SEEK_END);
+		long size = ftell(source);
+		fseek(source, 0, SEEK_SET);
+		contents[i].resize(size);
+		bool success = size == 0 || fread(&contents[i][0], 1, size, source) == (size_t)size;
+		fclose(source);
+		if (!success)
+		{
+			gef::DebugOut("ERROR: Unable to read %s for the asset pack!\n", ordered[i].filename);
+			return false;
+		}
+
+		index[i].nameHash = hashName(ordered[i].filename);
+		index[i].offset = offset;
+		index[i].size = size;
+		index[i].storedSize = size;
+		index[i].compression = ASSET_COMPRESSION_NONE;
+		index[i].group = ordered[i].group;
+		offset += size;
+	}
+
+	FILE* pack = fopen(packFilename, "wb");
+	if (!pack)
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(header.magic, packMagic, sizeof(header.magic));
+	header.version = packVersion;
+	header.entryCount = index.size();
+	header.reserved = 0;
+
+	//The index is stored sorted by hash so mounting doesn't need to sort it
+	std::vector<Entry> sortedIndex = index;
+	std::sort(sortedIndex.begin(), sortedIndex.end(), [](const Entry& a, const Entry& b) { return a.nameHash < b.nameHash; });
+
+	bool success = fwrite(&header, sizeof(header), 1, pack) == 1;
+	if (success && sortedIndex.empty() == false)
+	{
+		success = fwrite(&sortedIndex[0], sizeof(Entry), sortedIndex.size(), pack) == sortedIndex.size();
+	}
+	for (unsigned int i = 0; success && i < contents.size(); i++)
+	{
+		success = contents[i].empty() || fwrite(&contents[i][0], 1, contents[i].size(), pack) == contents[i].size();
+	}
+	fclose(pack);
+
+	return success;
+}
+
+bool AssetPack::mount(const char* packFilename)
+{
+	unmount();
+
+	file = fopen(packFilename, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	fileOpenCount++;
+
+	Header header;
+	bool success = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, packMagic, sizeof(header.magic)) == 0
+		&& header.version == packVersion;
+	readCount++;
+
+	if (success && header.entryCount > 0)
+	{
+		entries.resize(header.entryCount);
+		success = fread(&entries[0], sizeof(Entry), entries.size(), file) == entries.size();
+		readCount++;
+		bytesRead += sizeof(header) + sizeof(Entry) * entries.size();
+	}
+
+	if (!success)
+	{
+		gef::DebugOut("ERROR: %s is not a valid asset pack!\n", packFilename);
+		unmount();
+		return false;
+	}
+
+	//Work out the range each group covers, the builder wrote them contiguously
+	for (int group = 0; group < ASSET_GROUP_COUNT; group++)
+	{
+		unsigned long long start = 0, end = 0;
+		bool found = false;
+		for (unsigned int i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].group != (unsigned int)group)
+			{
+				continue;
+			}
+			if (!found || entries[i].offset < start)
+			{
+				start = entries[i].offset;
+			}
+			if (!found || entries[i].offset + entries[i].storedSize > end)
+			{
+				end = entries[i].offset + entries[i].storedSize;
+			}
+			found = true;
+		}
+		groupOffsets[group] = start;
+		groupSizes[group] = end - start;
+	}
+
+	return true;
+}
+
+void AssetPack::unmount()
+{
+	if (file)
+	{
+		fclose(file);
+		file = NULL;
+	}
+	entries.clear();
+	for (int group = 0; group < ASSET_GROUP_COUNT; group++)
+	{
+		evict((AssetGroup)group);
+		groupOffsets[group] = 0;
+		groupSizes[group] = 0;
+	}
+}
+
+bool AssetPack::isMounted()
+{
+	return file != NULL;
+}
+
+bool AssetPack::contains(const char* name)
+{
+	return findEntry(hashName(name)) != NULL;
+}
+
+void AssetPack::readahead(AssetGroup group)
+{
+	std::lock_guard<std::recursive_mutex> lock(groupLock);
+	if (!file || groupResident[group] || groupSizes[group] == 0)
+	{
+		return;
+	}
+
+	//Group data belongs to the pack, which decides when to evict it, rather than the state that read it
+	ScopedMemoryTag memoryTag(MEMORY_TAG_ASSETS);
+	ScopedLongLivedAllocations longLived;
+	groupData[group].resize((size_t)groupSizes[group]);
+	fseek(file, (long)groupOffsets[group], SEEK_SET);
+	if (fread(&groupData[group][0], 1, groupData[group].size(), file) != groupData[group].size())
+	{
+		gef::DebugOut("ERROR: Unable to read asset group %i from the pack!\n", group);
+		groupData[group].clear();
+		return;
+	}
+	readCount++;
+	bytesRead += groupData[group].size();
+	groupResident[group] = true;
+}
+
+void AssetPack::evict(AssetGroup group)
+{
+	std::lock_guard<std::recursive_mutex> lock(groupLock);
+	groupData[group].clear();
+	groupData[group].shrink_to_fit();
+	groupResident[group] = false;
+}
+
+bool AssetPack::find(const char* name, const char*& data, unsigned int& size)
+{
+	std::lock_guard<std::recursive_mutex> lock(groupLock);
+	const Entry* entry = findEntry(hashName(name));
+	if (!entry || entry->compression != ASSET_COMPRESSION_NONE)
+	{
+		return false;
+	}
+
+	AssetGroup group = (AssetGroup)entry->group;
+	readahead(group);
+	if (!groupResident[group])
+	{
+		return false;
+	}
+
+	data = &groupData[group][0] + (entry->offset - groupOffsets[group]);
+	size = entry->size;
+	return true;
+}
+
+unsigned int AssetPack::getFileOpenCount()
+{
+	return fileOpenCount;
+}
+
+unsigned int AssetPack::getReadCount()
+{
+	return readCount;
+}
+
+unsigned long long AssetPack::getBytesRead()
+{
+	return bytesRead;
+}
+
+//FNV-1a of the lower case name, Windows file names are case insensitive
+unsigned long long AssetPack::hashName(const char* name)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (const char* c = name; *c; c++)
+	{
+		hash ^= (unsigned char)tolower(*c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+const AssetPack::Entry* AssetPack::findEntry(unsigned long long nameHash)
+{
+	std::vector<Entry>::const_iterator found = std::lower_bound(entries.begin(), entries.end(), nameHash, [](const Entry& entry, unsigned long long hash) { return entry.nameHash < hash; });
+	if (found == entries.end() || found->nameHash != nameHash)
+	{
+		return NULL;
+	}
+	return &(*found);
+}
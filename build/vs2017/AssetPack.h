@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+//Which game state an asset is loaded by. Assets in the same group sit next to each other in the pack
+//so a state's assets can be pulled in with one read.
+enum AssetGroup
+{
+	ASSET_GROUP_SHARED,
+	ASSET_GROUP_SPLASH,
+	ASSET_GROUP_FRONTEND,
+	ASSET_GROUP_GAME,
+	ASSET_GROUP_STORE,
+	ASSET_GROUP_FAIL,
+	ASSET_GROUP_WIN,
+	ASSET_GROUP_COUNT
+};
+
+enum AssetCompression
+{
+	ASSET_COMPRESSION_NONE
+};
+
+struct AssetPackSource
+{
+	const char* filename;
+	AssetGroup group;
+};
+
+//Single file holding the game's assets behind a hashed index.
+//The file stays open while mounted and each group is read in one go, then served from memory.
+class AssetPack
+{
+public:
+	static AssetPack& instance();
+	AssetPack();
+	~AssetPack();
+	//Write every source file into one pack, grouped in the order of AssetGroup
+	static bool build(const char* packFilename, const AssetPackSource* sources, unsigned int sourceCount);
+	bool mount(const char* packFilename);
+	void unmount();
+	bool isMounted();
+	bool contains(const char* name);
+	//Read every asset in a group with a single read so later finds don't touch the disk
+	void readahead(AssetGroup group);
+	//Drop a group's data. Pointers returned by find for that group are no longer valid.
+	void evict(AssetGroup group);
+	//Point at an asset's bytes, reading its group first if needed
+	bool find(const char* name, const char*& data, unsigned int& size);
+	unsigned int getFileOpenCount();
+	unsigned int getReadCount();
+	unsigned long long getBytesRead();
+	static unsigned long long hashName(const char* name);
+private:
+	struct Entry
+	{
+		unsigned long long nameHash;
+		unsigned long long offset;
+		unsigned int size;
+		unsigned int storedSize;
+		unsigned int compression;
+		unsigned int group;
+	};
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int entryCount;
+		unsigned int reserved;
+	};
+	const Entry* findEntry(unsigned long long nameHash);
+	FILE* file = NULL;
+	//Sorted by name hash for binary search
+	std::vector<Entry> entries;
+	//Offset and length of each group's contiguous data
+	unsigned long long groupOffsets[ASSET_GROUP_COUNT];
+	unsigned long long groupSizes[ASSET_GROUP_COUNT];
+	std::vector<char> groupData[ASSET_GROUP_COUNT];
+	bool groupResident[ASSET_GROUP_COUNT];
+	//Textures are prefetched on worker threads, find calls readahead so the lock is recursive
+	std::recursive_mutex groupLock;
+	unsigned int fileOpenCount = 0;
+	unsigned int readCount = 0;
+	unsigned long long bytesRead = 0;
+};
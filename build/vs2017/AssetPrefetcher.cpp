@@ -0,0 +1,160 @@
+#include "AssetPrefetcher.h"
+#include <chrono>
+#include <cstdio>
+#include <graphics/image_data.h>
+#include <graphics/texture.h>
+#include <system/platform.h>
+#include "load_texture.h"
+#include "MemoryTracker.h"
+#include "StartupTrace.h"
+
+AssetPrefetcher& AssetPrefetcher::instance()
+{
+	static AssetPrefetcher prefetcher;
+	return prefetcher;
+}
+
+AssetPrefetcher::~AssetPrefetcher()
+{
+	wait();
+}
+
+void AssetPrefetcher::prefetchTexture(const char* png_filename, gef::Platform& platform)
+{
+	if (textures.find(png_filename) != textures.end())
+	{
+		return;
+	}
+
+	TextureEntry& entry = textures[png_filename];
+	entry.imageData = std::make_shared<gef::ImageData>();
+	std::shared_ptr<gef::ImageData> imageData = entry.imageData;
+	std::string filename(png_filename);
+	gef::Platform* platformPointer = &platform;
+	entry.loaded = std::async(std::launch::async, [imageData, filename, platformPointer]()
+	{
+		//Prefetched images can outlive the state that asked for them until discard
+		ScopedLongLivedAllocations longLived;
+		ScopedStartupSpan span("Decode texture");
+		return LoadImageDataFromPNG(filename.c_str(), *platformPointer, *imageData);
+	});
+	requestedCount++;
+}
+
+void AssetPrefetcher::prefetchFile(const char* filename)
+{
+	if (files.find(filename) != files.end())
+	{
+		return;
+	}
+
+	std::string name(filename);
+	files[name] = std::async(std::launch::async, [name]()
+	{
+		ScopedStartupSpan span("Read file");
+		FILE* file = fopen(name.c_str(), "rb");
+		if (file == NULL)
+			return;
+		char buffer[64 * 1024];
+		while (fread(buffer, 1, sizeof(buffer), file) == sizeof(buffer))
+		{
+		}
+		fclose(file);
+	});
+	requestedCount++;
+}
+
+bool AssetPrefetcher::createTexture(const char* png_filename, gef::Platform& platform, gef::Texture*& texture)
+{
+	std::map<std::string, TextureEntry>::iterator found = textures.find(png_filename);
+	if (found == textures.end())
+	{
+		return false;
+	}
+
+	TextureEntry& entry = found->second;
+	if (entry.loaded.valid())
+	{
+		if (entry.loaded.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			hitCount++;
+		}
+		else
+		{
+			lateCount++;
+		}
+		//A failed decode leaves the image empty and no texture is created
+		entry.loaded.get();
+	}
+	else
+	{
+		//Already created once this state, still counts as served from the prefetch
+		hitCount++;
+	}
+	entry.used = true;
+
+	texture = entry.imageData->image() != NULL ? gef::Texture::Create(platform, *entry.imageData) : NULL;
+	return true;
+}
+
+void AssetPrefetcher::wait()
+{
+	for (std::map<std::string, TextureEntry>::iterator it = textures.begin(); it != textures.end(); ++it)
+	{
+		if (it->second.loaded.valid())
+		{
+			it->second.loaded.wait();
+		}
+	}
+	for (std::map<std::string, std::future<void> >::iterator it = files.begin(); it != files.end(); ++it)
+	{
+		if (it->second.valid())
+		{
+			it->second.wait();
+		}
+	}
+}
+
+void AssetPrefetcher::discard()
+{
+	wait();
+	for (std::map<std::string, TextureEntry>::iterator it = textures.begin(); it != textures.end(); ++it)
+	{
+		if (it->second.used == false)
+		{
+			unusedCount++;
+		}
+	}
+	textures.clear();
+	files.clear();
+}
+
+unsigned int AssetPrefetcher::getRequestedCount()
+{
+	return requestedCount;
+}
+
+unsigned int AssetPrefetcher::getHitCount()
+{
+	return hitCount;
+}
+
+unsigned int AssetPrefetcher::getLateCount()
+{
+	return lateCount;
+}
+
+unsigned int AssetPrefetcher::getMissCount()
+{
+	return missCount;
+}
+
+unsigned int AssetPrefetcher::getUnusedCount()
+{
+	return unusedCount;
+}
+
+void AssetPrefetcher::recordMiss()
+{
+	missCount++;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gef
+{
+	class Platform;
+	class ImageData;
+	class Texture;
+}
+
+//Loads the assets a state is likely to need next on worker threads while the current state is still running.
+//PNGs are decoded to image data in the background. The texture itself is created on the main thread when
+//CreateTextureFromPNG asks for it. Other files, such as WAVs, are read once so the OS has them cached
+//when the audio manager opens them.
+class AssetPrefetcher
+{
+public:
+	static AssetPrefetcher& instance();
+	~AssetPrefetcher();
+	//Both ignore names that are already being prefetched
+	void prefetchTexture(const char* png_filename, gef::Platform& platform);
+	void prefetchFile(const char* filename);
+	//Create a texture from prefetched image data, waiting for the decode if it is still running.
+	//Returns false when the name was never prefetched. The data is kept so the same PNG can be created more than once.
+	bool createTexture(const char* png_filename, gef::Platform& platform, gef::Texture*& texture);
+	//Block until every background load has finished
+	void wait();
+	//Drop everything that was prefetched, counting what was never used
+	void discard();
+	unsigned int getRequestedCount();
+	unsigned int getHitCount();
+	unsigned int getLateCount();
+	unsigned int getMissCount();
+	unsigned int getUnusedCount();
+	//Count a texture load that had no prefetch behind it
+	void recordMiss();
+private:
+	struct TextureEntry
+	{
+		std::shared_ptr<gef::ImageData> imageData;
+		std::future<bool> loaded;
+		bool used = false;
+	};
+	std::map<std::string, TextureEntry> textures;
+	std::map<std::string, std::future<void> > files;
+	unsigned int requestedCount = 0;
+	//Hits were ready when asked for, late ones had to be waited on
+	unsigned int hitCount = 0;
+	unsigned int lateCount = 0;
+	unsigned int missCount = 0;
+	unsigned int unusedCount = 0;
+};
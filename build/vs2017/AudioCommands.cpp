@@ -0,0 +1,342 @@
+#include "AudioCommands.h"
+#include <chrono>
+#include <cstdio>
+#include <audio/audio_manager.h>
+#include <system/debug_log.h>
+#include "Metrics.h"
+#include "PerfRecorder.h"
+
+//Empty polls before the audio thread goes to sleep. A burst of posts is usually drained without it ever sleeping.
+static const unsigned int idleSpinLimit = 256;
+static const double latencyBounds[] = { 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 16.0 };
+
+void GefAudioBackend::setManager(gef::AudioManager* manager)
+{
+	audioManager = manager;
+}
+
+void GefAudioBackend::playSample(Int32 id, bool looping)
+{
+	audioManager->PlaySample(id, looping);
+}
+
+void GefAudioBackend::stopSampleVoice(Int32 id)
+{
+	audioManager->StopPlayingSampleVoice(id);
+}
+
+void GefAudioBackend::playMusic()
+{
+	audioManager->PlayMusic();
+}
+
+void GefAudioBackend::stopMusic()
+{
+	audioManager->StopMusic();
+}
+
+Int32 GefAudioBackend::loadSample(const char* filename, gef::Platform& platform)
+{
+	return audioManager->LoadSample(filename, platform);
+}
+
+Int32 GefAudioBackend::loadMusic(const char* filename, gef::Platform& platform)
+{
+	return audioManager->LoadMusic(filename, platform);
+}
+
+void GefAudioBackend::unloadSample(Int32 id)
+{
+	audioManager->UnloadSample(id);
+}
+
+void GefAudioBackend::unloadMusic()
+{
+	audioManager->UnloadMusic();
+}
+
+void GefAudioBackend::unloadAllSamples()
+{
+	audioManager->UnloadAllSamples();
+}
+
+void NullAudioBackend::playSample(Int32 id, bool looping)
+{
+	executedCount++;
+}
+
+void NullAudioBackend::stopSampleVoice(Int32 id)
+{
+	executedCount++;
+}
+
+void NullAudioBackend::playMusic()
+{
+	executedCount++;
+}
+
+void NullAudioBackend::stopMusic()
+{
+	executedCount++;
+}
+
+Int32 NullAudioBackend::loadSample(const char* filename, gef::Platform& platform)
+{
+	return sampleCount++;
+}
+
+Int32 NullAudioBackend::loadMusic(const char* filename, gef::Platform& platform)
+{
+	return 0;
+}
+
+//Only the newest sample gives its ID back, as the ones loaded before it keep theirs
+void NullAudioBackend::unloadSample(Int32 id)
+{
+	if (id == sampleCount - 1)
+	{
+		sampleCount--;
+	}
+}
+
+void NullAudioBackend::unloadMusic()
+{
+}
+
+void NullAudioBackend::unloadAllSamples()
+{
+	sampleCount = 0;
+}
+
+unsigned long long NullAudioBackend::getExecutedCount()
+{
+	return executedCount;
+}
+
+AudioCommandQueue::~AudioCommandQueue()
+{
+	stop();
+}
+
+void AudioCommandQueue::start(AudioBackend* newBackend)
+{
+	if (running)
+	{
+		return;
+	}
+
+	backend = newBackend;
+	latency = NanosecondHistogram();
+	postedCount = 0;
+	executedCount.store(0, std::memory_order_relaxed);
+	stallCount = 0;
+	stopping.store(false, std::memory_order_relaxed);
+	latencyMetric = &MetricsRegistry::instance().histogram("audio_command_latency_ms", "Time from posting an audio command to the audio thread playing it", latencyBounds, sizeof(latencyBounds) / sizeof(latencyBounds[0]));
+	running = true;
+	thread = std::thread(&AudioCommandQueue::run, this);
+}
+
+void AudioCommandQueue::stop()
+{
+	if (running == false)
+	{
+		return;
+	}
+
+	stopping.store(true, std::memory_order_seq_cst);
+	{
+		std::lock_guard<std::mutex> guard(wakeLock);
+		wake.notify_one();
+	}
+	thread.join();
+	running = false;
+}
+
+void AudioCommandQueue::playSample(Int32 id, bool looping)
+{
+	post(PlaySample, id, looping);
+}
+
+void AudioCommandQueue::stopSampleVoice(Int32 id)
+{
+	post(StopSampleVoice, id, false);
+}
+
+void AudioCommandQueue::playMusic()
+{
+	post(PlayMusic, 0, false);
+}
+
+void AudioCommandQueue::stopMusic()
+{
+	post(StopMusic, 0, false);
+}
+
+void AudioCommandQueue::flush()
+{
+	while (running && executedCount.load(std::memory_order_acquire) != postedCount)
+	{
+		std::this_thread::yield();
+	}
+}
+
+const NanosecondHistogram& AudioCommandQueue::getLatency()
+{
+	return latency;
+}
+
+unsigned long long AudioCommandQueue::getPostedCount()
+{
+	return postedCount;
+}
+
+unsigned long long AudioCommandQueue::getStallCount()
+{
+	return stallCount;
+}
+
+unsigned long long AudioCommandQueue::nowNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AudioCommandQueue::post(CommandType type, Int32 id, bool looping)
+{
+	if (running == false)
+	{
+		return;
+	}
+
+	Command command;
+	command.type = type;
+	command.id = id;
+	command.looping = looping;
+	command.postNanoseconds = nowNanoseconds();
+	if (ring.push(command) == false)
+	{
+		stallCount++;
+		while (ring.push(command) == false)
+		{
+			std::this_thread::yield();
+		}
+	}
+	postedCount++;
+
+	//Pairs with the fence in run, so either this sees the audio thread asleep or it sees this command before sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> guard(wakeLock);
+		wake.notify_one();
+	}
+}
+
+void AudioCommandQueue::run()
+{
+	Command command;
+	unsigned int idleSpins = 0;
+	while (true)
+	{
+		if (ring.pop(command))
+		{
+			execute(command);
+			idleSpins = 0;
+			continue;
+		}
+
+		//Everything posted before stop has been executed by now
+		if (stopping.load(std::memory_order_acquire))
+		{
+			if (ring.empty())
+				break;
+			continue;
+		}
+
+		if (++idleSpins < idleSpinLimit)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(wakeLock);
+		sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (ring.empty() && stopping.load(std::memory_order_relaxed) == false)
+		{
+			wake.wait(guard);
+		}
+		sleeping.store(false, std::memory_order_relaxed);
+		idleSpins = 0;
+	}
+}
+
+void AudioCommandQueue::execute(const Command& command)
+{
+	switch (command.type)
+	{
+	case PlaySample:
+		backend->playSample(command.id, command.looping);
+		break;
+	case StopSampleVoice:
+		backend->stopSampleVoice(command.id);
+		break;
+	case PlayMusic:
+		backend->playMusic();
+		break;
+	case StopMusic:
+		backend->stopMusic();
+		break;
+	}
+
+	unsigned long long now = nowNanoseconds();
+	unsigned long long waited = now > command.postNanoseconds ? now - command.postNanoseconds : 0;
+	latency.add(waited);
+	latencyMetric->observe(waited / 1000000.0);
+	executedCount.store(executedCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool RunCommandRingStress(unsigned long long commandCount, const char* outputFilename)
+{
+	NullAudioBackend backend;
+	AudioCommandQueue queue;
+	queue.start(&backend);
+
+	double startTime = PerfRecorder::nowMilliseconds();
+	//The same mix the game posts, mostly gunshots
+	for (unsigned long long i = 0; i < commandCount; i++)
+	{
+		switch (i & 7)
+		{
+		case 6:
+			queue.stopSampleVoice((Int32)(i & 15));
+			break;
+		case 7:
+			queue.playMusic();
+			break;
+		default:
+			queue.playSample((Int32)(i & 15), false);
+			break;
+		}
+	}
+	double postedTime = PerfRecorder::nowMilliseconds() - startTime;
+	queue.stop();
+	double elapsed = PerfRecorder::nowMilliseconds() - startTime;
+
+	const NanosecondHistogram& latency = queue.getLatency();
+	bool complete = backend.getExecutedCount() == commandCount && latency.count == commandCount;
+	gef::DebugOut("CommandRing: %llu commands in %.1f ms, %.0f per second, latency p50 %llu ns p99 %llu ns max %llu ns, %llu stalls%s\n",
+		commandCount, elapsed, commandCount * 1000.0 / elapsed, latency.percentile(0.5), latency.percentile(0.99), latency.maxNanoseconds, queue.getStallCount(), complete ? "" : ", commands were lost");
+
+	FILE* file = fopen(outputFilename, "w");
+	if (file == NULL)
+	{
+		gef::DebugOut("CommandRing: Could not write %s\n", outputFilename);
+		return false;
+	}
+	fprintf(file, "{\n  \"commands\": %llu,\n  \"ring_size\": %u,\n  \"executed\": %llu,\n  \"post_ms\": %.3f,\n  \"wall_ms\": %.3f,\n  \"posts_per_second\": %.1f,\n  \"commands_per_second\": %.1f,\n"
+		"  \"stalls\": %llu,\n  \"latency_ns_p50\": %llu,\n  \"latency_ns_p99\": %llu,\n  \"latency_ns_p999\": %llu,\n  \"latency_ns_max\": %llu\n}\n",
+		commandCount, AudioCommandQueue::ringSize, backend.getExecutedCount(), postedTime, elapsed, commandCount * 1000.0 / postedTime, commandCount * 1000.0 / elapsed,
+		queue.getStallCount(), latency.percentile(0.5), latency.percentile(0.99), latency.percentile(0.999), latency.maxNanoseconds);
+	fclose(file);
+	return complete;
+}
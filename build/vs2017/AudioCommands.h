@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <gef.h>
+#include "NanosecondHistogram.h"
+#include "SPSCRing.h"
+
+namespace gef
+{
+	class AudioManager;
+	class Platform;
+}
+
+class MetricHistogram;
+
+//What the audio thread plays commands on
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() {}
+	virtual void playSample(Int32 id, bool looping) = 0;
+	virtual void stopSampleVoice(Int32 id) = 0;
+	virtual void playMusic() = 0;
+	virtual void stopMusic() = 0;
+
+	//Made directly on the game thread once the queue has been flushed, never by the audio thread
+	virtual Int32 loadSample(const char* filename, gef::Platform& platform) = 0;
+	virtual Int32 loadMusic(const char* filename, gef::Platform& platform) = 0;
+	virtual void unloadSample(Int32 id) = 0;
+	virtual void unloadMusic() = 0;
+	virtual void unloadAllSamples() = 0;
+};
+
+class GefAudioBackend : public AudioBackend
+{
+public:
+	void setManager(gef::AudioManager* manager);
+	void playSample(Int32 id, bool looping);
+	void stopSampleVoice(Int32 id);
+	void playMusic();
+	void stopMusic();
+	Int32 loadSample(const char* filename, gef::Platform& platform);
+	Int32 loadMusic(const char* filename, gef::Platform& platform);
+	void unloadSample(Int32 id);
+	void unloadMusic();
+	void unloadAllSamples();
+private:
+	gef::AudioManager* audioManager = NULL;
+};
+
+//Plays nothing and only counts, so the queue itself can be measured and headless runs need no audio device.
+//Loads hand out sample IDs in order the way gef's manager does.
+class NullAudioBackend : public AudioBackend
+{
+public:
+	void playSample(Int32 id, bool looping);
+	void stopSampleVoice(Int32 id);
+	void playMusic();
+	void stopMusic();
+	Int32 loadSample(const char* filename, gef::Platform& platform);
+	Int32 loadMusic(const char* filename, gef::Platform& platform);
+	void unloadSample(Int32 id);
+	void unloadMusic();
+	void unloadAllSamples();
+	unsigned long long getExecutedCount();
+private:
+	unsigned long long executedCount = 0;
+	Int32 sampleCount = 0;
+};
+
+//The game thread posts play and stop commands and an audio thread drains them into the backend, so the game never waits on the audio API.
+//Only one thread may post. Loading and unloading stays on the game thread: call flush first so the audio thread isn't using the manager.
+class AudioCommandQueue
+{
+public:
+	static const unsigned int ringSize = 1024;
+
+	~AudioCommandQueue();
+	void start(AudioBackend* backend);
+	//Executes whatever is still queued and joins the audio thread. Commands posted while stopped are dropped.
+	void stop();
+
+	void playSample(Int32 id, bool looping = false);
+	void stopSampleVoice(Int32 id);
+	void playMusic();
+	void stopMusic();
+	//Wait until every posted command has been executed
+	void flush();
+
+	//Post to execute times, only safe to read once stopped
+	const NanosecondHistogram& getLatency();
+	unsigned long long getPostedCount();
+	//Posts that found the ring full and had to wait for the audio thread
+	unsigned long long getStallCount();
+private:
+	enum CommandType
+	{
+		PlaySample,
+		StopSampleVoice,
+		PlayMusic,
+		StopMusic
+	};
+	struct Command
+	{
+		CommandType type;
+		Int32 id;
+		bool looping;
+		unsigned long long postNanoseconds;
+	};
+
+	void post(CommandType type, Int32 id, bool looping);
+	void run();
+	void execute(const Command& command);
+	static unsigned long long nowNanoseconds();
+
+	SPSCRing<Command, ringSize> ring;
+	AudioBackend* backend = NULL;
+	std::thread thread;
+	bool running = false;
+	std::atomic<bool> stopping{ false };
+	//Set while the audio thread waits on wake, so posts only take the lock when it is asleep
+	std::atomic<bool> sleeping{ false };
+	std::mutex wakeLock;
+	std::condition_variable wake;
+	unsigned long long postedCount = 0;
+	std::atomic<unsigned long long> executedCount{ 0 };
+	unsigned long long stallCount = 0;
+	NanosecondHistogram latency;
+	MetricHistogram* latencyMetric = NULL;
+};
+
+//Posts commandCount commands through an AudioCommandQueue into a NullAudioBackend as fast as one thread can
+//and writes the throughput and post to execute latency to JSON
+bool RunCommandRingStress(unsigned long long commandCount, const char* outputFilename);
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <box2d/Box2D.h>
+#include <game_object.h>
+#include "PlayerObject.h"
+#include "EnemyObject.h"
+#include "WallObject.h"
+
+//The class each OBJECT_TYPE is stored as in a body's user data
+template<OBJECT_TYPE type> struct ObjectClass { typedef GameObject Type; };
+template<> struct ObjectClass<PLAYER> { typedef PlayerObject Type; };
+template<> struct ObjectClass<ENEMY> { typedef EnemyObject Type; };
+template<> struct ObjectClass<WALL> { typedef WallObject Type; };
+
+//Call the handler's overload for (A, B), or for (B, A) with the arguments swapped, or do nothing if it has neither
+template<class Handler, class A, class B>
+inline auto CallContactHandler(Handler& handler, A* a, b2Body* bodyA, B* b, b2Body* bodyB, int) -> decltype(handler(*a, bodyA, *b, bodyB), void())
+{
+	handler(*a, bodyA, *b, bodyB);
+}
+
+template<class Handler, class A, class B>
+inline auto CallContactHandler(Handler& handler, A* a, b2Body* bodyA, B* b, b2Body* bodyB, long) -> decltype(handler(*b, bodyB, *a, bodyA), void())
+{
+	handler(*b, bodyB, *a, bodyA);
+}
+
+template<class Handler, class A, class B>
+inline void CallContactHandler(Handler&, A*, b2Body*, B*, b2Body*, ...)
+{
+}
+
+template<class Handler, OBJECT_TYPE typeA, OBJECT_TYPE typeB>
+struct ContactPair
+{
+	typedef typename ObjectClass<typeA>::Type ClassA;
+	typedef typename ObjectClass<typeB>::Type ClassB;
+
+	static void dispatch(Handler& handler, GameObject* a, b2Body* bodyA, GameObject* b, b2Body* bodyB)
+	{
+		CallContactHandler(handler, static_cast<ClassA*>(a), bodyA, static_cast<ClassB*>(b), bodyB, 0);
+	}
+};
+
+template<class Handler, class Sequence>
+struct ContactTable;
+
+//One entry per pair of object types, filled in at compile time
+template<class Handler, size_t... pair>
+struct ContactTable<Handler, std::index_sequence<pair...> >
+{
+	typedef void (*Entry)(Handler&, GameObject*, b2Body*, GameObject*, b2Body*);
+	static const Entry entries[sizeof...(pair)];
+};
+
+template<class Handler, size_t... pair>
+const typename ContactTable<Handler, std::index_sequence<pair...> >::Entry ContactTable<Handler, std::index_sequence<pair...> >::entries[sizeof...(pair)] =
+{
+	&ContactPair<Handler, (OBJECT_TYPE)(pair / OBJECT_TYPE_COUNT), (OBJECT_TYPE)(pair % OBJECT_TYPE_COUNT)>::dispatch...
+};
+
+//Sends a contact to the handler overload for its two object types, already cast and in the order the overload takes them.
+//A handler is a class with operator()(X&, b2Body*, Y&, b2Body*) overloads for the pairs it cares about. Pairs it has no
+//overload for, in either order, do nothing. Finding the overload is one table lookup whatever the number of types.
+template<class Handler>
+class CollisionDispatcher
+{
+public:
+	static void dispatch(Handler& handler, b2Contact* contact)
+	{
+		b2Body* bodyA = contact->GetFixtureA()->GetBody();
+		b2Body* bodyB = contact->GetFixtureB()->GetBody();
+		GameObject* objectA = (GameObject*)bodyA->GetUserData();
+		GameObject* objectB = (GameObject*)bodyB->GetUserData();
+		if (objectA == NULL || objectB == NULL)
+		{
+			return;
+		}
+
+		Table::entries[objectA->type() * OBJECT_TYPE_COUNT + objectB->type()](handler, objectA, bodyA, objectB, bodyB);
+	}
+private:
+	typedef ContactTable<Handler, std::make_index_sequence<OBJECT_TYPE_COUNT * OBJECT_TYPE_COUNT> > Table;
+};
@@ -0,0 +1,522 @@
+#include "CompactAudio.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system/debug_log.h>
+#include "PerfRecorder.h"
+
+static const char compactAudioMagic[4] = { 'G', 'A', 'D', 'P' };
+static const UInt32 compactAudioVersion = 1;
+static const UInt32 compactAudioBlockFrames = 1024;
+//Each channel in a block starts with its predictor and step index
+static const UInt32 channelHeaderBytes = 4;
+static const unsigned int benchmarkIterations = 5;
+
+static const int indexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static const int stepTable[89] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+struct AdpcmState
+{
+	int predictor;
+	int stepIndex;
+};
+
+static UInt32 BlockBytes(UInt32 channels, UInt32 blockFrames)
+{
+	return channels * (channelHeaderBytes + blockFrames / 2);
+}
+
+//The header must describe exactly the blocks that follow it: frameCount has to end in the last block
+//and the payload has to be blockCount whole blocks. Sizes are worked out in 64 bits so no product can wrap.
+static bool ValidHeader(const CompactAudioHeader& header, unsigned long long payloadBytes)
+{
+	if (memcmp(header.magic, compactAudioMagic, sizeof(header.magic)) != 0
+		|| header.version != compactAudioVersion
+		|| (header.channels != 1 && header.channels != 2)
+		|| header.blockFrames == 0 || (header.blockFrames & 1) != 0)
+		return false;
+
+	unsigned long long blockFrames = header.blockFrames;
+	unsigned long long blockCount = header.blockCount;
+	unsigned long long frameCount = header.frameCount;
+	bool framesFit = blockCount == 0
+		? frameCount == 0
+		: frameCount <= blockCount * blockFrames && frameCount > (blockCount - 1) * blockFrames;
+	unsigned long long blockBytes = header.channels * (channelHeaderBytes + blockFrames / 2);
+	return framesFit
+		&& blockCount * blockBytes == payloadBytes
+		&& payloadBytes <= (unsigned long long)(size_t)-1
+		&& frameCount * header.channels <= (unsigned long long)(size_t)-1 / sizeof(Int16);
+}
+
+static int Clamp(int value, int low, int high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+static Int16 DecodeNibble(AdpcmState& state, int nibble)
+{
+	int step = stepTable[state.stepIndex];
+	int difference = step >> 3;
+	if (nibble & 4) difference += step;
+	if (nibble & 2) difference += step >> 1;
+	if (nibble & 1) difference += step >> 2;
+	if (nibble & 8) difference = -difference;
+
+	state.predictor = Clamp(state.predictor + difference, -32768, 32767);
+	state.stepIndex = Clamp(state.stepIndex + indexTable[nibble], 0, 88);
+	return (Int16)state.predictor;
+}
+
+static int EncodeSample(AdpcmState& state, int sample)
+{
+	int step = stepTable[state.stepIndex];
+	int difference = sample - state.predictor;
+	int nibble = 0;
+	if (difference < 0)
+	{
+		nibble = 8;
+		difference = -difference;
+	}
+	if (difference >= step) { nibble |= 4; difference -= step; }
+	step >>= 1;
+	if (difference >= step) { nibble |= 2; difference -= step; }
+	step >>= 1;
+	if (difference >= step) { nibble |= 1; }
+
+	//Run the decoder so the encoder tracks exactly what playback will reconstruct
+	DecodeNibble(state, nibble);
+	return nibble;
+}
+
+//Reads the format and data chunks of a 16-bit PCM WAV, skipping anything else in the file
+static bool ReadWav(const char* filename, UInt32& sampleRate, UInt32& channels, std::vector<Int16>& samples)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+	{
+		gef::DebugOut("CompactAudio: Could not open %s\n", filename);
+		return false;
+	}
+
+	char riff[12];
+	bool haveFormat = false;
+	bool haveData = false;
+	if (fread(riff, 1, sizeof(riff), file) == sizeof(riff) && memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0)
+	{
+		char chunkID[4];
+		UInt32 chunkSize;
+		while (haveData == false && fread(chunkID, 1, 4, file) == 4 && fread(&chunkSize, sizeof(chunkSize), 1, file) == 1)
+		{
+			long next = ftell(file) + (long)chunkSize + (long)(chunkSize & 1);
+			if (memcmp(chunkID, "fmt ", 4) == 0 && chunkSize >= 16)
+			{
+				unsigned short format, channelCount, blockAlign, bitsPerSample;
+				UInt32 rate, byteRate;
+				fread(&format, sizeof(format), 1, file);
+				fread(&channelCount, sizeof(channelCount), 1, file);
+				fread(&rate, sizeof(rate), 1, file);
+				fread(&byteRate, sizeof(byteRate), 1, file);
+				fread(&blockAlign, sizeof(blockAlign), 1, file);
+				fread(&bitsPerSample, sizeof(bitsPerSample), 1, file);
+				if (format != 1 || bitsPerSample != 16 || channelCount < 1 || channelCount > 2)
+				{
+					gef::DebugOut("CompactAudio: %s is not 16-bit mono or stereo PCM\n", filename);
+					break;
+				}
+				sampleRate = rate;
+				channels = channelCount;
+				haveFormat = true;
+			}
+			else if (memcmp(chunkID, "data", 4) == 0 && haveFormat)
+			{
+				samples.resize(chunkSize / sizeof(Int16));
+				haveData = fread(samples.data(), sizeof(Int16), samples.size(), file) == samples.size();
+			}
+			fseek(file, next, SEEK_SET);
+		}
+	}
+	fclose(file);
+
+	if (haveData == false)
+	{
+		gef::DebugOut("CompactAudio: Could not read PCM data from %s\n", filename);
+	}
+	return haveData;
+}
+
+bool ConvertWavToCompact(const char* wavFilename, const char* compactFilename)
+{
+	UInt32 sampleRate = 0;
+	UInt32 channels = 0;
+	std::vector<Int16> samples;
+	if (!ReadWav(wavFilename, sampleRate, channels, samples))
+		return false;
+
+	CompactAudioHeader header;
+	memcpy(header.magic, compactAudioMagic, sizeof(header.magic));
+	header.version = compactAudioVersion;
+	header.sampleRate = sampleRate;
+	header.channels = channels;
+	header.frameCount = (UInt32)(samples.size() / channels);
+	header.blockFrames = compactAudioBlockFrames;
+	header.blockCount = (header.frameCount + header.blockFrames - 1) / header.blockFrames;
+
+	UInt32 blockBytes = BlockBytes(channels, header.blockFrames);
+	std::vector<UInt8> data(header.blockCount * blockBytes, 0);
+
+	AdpcmState state[2] = { { 0, 0 }, { 0, 0 } };
+	for (UInt32 block = 0; block < header.blockCount; block++)
+	{
+		UInt8* blockData = data.data() + block * blockBytes;
+		for (UInt32 channel = 0; channel < channels; channel++)
+		{
+			UInt8* channelData = blockData + channel * (channelHeaderBytes + header.blockFrames / 2);
+			Int16 predictor = (Int16)state[channel].predictor;
+			memcpy(channelData, &predictor, sizeof(predictor));
+			channelData[2] = (UInt8)state[channel].stepIndex;
+			UInt8* nibbles = channelData + channelHeaderBytes;
+
+			for (UInt32 i = 0; i < header.blockFrames; i++)
+			{
+				UInt32 frame = block * header.blockFrames + i;
+				//Pad the last block with silence
+				int sample = frame < header.frameCount ? samples[frame * channels + channel] : 0;
+				int nibble = EncodeSample(state[channel], sample);
+				nibbles[i / 2] |= (UInt8)((i & 1) ? (nibble << 4) : nibble);
+			}
+		}
+	}
+
+	FILE* file = fopen(compactFilename, "wb");
+	if (file == NULL)
+	{
+		gef::DebugOut("CompactAudio: Could not write %s\n", compactFilename);
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+
+	if (written)
+	{
+		gef::DebugOut("CompactAudio: %s %u bytes -> %s %u bytes\n", wavFilename, (unsigned int)(samples.size() * sizeof(Int16)), compactFilename, (unsigned int)(sizeof(header) + data.size()));
+	}
+	return written;
+}
+
+bool CompactSound::load(const char* filename)
+{
+	release();
+
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+	{
+		gef::DebugOut("CompactSound: Could not open %s\n", filename);
+		return false;
+	}
+
+	//A truncated or corrupt file is rejected before anything is sized from its header
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && fseek(file, 0, SEEK_END) == 0;
+	long fileSize = valid ? ftell(file) : -1;
+	valid = valid && fileSize >= (long)sizeof(header)
+		&& ValidHeader(header, (unsigned long long)fileSize - sizeof(header))
+		&& fseek(file, sizeof(header), SEEK_SET) == 0;
+	if (valid)
+	{
+		data.resize((size_t)fileSize - sizeof(header));
+		valid = fread(data.data(), 1, data.size(), file) == data.size();
+	}
+	fclose(file);
+
+	if (valid == false)
+	{
+		gef::DebugOut("CompactSound: %s is not a valid compact sound\n", filename);
+		data.clear();
+		return false;
+	}
+	loaded = true;
+	return true;
+}
+
+void CompactSound::release()
+{
+	std::vector<UInt8>().swap(data);
+	loaded = false;
+}
+
+bool CompactSound::isLoaded()
+{
+	return loaded;
+}
+
+UInt32 CompactSound::getSampleRate() const
+{
+	return header.sampleRate;
+}
+
+UInt32 CompactSound::getChannels() const
+{
+	return header.channels;
+}
+
+UInt32 CompactSound::getFrameCount() const
+{
+	return header.frameCount;
+}
+
+UInt32 CompactSound::getBlockFrames() const
+{
+	return header.blockFrames;
+}
+
+UInt32 CompactSound::getBlockCount() const
+{
+	return header.blockCount;
+}
+
+UInt32 CompactSound::decodeBlock(UInt32 block, Int16* output) const
+{
+	if (loaded == false || block >= header.blockCount)
+		return 0;
+
+	//load checked that every block but the last is full and the last holds at least one frame
+	UInt32 firstFrame = block * header.blockFrames;
+	if (firstFrame >= header.frameCount)
+		return 0;
+	UInt32 frames = header.frameCount - firstFrame;
+	if (frames > header.blockFrames)
+		frames = header.blockFrames;
+
+	const UInt8* blockData = data.data() + (size_t)block * BlockBytes(header.channels, header.blockFrames);
+	for (UInt32 channel = 0; channel < header.channels; channel++)
+	{
+		const UInt8* channelData = blockData + channel * (channelHeaderBytes + header.blockFrames / 2);
+		Int16 predictor;
+		memcpy(&predictor, channelData, sizeof(predictor));
+		AdpcmState state = { predictor, Clamp(channelData[2], 0, 88) };
+		const UInt8* nibbles = channelData + channelHeaderBytes;
+
+		for (UInt32 i = 0; i < frames; i++)
+		{
+			int nibble = (i & 1) ? (nibbles[i / 2] >> 4) : (nibbles[i / 2] & 0x0f);
+			output[i * header.channels + channel] = DecodeNibble(state, nibble);
+		}
+	}
+	return frames;
+}
+
+void CompactSound::decodeAll(std::vector<Int16>& output) const
+{
+	output.resize((size_t)header.frameCount * header.channels);
+	for (UInt32 block = 0; block < header.blockCount; block++)
+	{
+		decodeBlock(block, output.data() + (size_t)block * header.blockFrames * header.channels);
+	}
+}
+
+unsigned int CompactSound::getResidentBytes() const
+{
+	return (unsigned int)(sizeof(header) + data.capacity());
+}
+
+CompactAudioStream::CompactAudioStream() :
+	sound(NULL),
+	ringFrames(0),
+	readFrame(0),
+	writeFrame(0),
+	nextBlock(0),
+	looping(false),
+	finished(true)
+{
+}
+
+void CompactAudioStream::open(const CompactSound* soundToStream, UInt32 ringBlocks, bool loop)
+{
+	sound = soundToStream;
+	looping = loop;
+	readFrame = 0;
+	writeFrame = 0;
+	nextBlock = 0;
+	finished = sound == NULL || sound->getBlockCount() == 0;
+	if (finished)
+		return;
+
+	if (ringBlocks < 2)
+		ringBlocks = 2;
+	ringFrames = ringBlocks * sound->getBlockFrames();
+	ring.assign(ringFrames * sound->getChannels(), 0);
+	blockScratch.assign(sound->getBlockFrames() * sound->getChannels(), 0);
+	fill();
+}
+
+void CompactAudioStream::close()
+{
+	sound = NULL;
+	finished = true;
+	std::vector<Int16>().swap(ring);
+	std::vector<Int16>().swap(blockScratch);
+}
+
+void CompactAudioStream::fill()
+{
+	if (sound == NULL)
+		return;
+
+	UInt32 channels = sound->getChannels();
+	while (nextBlock < sound->getBlockCount() && ringFrames - (writeFrame - readFrame) >= sound->getBlockFrames())
+	{
+		UInt32 frames = sound->decodeBlock(nextBlock, blockScratch.data());
+		for (UInt32 i = 0; i < frames; i++)
+		{
+			UInt32 slot = (UInt32)((writeFrame + i) % ringFrames);
+			for (UInt32 channel = 0; channel < channels; channel++)
+			{
+				ring[slot * channels + channel] = blockScratch[i * channels + channel];
+			}
+		}
+		writeFrame += frames;
+
+		nextBlock++;
+		if (nextBlock == sound->getBlockCount() && looping)
+		{
+			nextBlock = 0;
+		}
+	}
+}
+
+UInt32 CompactAudioStream::read(Int16* output, UInt32 frames)
+{
+	if (sound == NULL)
+		return 0;
+
+	UInt32 channels = sound->getChannels();
+	UInt32 copied = 0;
+	while (copied < frames)
+	{
+		if (writeFrame == readFrame)
+		{
+			fill();
+			if (writeFrame == readFrame)
+			{
+				finished = true;
+				break;
+			}
+		}
+
+		UInt32 slot = (UInt32)(readFrame % ringFrames);
+		UInt32 available = (UInt32)(writeFrame - readFrame);
+		UInt32 count = frames - copied;
+		if (count > available)
+			count = available;
+		//Stop at the end of the ring and wrap on the next pass
+		if (count > ringFrames - slot)
+			count = ringFrames - slot;
+
+		memcpy(output + copied * channels, ring.data() + slot * channels, count * channels * sizeof(Int16));
+		copied += count;
+		readFrame += count;
+	}
+	return copied;
+}
+
+bool CompactAudioStream::isFinished()
+{
+	return finished;
+}
+
+unsigned int CompactAudioStream::getResidentBytes() const
+{
+	return (unsigned int)((ring.capacity() + blockScratch.capacity()) * sizeof(Int16));
+}
+
+//The gef WAV path reads the whole file and keeps it for the life of the sample
+static unsigned int LoadWavWhole(const char* filename, std::vector<char>& contents)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+		return 0;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	contents.resize(size > 0 ? size : 0);
+	size_t read = fread(contents.data(), 1, contents.size(), file);
+	fclose(file);
+	return (unsigned int)read;
+}
+
+bool RunAudioBenchmark(const char** wavFilenames, unsigned int count, const char* outputFilename)
+{
+	FILE* output = fopen(outputFilename, "w");
+	if (output == NULL)
+	{
+		gef::DebugOut("CompactAudio: Could not write %s\n", outputFilename);
+		return false;
+	}
+
+	fprintf(output, "{\n  \"sounds\": [");
+	unsigned long long totalWav = 0;
+	unsigned long long totalExpanded = 0;
+	unsigned long long totalStreamed = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		std::string compactFilename = std::string(wavFilenames[i]);
+		compactFilename = compactFilename.substr(0, compactFilename.find_last_of('.')) + ".adp";
+
+		unsigned int wavBytes = 0;
+		unsigned int expandedBytes = 0;
+		unsigned int streamedBytes = 0;
+		double wavTime = 0.0;
+		double expandTime = 0.0;
+		double streamTime = 0.0;
+		for (unsigned int iteration = 0; iteration < benchmarkIterations; iteration++)
+		{
+			double startTime = PerfRecorder::nowMilliseconds();
+			std::vector<char> contents;
+			wavBytes = LoadWavWhole(wavFilenames[i], contents);
+			wavTime += PerfRecorder::nowMilliseconds() - startTime;
+
+			//Expanded: compressed file read then decoded to PCM, the compressed copy is dropped
+			startTime = PerfRecorder::nowMilliseconds();
+			CompactSound expanded;
+			std::vector<Int16> pcm;
+			if (expanded.load(compactFilename.c_str()))
+			{
+				expanded.decodeAll(pcm);
+			}
+			expanded.release();
+			expandTime += PerfRecorder::nowMilliseconds() - startTime;
+			expandedBytes = (unsigned int)(pcm.capacity() * sizeof(Int16));
+
+			//Streamed: compressed data stays resident plus a two block ring, timed to first audio
+			startTime = PerfRecorder::nowMilliseconds();
+			CompactSound streamed;
+			CompactAudioStream stream;
+			if (streamed.load(compactFilename.c_str()))
+			{
+				stream.open(&streamed, 2, false);
+			}
+			streamTime += PerfRecorder::nowMilliseconds() - startTime;
+			streamedBytes = streamed.getResidentBytes() + stream.getResidentBytes();
+		}
+
+		totalWav += wavBytes;
+		totalExpanded += expandedBytes;
+		totalStreamed += streamedBytes;
+		fprintf(output, "%s\n    {\"name\": \"%s\", \"wav_bytes\": %u, \"wav_load_ms\": %.6f, \"expanded_bytes\": %u, \"expanded_load_ms\": %.6f, \"streamed_bytes\": %u, \"streamed_load_ms\": %.6f}",
+			i == 0 ? "" : ",", wavFilenames[i], wavBytes, wavTime / benchmarkIterations, expandedBytes, expandTime / benchmarkIterations, streamedBytes, streamTime / benchmarkIterations);
+	}
+	fprintf(output, "\n  ],\n  \"total_wav_bytes\": %llu,\n  \"total_expanded_bytes\": %llu,\n  \"total_streamed_bytes\": %llu\n}\n", totalWav, totalExpanded, totalStreamed);
+	fclose(output);
+
+	gef::DebugOut("CompactAudio: resident bytes wav %llu, expanded %llu, streamed %llu\n", totalWav, totalExpanded, totalStreamed);
+	return true;
+}
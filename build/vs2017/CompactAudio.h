@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <gef.h>
+
+//Compact sound files (.adp) are 4-bit IMA ADPCM, about a quarter the size of the 16-bit WAVs they are converted from.
+//Audio is split into fixed size blocks that each carry their own decoder state, so decoding can start at any block.
+struct CompactAudioHeader
+{
+	char magic[4];
+	UInt32 version;
+	UInt32 sampleRate;
+	UInt32 channels;
+	UInt32 frameCount;
+	UInt32 blockFrames;
+	UInt32 blockCount;
+};
+
+//Offline converter. Only 16-bit PCM WAVs with one or two channels are supported.
+bool ConvertWavToCompact(const char* wavFilename, const char* compactFilename);
+
+//A compact sound held in memory still compressed
+class CompactSound
+{
+public:
+	bool load(const char* filename);
+	void release();
+	bool isLoaded();
+	UInt32 getSampleRate() const;
+	UInt32 getChannels() const;
+	UInt32 getFrameCount() const;
+	UInt32 getBlockFrames() const;
+	UInt32 getBlockCount() const;
+	//Decode one block of interleaved samples into output and return the number of frames written
+	UInt32 decodeBlock(UInt32 block, Int16* output) const;
+	//Expand the whole sound at load for short effects that are played often
+	void decodeAll(std::vector<Int16>& output) const;
+	unsigned int getResidentBytes() const;
+private:
+	CompactAudioHeader header;
+	std::vector<UInt8> data;
+	bool loaded = false;
+};
+
+//Decodes a compact sound a block at a time into a small ring buffer so long sounds like music never expand fully
+class CompactAudioStream
+{
+public:
+	CompactAudioStream();
+	//ringBlocks is how many decoded blocks the ring holds, two is enough for double buffering
+	void open(const CompactSound* sound, UInt32 ringBlocks, bool looping);
+	void close();
+	//Decode blocks until the ring is full or the sound ends
+	void fill();
+	//Copy up to frames interleaved frames into output, refilling as needed. Returns the frames copied.
+	UInt32 read(Int16* output, UInt32 frames);
+	bool isFinished();
+	unsigned int getResidentBytes() const;
+private:
+	const CompactSound* sound;
+	std::vector<Int16> ring;
+	std::vector<Int16> blockScratch;
+	UInt32 ringFrames;
+	//Counted in frames and never wrapped, the ring index is taken modulo ringFrames
+	unsigned long long readFrame;
+	unsigned long long writeFrame;
+	UInt32 nextBlock;
+	bool looping;
+	bool finished;
+};
+
+//Loads each WAV the way the game does today (whole file resident) and the matching .adp both expanded and streamed.
+//Writes resident bytes and load times for each file to a JSON file.
+bool RunAudioBenchmark(const char** wavFilenames, unsigned int count, const char* outputFilename);
@@ -1,47 +1,19 @@
 #include "EnemyObject.h"
-#include <system\debug_log.h>
+#include "MeshLOD.h"
+#include "GameBalance.h"
+#include <algorithm>
+#include <system/debug_log.h>
 
-EnemyObject::EnemyObject(gef::Scene* sceneFile, b2World* world, float xSpawnValue, gef::Mesh* mesh)
+//The five lanes enemies walk along
+static const float laneY[5] = { 2.0f, 0.5f, -1.0f, -3.5f, -5.0f };
+
+EnemyObject::EnemyObject()
 {
-	health = 100;
-	// setup the mesh for the enemy
-	this->set_mesh(mesh);
+	body = NULL;
+	health = enemyHealth;
 	// create a physics body for the enemy
 	bodyDef.type = b2_dynamicBody;
 
-	//Initialise our spawn points
-	spawnPoints[0] = new b2Vec2(xSpawnValue, 2);
-	spawnPoints[1] = new b2Vec2(xSpawnValue, 0.5);
-	spawnPoints[2] = new b2Vec2(xSpawnValue, -1);
-	spawnPoints[3] = new b2Vec2(xSpawnValue, -3.5);
-	spawnPoints[4] = new b2Vec2(xSpawnValue, -5);
-
-	int randomNumber = rand() % 5;
-
-	switch (randomNumber)
-	{
-	case 0:
-		bodyDef.position = *spawnPoints[0];
-		break;
-	case 1:
-		bodyDef.position = *spawnPoints[1];
-		break;
-	case 2:
-		bodyDef.position = *spawnPoints[2];
-		break;
-	case 3:
-		bodyDef.position = *spawnPoints[3];
-		break;
-	case 4:
-		bodyDef.position = *spawnPoints[4];
-		break;
-	default:
-		gef::DebugOut("ERROR: unable to set enemy spawn points in EnemyObject.cpp");
-		break;
-	}
-
-	body = world->CreateBody(&bodyDef);
-
 	// create the shape for the enemy
 	shape.SetAsBox(0.1f, 0.1f);
 
@@ -49,29 +21,184 @@ EnemyObject::EnemyObject(gef::Scene* sceneFile, b2World* world, float xSpawnValu
 	fixtureDef.shape = &shape;
 	fixtureDef.density = 1.0f;
 
-	// create the fixture on the rigid body
-	body->CreateFixture(&fixtureDef);
-
 	this->set_type(ENEMY);
 
-	body->SetUserData(this);
-
 	rotationMatrix.SetIdentity();
 	translationMatrix.SetIdentity();
 	scaleMatrix.SetIdentity();
 
 	scaleMatrix.Scale(gef::Vector4(0.2f, 0.2f, 0.2f));
 	rotationMatrix.RotationY(gef::DegToRad(90));
+	scaleRotationMatrix = scaleMatrix * rotationMatrix;
 }
 
 EnemyObject::~EnemyObject()
 {
-	//delete body;
-	//delete bodyDef;
-	//delete shape;
-	//delete fixtureDef;
-	//delete enemyMesh;
-	//delete spawnPoints;
+	//The body belongs to the world, it is destroyed with releaseBody or when the world is deleted
+}
+
+void EnemyObject::spawn(b2World* world, float xSpawnValue, gef::Mesh* mesh, bool createBody)
+{
+	health = enemyHealth;
+	stoppedMoving = false;
+	collidingWithEnemy = false;
+	collidingWithPlayer = false;
+	hit = false;
+	body = NULL;
+
+	// setup the mesh for the enemy
+	this->set_mesh(mesh);
+
+	lane = rand() % 5;
+	position = b2Vec2(xSpawnValue, laneY[lane]);
+
+	if (createBody == true)
+	{
+		activateBody(world);
+	}
+
+	update();
+}
+
+void EnemyObject::activateBody(b2World* world)
+{
+	if (body)
+	{
+		return;
+	}
+
+	bodyDef.position = position;
+	body = world->CreateBody(&bodyDef);
+
+	// create the fixture on the rigid body
+	body->CreateFixture(&fixtureDef);
+
+	body->SetUserData(this);
+
+	startWalking();
+}
+
+//One push gets the body up to walking speed, there is no damping to slow it down again
+void EnemyObject::startWalking()
+{
+	body->ApplyForceToCenter(b2Vec2(5, 0), true);
+}
+
+void EnemyObject::freeze(bool atHouse)
+{
+	if (body == NULL || stoppedMoving)
+	{
+		return;
+	}
+
+	//Changing the type destroys the body's contacts, so this can't be called while walking the contact list
+	body->SetType(b2_staticBody);
+	stoppedMoving = true;
+	collidingWithPlayer = atHouse;
+}
+
+void EnemyObject::wake()
+{
+	if (body == NULL || stoppedMoving == false)
+	{
+		return;
+	}
+
+	body->SetType(b2_dynamicBody);
+	body->SetAwake(true);
+	stoppedMoving = false;
+	collidingWithPlayer = false;
+	startWalking();
+}
+
+void EnemyObject::saveState(GameSnapshot::EnemyState& state)
+{
+	b2Vec2 currentPosition = getPosition();
+	b2Vec2 velocity = body ? body->GetLinearVelocity() : b2Vec2(0.0f, 0.0f);
+	state.x = currentPosition.x;
+	state.y = currentPosition.y;
+	state.velocityX = velocity.x;
+	state.velocityY = velocity.y;
+	state.health = (short)health;
+	state.lane = (unsigned char)lane;
+	state.flags = 0;
+	if (body)
+	{
+		state.flags |= GameSnapshot::ENEMY_HAS_BODY;
+		if (body->IsAwake())
+		{
+			state.flags |= GameSnapshot::ENEMY_AWAKE;
+		}
+	}
+	if (stoppedMoving)
+	{
+		state.flags |= GameSnapshot::ENEMY_FROZEN;
+	}
+	if (collidingWithPlayer)
+	{
+		state.flags |= GameSnapshot::ENEMY_AT_HOUSE;
+	}
+}
+
+void EnemyObject::restoreState(const GameSnapshot::EnemyState& state, b2World* world)
+{
+	lane = state.lane < 5 ? state.lane : 0;
+	position = b2Vec2(state.x, state.y);
+	health = state.health;
+	stoppedMoving = (state.flags & GameSnapshot::ENEMY_FROZEN) != 0;
+	collidingWithPlayer = (state.flags & GameSnapshot::ENEMY_AT_HOUSE) != 0;
+
+	if (state.flags & GameSnapshot::ENEMY_HAS_BODY)
+	{
+		//Frozen enemies go straight in as static rather than paying for a type change
+		b2BodyDef restoredDef = bodyDef;
+		restoredDef.position = position;
+		restoredDef.type = stoppedMoving ? b2_staticBody : b2_dynamicBody;
+		restoredDef.awake = (state.flags & GameSnapshot::ENEMY_AWAKE) != 0;
+		body = world->CreateBody(&restoredDef);
+		body->CreateFixture(&fixtureDef);
+		body->SetUserData(this);
+
+		if (stoppedMoving == false)
+		{
+			b2Vec2 velocity(state.velocityX, state.velocityY);
+			body->SetLinearVelocity(velocity);
+			//Taken before the first step after activateBody, so the push that starts it walking was still pending
+			if (velocity.LengthSquared() == 0.0f && restoredDef.awake)
+			{
+				startWalking();
+			}
+		}
+	}
+
+	update();
+}
+
+void EnemyObject::releaseBody(b2World* world)
+{
+	if (body && world)
+	{
+		world->DestroyBody(body);
+	}
+	body = NULL;
+}
+
+void EnemyObject::advanceWithoutBody(float frame_time)
+{
+	if (body == NULL)
+	{
+		position.x += enemyWalkSpeed * frame_time;
+	}
+}
+
+void EnemyObject::moveWithoutBody(float x)
+{
+	position.x = x;
+}
+
+float EnemyObject::getWalkSpeed()
+{
+	return enemyWalkSpeed;
 }
 
 b2Body* EnemyObject::getBody()
@@ -79,6 +206,20 @@ b2Body* EnemyObject::getBody()
 	return body;
 }
 
+b2Vec2 EnemyObject::getPosition()
+{
+	if (body)
+	{
+		return body->GetPosition();
+	}
+	return position;
+}
+
+int EnemyObject::getLane()
+{
+	return lane;
+}
+
 int EnemyObject::getHealth()
 {
 	return health;
@@ -89,41 +230,61 @@ void EnemyObject::decrementHealth(int value)
 	health = health - value;
 }
 
-void EnemyObject::render(gef::Renderer3D* renderer_3d_)
+void EnemyObject::render(gef::Renderer3D* renderer_3d_, MeshLODSet* lods)
 {
-	this->set_transform((scaleMatrix * rotationMatrix) * translationMatrix);
+	selectLOD(lods);
 	renderer_3d_->DrawMesh(*this);
 }
 
+void EnemyObject::selectLOD(MeshLODSet* lods)
+{
+	if (lods && lods->getLevelCount() > 0)
+	{
+		this->set_mesh(lods->select(objectTranslation, renderScale));
+	}
+}
+
 void EnemyObject::updateScale(gef::Vector4 scaleVector)
 {
 	scaleMatrix.Scale(scaleVector);
+	scaleRotationMatrix = scaleMatrix * rotationMatrix;
+	renderScale = std::max(scaleVector.x(), std::max(scaleVector.y(), scaleVector.z()));
 }
 
 void EnemyObject::updateRotationX(float degrees)
 {
 	rotationMatrix.RotationX(gef::DegToRad(degrees));
+	scaleRotationMatrix = scaleMatrix * rotationMatrix;
 }
 
 void EnemyObject::updateRotationY(float degrees)
 {
 	rotationMatrix.RotationY(gef::DegToRad(degrees));
+	scaleRotationMatrix = scaleMatrix * rotationMatrix;
 }
 
 void EnemyObject::updateRotationZ(float degrees)
 {
 	rotationMatrix.RotationZ(gef::DegToRad(degrees));
+	scaleRotationMatrix = scaleMatrix * rotationMatrix;
 }
 
 void EnemyObject::translate(gef::Vector4 translationVector)
 {
+	objectTranslation = translationVector;
 	translationMatrix.SetTranslation(translationVector);
 }
 
 void EnemyObject::update()
 {
-	objectTranslation = gef::Vector4(body->GetPosition().x, body->GetPosition().y, 0);
+	b2Vec2 currentPosition = getPosition();
+	objectTranslation = gef::Vector4(currentPosition.x, currentPosition.y, 0);
 	translationMatrix.SetTranslation(objectTranslation);
+
+	//Scale and rotation only change when updated, so just drop the translation into the cached product
+	gef::Matrix44 transform = scaleRotationMatrix;
+	transform.SetTranslation(objectTranslation);
+	this->set_transform(transform);
 }
 
 void EnemyObject::setHit(bool value)
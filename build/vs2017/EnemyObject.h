@@ -6,21 +6,43 @@
 #include <maths/vector4.h>
 #include <graphics/renderer_3d.h>
 #include <maths/math_utils.h>
+#include "GameSnapshot.h"
 
 namespace gef
 {
 	class Renderer3D;
 }
+class MeshLODSet;
 
 class EnemyObject: public GameObject
 {
 public:
-	EnemyObject(gef::Scene* sceneFile, b2World* world, float xSpawnValue, gef::Mesh* mesh);
+	EnemyObject();
 	~EnemyObject();
+	//Put the enemy back at the start of a random lane. Without a body the enemy walks kinematically until activateBody is called.
+	void spawn(b2World* world, float xSpawnValue, gef::Mesh* mesh, bool createBody);
+	void activateBody(b2World* world);
+	//Stop a queued enemy where it is. The body is made static, so the solver skips it and the bodies it touches can sleep.
+	void freeze(bool atHouse);
+	//Let a frozen enemy walk on again, for when whatever was holding it up has gone
+	void wake();
+	//Copy the enemy into a snapshot, or put a freshly acquired enemy back as it was with its body, if it had one, recreated in world
+	void saveState(GameSnapshot::EnemyState& state);
+	void restoreState(const GameSnapshot::EnemyState& state, b2World* world);
+	//Destroy the body, pass NULL when the world is being deleted anyway
+	void releaseBody(b2World* world);
+	void advanceWithoutBody(float frame_time);
+	//Place the enemy along its lane, used when something other than Box2D is moving it
+	void moveWithoutBody(float x);
+	static float getWalkSpeed();
 	b2Body* getBody();
+	b2Vec2 getPosition();
+	int getLane();
 	int getHealth();
 	void decrementHealth(int value);
-	void render(gef::Renderer3D* renderer_3d_);
+	//With a LOD set the mesh is swapped for the level that suits the enemy's size on screen
+	void render(gef::Renderer3D* renderer_3d_, MeshLODSet* lods = NULL);
+	void selectLOD(MeshLODSet* lods);
 	//Transform functions
 	void updateScale(gef::Vector4 scaleVector);
 	void updateRotationX(float degrees);
@@ -37,6 +59,7 @@ public:
 	void setCollidingWithPlayer(bool value);
 	bool getCollidingWithPlayer();
 private:
+	void startWalking();
 	b2Body* body;
 	b2BodyDef bodyDef;
 	b2PolygonShape shape;
@@ -45,11 +68,14 @@ private:
 	bool collidingWithEnemy = false;
 	bool collidingWithPlayer = false;
 	bool hit = false;
-	b2Vec2* spawnPoints[5];
+	b2Vec2 position;
+	int lane = 0;
 	int health;
 	gef::Vector4 objectTranslation;
 	gef::Matrix44 scaleMatrix;
 	gef::Matrix44 rotationMatrix;
 	gef::Matrix44 translationMatrix;
+	gef::Matrix44 scaleRotationMatrix;
+	float renderScale = 0.2f;
 };
 
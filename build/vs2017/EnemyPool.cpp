@@ -0,0 +1,54 @@
+#include "EnemyPool.h"
+
+EnemyPool::~EnemyPool()
+{
+	clear();
+}
+
+EnemyObject* EnemyPool::acquire(b2World* world, float xSpawnValue, gef::Mesh* mesh, bool createBody)
+{
+	EnemyObject* enemy = NULL;
+
+	if (freeEnemies.empty())
+	{
+		enemy = arena.create<EnemyObject>();
+		createdCount++;
+	}
+	else
+	{
+		enemy = freeEnemies.back();
+		freeEnemies.pop_back();
+	}
+
+	enemy->spawn(world, xSpawnValue, mesh, createBody);
+	return enemy;
+}
+
+void EnemyPool::release(EnemyObject* enemy, b2World* world)
+{
+	enemy->releaseBody(world);
+	enemy->set_mesh(NULL);
+	freeEnemies.push_back(enemy);
+}
+
+void EnemyPool::clear()
+{
+	freeEnemies.clear();
+	arena.reset();
+	createdCount = 0;
+}
+
+unsigned int EnemyPool::getFreeCount()
+{
+	return freeEnemies.size();
+}
+
+unsigned int EnemyPool::getCreatedCount()
+{
+	return createdCount;
+}
+
+LinearArena& EnemyPool::getArena()
+{
+	return arena;
+}
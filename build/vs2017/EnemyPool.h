@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include "EnemyObject.h"
+#include "LinearArena.h"
+
+//Keeps dead enemies around so large waves reuse them instead of new/delete for every spawn.
+//Enemies are made in a day-long arena, so clearing the pool at the end of the day frees them all in one reset.
+class EnemyPool
+{
+public:
+	~EnemyPool();
+	EnemyObject* acquire(b2World* world, float xSpawnValue, gef::Mesh* mesh, bool createBody);
+	//Return an enemy to the pool. Pass NULL for the world when it is about to be deleted anyway.
+	void release(EnemyObject* enemy, b2World* world);
+	//Destroy every enemy the pool has made. Enemies still in use must be released or forgotten first.
+	void clear();
+	unsigned int getFreeCount();
+	unsigned int getCreatedCount();
+	LinearArena& getArena();
+private:
+	LinearArena arena{ 256 * 1024, MEMORY_TAG_ENTITIES };
+	std::vector<EnemyObject*> freeEnemies;
+	unsigned int createdCount = 0;
+};
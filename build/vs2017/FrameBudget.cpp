@@ -0,0 +1,79 @@
+#include "FrameBudget.h"
+#include "PerfRecorder.h"
+
+static const char* subsystemNames[FrameBudget::SubsystemCount] = { "Enemies", "Physics", "Input", "Render3D", "Sprites" };
+static const char* subsystemScenarios[FrameBudget::SubsystemCount] = { "Frame/Enemies", "Frame/Physics", "Frame/Input", "Frame/Render3D", "Frame/Sprites" };
+//How much of each new frame goes into the smoothed time
+static const float smoothing = 0.1f;
+
+FrameBudget::FrameBudget()
+{
+	//Default split of a 16.6ms frame
+	budgets[Enemies] = 2.0f;
+	budgets[Physics] = 4.0f;
+	budgets[Input] = 1.0f;
+	budgets[Render3D] = 5.0f;
+	budgets[Sprites] = 2.0f;
+	reset();
+}
+
+void FrameBudget::setBudget(Subsystem subsystem, float milliseconds)
+{
+	budgets[subsystem] = milliseconds;
+}
+
+float FrameBudget::getBudget(Subsystem subsystem)
+{
+	return budgets[subsystem];
+}
+
+void FrameBudget::addTime(Subsystem subsystem, float milliseconds)
+{
+	averages[subsystem] = averages[subsystem] + (milliseconds - averages[subsystem]) * smoothing;
+	if (milliseconds > budgets[subsystem])
+	{
+		overBudgetFrames[subsystem]++;
+	}
+	PerfRecorder::instance().addSample(subsystemScenarios[subsystem], milliseconds);
+}
+
+float FrameBudget::getAverage(Subsystem subsystem)
+{
+	return averages[subsystem];
+}
+
+bool FrameBudget::isOverBudget(Subsystem subsystem)
+{
+	return averages[subsystem] > budgets[subsystem];
+}
+
+unsigned int FrameBudget::getOverBudgetFrames(Subsystem subsystem)
+{
+	return overBudgetFrames[subsystem];
+}
+
+const char* FrameBudget::getName(Subsystem subsystem)
+{
+	return subsystemNames[subsystem];
+}
+
+void FrameBudget::reset()
+{
+	for (int i = 0; i < SubsystemCount; i++)
+	{
+		averages[i] = 0.0f;
+		overBudgetFrames[i] = 0;
+	}
+}
+
+ScopedBudgetTimer::ScopedBudgetTimer(FrameBudget& budget, FrameBudget::Subsystem subsystem) :
+	frameBudget(budget),
+	timedSubsystem(subsystem)
+{
+	startTime = PerfRecorder::nowMilliseconds();
+}
+
+ScopedBudgetTimer::~ScopedBudgetTimer()
+{
+	frameBudget.addTime(timedSubsystem, (float)(PerfRecorder::nowMilliseconds() - startTime));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+//Per subsystem frame times against a budget, so big waves show which part of the frame is over
+class FrameBudget
+{
+public:
+	enum Subsystem
+	{
+		Enemies,
+		Physics,
+		Input,
+		Render3D,
+		Sprites,
+		SubsystemCount
+	};
+	FrameBudget();
+	void setBudget(Subsystem subsystem, float milliseconds);
+	float getBudget(Subsystem subsystem);
+	void addTime(Subsystem subsystem, float milliseconds);
+	//Smoothed time over the last few frames
+	float getAverage(Subsystem subsystem);
+	bool isOverBudget(Subsystem subsystem);
+	unsigned int getOverBudgetFrames(Subsystem subsystem);
+	const char* getName(Subsystem subsystem);
+	void reset();
+private:
+	float budgets[SubsystemCount];
+	float averages[SubsystemCount];
+	unsigned int overBudgetFrames[SubsystemCount];
+};
+
+//Adds the time spent in the enclosing scope to one subsystem
+class ScopedBudgetTimer
+{
+public:
+	ScopedBudgetTimer(FrameBudget& budget, FrameBudget::Subsystem subsystem);
+	~ScopedBudgetTimer();
+private:
+	FrameBudget& frameBudget;
+	FrameBudget::Subsystem timedSubsystem;
+	double startTime;
+};
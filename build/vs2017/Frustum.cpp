@@ -0,0 +1,100 @@
+#include "Frustum.h"
+#include <algorithm>
+#include <cmath>
+#include <graphics/mesh.h>
+#include <graphics/mesh_instance.h>
+
+void Frustum::set(const gef::Matrix44& viewProjection)
+{
+	//Points are row vectors, so each clip coordinate is a dot product with one column
+	for (int plane = 0; plane < PlaneCount; plane++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			float x = viewProjection.m(row, 0);
+			float y = viewProjection.m(row, 1);
+			float z = viewProjection.m(row, 2);
+			float w = viewProjection.m(row, 3);
+			switch (plane)
+			{
+			case Left: planes[plane][row] = w + x; break;
+			case Right: planes[plane][row] = w - x; break;
+			case Bottom: planes[plane][row] = w + y; break;
+			case Top: planes[plane][row] = w - y; break;
+			//-w <= z covers both the 0..w and -w..w depth conventions, it is only looser for the first
+			case Near: planes[plane][row] = w + z; break;
+			case Far: planes[plane][row] = w - z; break;
+			}
+		}
+
+		float length = sqrtf(planes[plane][0] * planes[plane][0] + planes[plane][1] * planes[plane][1] + planes[plane][2] * planes[plane][2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				planes[plane][i] /= length;
+			}
+		}
+	}
+}
+
+bool Frustum::intersectsSphere(const gef::Vector4& centre, float radius)
+{
+	for (int plane = 0; plane < PlaneCount; plane++)
+	{
+		float distance = planes[plane][0] * centre.x() + planes[plane][1] * centre.y() + planes[plane][2] * centre.z() + planes[plane][3];
+		if (distance < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::isVisible(const gef::MeshInstance& instance)
+{
+	const gef::Mesh* mesh = instance.mesh();
+	if (mesh == NULL)
+	{
+		culledCount++;
+		return false;
+	}
+
+	const gef::Matrix44& transform = instance.transform();
+	gef::Vector4 centre = mesh->bounding_sphere().position().Transform(transform);
+
+	//Scale the radius by the largest axis scale in the transform
+	float largestScale = 0.0f;
+	for (int row = 0; row < 3; row++)
+	{
+		float x = transform.m(row, 0);
+		float y = transform.m(row, 1);
+		float z = transform.m(row, 2);
+		largestScale = std::max(largestScale, x * x + y * y + z * z);
+	}
+	float radius = mesh->bounding_sphere().radius() * sqrtf(largestScale);
+
+	if (intersectsSphere(centre, radius))
+	{
+		drawnCount++;
+		return true;
+	}
+	culledCount++;
+	return false;
+}
+
+void Frustum::beginFrame()
+{
+	drawnCount = 0;
+	culledCount = 0;
+}
+
+unsigned int Frustum::getDrawnCount()
+{
+	return drawnCount;
+}
+
+unsigned int Frustum::getCulledCount()
+{
+	return culledCount;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <maths/matrix44.h>
+#include <maths/vector4.h>
+
+namespace gef
+{
+	class MeshInstance;
+}
+
+//View frustum built from the camera matrices, used to skip meshes that would not reach the screen.
+//Tests are against each mesh's bounding sphere so a few off-screen objects near the edges still get drawn.
+class Frustum
+{
+public:
+	//viewProjection is view * projection, as passed to the renderer
+	void set(const gef::Matrix44& viewProjection);
+	bool intersectsSphere(const gef::Vector4& centre, float radius);
+	//Tests the instance's mesh bounds under its current transform and counts the result
+	bool isVisible(const gef::MeshInstance& instance);
+	void beginFrame();
+	unsigned int getDrawnCount();
+	unsigned int getCulledCount();
+private:
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+	//a, b, c, d with the normal pointing into the frustum
+	float planes[PlaneCount][4];
+	unsigned int drawnCount = 0;
+	unsigned int culledCount = 0;
+};
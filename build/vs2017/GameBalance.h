@@ -0,0 +1,51 @@
+#pragma once
+
+//Tuning values shared by the game and the headless session simulation, so a balance sweep tests what is actually played.
+
+struct WeaponBalance
+{
+	int cost;
+	int damage;
+	int maxAmmo;
+	float reloadTime;
+};
+
+//Weapons. The handgun is given to the player at the start of a session, so its cost is never charged.
+static const WeaponBalance handgunBalance = { 100, 30, 10, 2.5f };
+static const WeaponBalance sniperBalance = { 250, 40, 1, 1.0f };
+static const WeaponBalance assaultRifleBalance = { 200, 20, 25, 3.0f };
+static const WeaponBalance shotgunBalance = { 300, 50, 2, 1.5f };
+
+//Store items
+static const int healthPackCost = 50;
+static const int healthPackHealth = 10;
+static const int riflemanCost = 100;
+static const int repairGuyCost = 100;
+
+//Player
+static const int playerMaxHealth = 100;
+//Enemies touching the house take one health at most this often
+static const float playerDamageInterval = 0.5f;
+static const unsigned short int defaultRoundsToBeat = 10;
+
+//Helpers. Each rifleman hits one enemy per volley, each repair guy restores one health per visit.
+static const float riflemanInterval = 2.0f;
+static const int riflemanDamage = 5;
+static const float repairGuyInterval = 5.0f;
+
+//Enemies
+static const int enemyHealth = 100;
+static const int enemyKillCredits = 10;
+static const int enemiesPerDay = 2;
+//Horde days run with --large-waves
+static const int largeWaveEnemiesPerDay = 1000;
+//Speed a body reaches from the single ApplyForceToCenter(5, 0) push: 5N for one 1/60s step on a 0.2 x 0.2 box of density 1
+static const float enemyWalkSpeed = 5.0f / (60.0f * 0.04f);
+//Enemy i of a day starts i metres behind this
+static const float enemySpawnX = -10.0f;
+//Left edge of the house body less half an enemy, where the lane model stops the front of each lane
+static const float houseStopX = 2.4f;
+//Gap kept between enemies in a lane when one without a body joins the queue
+static const float enemySpacing = 0.25f;
+//Radius of the sphere a shot has to pass through to hit an enemy
+static const float enemyPickRadius = 0.9f;
@@ -0,0 +1,26 @@
+#include "GameRules.h"
+#include "GameBalance.h"
+#include <cmath>
+
+int DayEnemyCount(int day, bool largeWaves)
+{
+	if (largeWaves == true)
+	{
+		return day * largeWaveEnemiesPerDay;
+	}
+	return day * enemiesPerDay;
+}
+
+float NextHelperTick(float dayTime, float interval)
+{
+	return (floorf(dayTime / interval) + 1.0f) * interval;
+}
+
+unsigned int RiflemanTargetCount(unsigned int riflemen, size_t enemyCount)
+{
+	if (riflemen > enemyCount)
+	{
+		return (unsigned int)enemyCount;
+	}
+	return riflemen;
+}
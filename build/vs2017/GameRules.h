@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//Rules of a day that SceneApp and SessionSim both play by, so the balance sweep can't drift from the game.
+//The player's health, credits, helpers and purchases are shared the same way through PlayerData.
+
+//Enemies sent on a day
+int DayEnemyCount(int day, bool largeWaves);
+
+//First helper tick after dayTime. Riflemen and repair guys tick at whole multiples of their interval into the day.
+float NextHelperTick(float dayTime, float interval);
+
+//Each rifleman takes one target, so a volley hits this many enemies from the front of the day's enemy list
+unsigned int RiflemanTargetCount(unsigned int riflemen, size_t enemyCount);
+
+//Drops the items keep turns down and packs the rest down in order, so the enemies nearest the house stay at the front.
+//keep is called once per item, front to back.
+template <typename T, typename Keep>
+void KeepInOrder(std::vector<T>& items, Keep keep)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (keep(items[i]))
+		{
+			items[kept++] = items[i];
+		}
+	}
+	items.resize(kept);
+}
+
+//Walks one lane, positions sorted front (nearest the house) to back, and resolves queueing so nobody passes the house
+//or the enemy ahead of them. place(i, queued) is called front to back once position i is final.
+//Returns true if the front of the lane is pressed against the house.
+template <typename Place>
+bool AdvanceLane(float* positions, unsigned int count, float step, float stopX, float spacing, Place place)
+{
+	if (count == 0)
+	{
+		return false;
+	}
+
+	//Integrate. A plain loop over contiguous floats so the compiler can vectorise it.
+	for (unsigned int i = 0; i < count; i++)
+	{
+		positions[i] += step;
+	}
+
+	float limit = stopX;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		bool queued = positions[i] >= limit;
+		if (queued)
+		{
+			positions[i] = limit;
+		}
+		limit = positions[i] - spacing;
+		place(i, queued);
+	}
+
+	return positions[0] >= stopX;
+}
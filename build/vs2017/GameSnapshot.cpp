@@ -0,0 +1,177 @@
+#include "GameSnapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system/debug_log.h>
+#include "TemporaryFile.h"
+
+static const char snapshotMagic[4] = { 'G', 'S', 'A', 'V' };
+static const unsigned int snapshotVersion = 1;
+static const unsigned int campaignTag = 0x4e504d43; //"CMPN"
+static const unsigned int dayTag = 0x20594144; //"DAY "
+
+struct SnapshotHeader
+{
+	char magic[4];
+	unsigned int version;
+};
+
+struct ChunkHeader
+{
+	unsigned int tag;
+	unsigned int size;
+};
+
+void GameSnapshot::clear()
+{
+	memset(&campaign, 0, sizeof(campaign));
+	memset(&day, 0, sizeof(day));
+	hasDay = false;
+	enemies.clear();
+}
+
+void GameSnapshot::appendChunk(unsigned int tag, const void* data, size_t size, const void* extra, size_t extraSize)
+{
+	ChunkHeader chunk;
+	chunk.tag = tag;
+	chunk.size = (unsigned int)(size + extraSize);
+
+	size_t offset = bytes.size();
+	bytes.resize(offset + sizeof(chunk) + chunk.size);
+	memcpy(&bytes[offset], &chunk, sizeof(chunk));
+	memcpy(&bytes[offset + sizeof(chunk)], data, size);
+	if (extraSize > 0)
+	{
+		memcpy(&bytes[offset + sizeof(chunk) + size], extra, extraSize);
+	}
+}
+
+const std::vector<char>& GameSnapshot::encode()
+{
+	SnapshotHeader header;
+	memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+	header.version = snapshotVersion;
+
+	bytes.resize(sizeof(header));
+	memcpy(&bytes[0], &header, sizeof(header));
+	appendChunk(campaignTag, &campaign, sizeof(campaign));
+	if (hasDay)
+	{
+		day.enemyCount = (unsigned int)enemies.size();
+		memset(day.reserved, 0, sizeof(day.reserved));
+		appendChunk(dayTag, &day, sizeof(day), enemies.empty() ? NULL : &enemies[0], enemies.size() * sizeof(EnemyState));
+	}
+	return bytes;
+}
+
+bool GameSnapshot::decode(const char* data, size_t size)
+{
+	clear();
+
+	SnapshotHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 || header.version != snapshotVersion)
+	{
+		return false;
+	}
+
+	bool hasCampaign = false;
+	size_t offset = sizeof(header);
+	while (offset + sizeof(ChunkHeader) <= size)
+	{
+		ChunkHeader chunk;
+		memcpy(&chunk, data + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk.size > size - offset)
+		{
+			return false;
+		}
+
+		const char* chunkData = data + offset;
+		if (chunk.tag == campaignTag && chunk.size == sizeof(campaign))
+		{
+			memcpy(&campaign, chunkData, sizeof(campaign));
+			hasCampaign = true;
+		}
+		else if (chunk.tag == dayTag && chunk.size >= sizeof(day))
+		{
+			memcpy(&day, chunkData, sizeof(day));
+			//Bound the count by what the chunk can hold first, so a corrupt count can't overflow the size it is checked against
+			if (day.enemyCount > (chunk.size - sizeof(day)) / sizeof(EnemyState) || chunk.size != sizeof(day) + day.enemyCount * sizeof(EnemyState))
+			{
+				return false;
+			}
+			enemies.resize(day.enemyCount);
+			if (day.enemyCount > 0)
+			{
+				memcpy(&enemies[0], chunkData + sizeof(day), day.enemyCount * sizeof(EnemyState));
+			}
+			hasDay = true;
+		}
+		offset += chunk.size;
+	}
+	return hasCampaign;
+}
+
+bool GameSnapshot::save(const char* filename)
+{
+	const std::vector<char>& data = encode();
+
+	std::string temporaryFilename = std::string(filename) + ".tmp";
+	FILE* file = fopen(temporaryFilename.c_str(), "wb");
+	if (file == NULL)
+	{
+		gef::DebugOut("Snapshot: Could not write %s\n", temporaryFilename.c_str());
+		return false;
+	}
+	bool success = fwrite(&data[0], 1, data.size(), file) == data.size();
+	success = fclose(file) == 0 && success;
+
+	//The last good save stays in place unless the new one was written in full
+	if (success == false)
+	{
+		gef::DebugOut("Snapshot: Could not write %s\n", temporaryFilename.c_str());
+		remove(temporaryFilename.c_str());
+		return false;
+	}
+	if (CommitTemporaryFile(temporaryFilename.c_str(), filename, true) == false)
+	{
+		gef::DebugOut("Snapshot: Could not replace %s\n", filename);
+		remove(temporaryFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool GameSnapshot::load(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	std::vector<char> contents;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bool success = size > 0;
+	if (success)
+	{
+		contents.resize(size);
+		success = fread(&contents[0], 1, size, file) == (size_t)size;
+	}
+	fclose(file);
+
+	if (success == false || decode(&contents[0], contents.size()) == false)
+	{
+		gef::DebugOut("Snapshot: %s is not a valid snapshot\n", filename);
+		clear();
+		return false;
+	}
+	return true;
+}
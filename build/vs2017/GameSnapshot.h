@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//Binary image of a game in progress, for checkpoints and for jumping straight into a day.
+//The file is a header and a list of chunks, each with a tag and a size, so readers step over chunks they don't know.
+//The campaign chunk is the player and the day reached, written at the end of every day. A snapshot taken
+//mid-round adds a day chunk with the clock and every enemy, including its Box2D position and velocity.
+class GameSnapshot
+{
+public:
+	//Bit per weapon in ownedWeapons, in the order SceneApp keeps them
+	enum SnapshotWeapon
+	{
+		SNAPSHOT_WEAPON_HANDGUN,
+		SNAPSHOT_WEAPON_SNIPER,
+		SNAPSHOT_WEAPON_ASSAULT_RIFLE,
+		SNAPSHOT_WEAPON_SHOTGUN,
+		SNAPSHOT_WEAPON_COUNT
+	};
+	enum EnemyFlags
+	{
+		ENEMY_HAS_BODY = 1,
+		ENEMY_FROZEN = 2,
+		ENEMY_AT_HOUSE = 4,
+		ENEMY_AWAKE = 8
+	};
+	struct CampaignState
+	{
+		unsigned short roundCounter;
+		unsigned short roundsToBeat;
+		int credits;
+		int health;
+		float lastDamageTime;
+		unsigned short riflemen;
+		unsigned short repairGuys;
+		unsigned int ownedWeapons;
+		unsigned int activeWeapon;
+		int activeAmmo;
+		float ranOutOfAmmoTime;
+		unsigned int reloading;
+	};
+	struct DayState
+	{
+		float gameTime;
+		unsigned int dayEnemyCount;
+		unsigned int enemyCount;
+		unsigned char laneMovement;
+		unsigned char largeWaveMode;
+		unsigned char reserved[2];
+	};
+	struct EnemyState
+	{
+		float x;
+		float y;
+		float velocityX;
+		float velocityY;
+		short health;
+		unsigned char lane;
+		unsigned char flags;
+	};
+
+	void clear();
+	//Lay the snapshot out as it is stored. The buffer is kept, so a snapshot taken every day or every
+	//few seconds stops allocating once it has grown to the largest wave.
+	const std::vector<char>& encode();
+	bool decode(const char* data, size_t size);
+	//Written to a temporary file and renamed over filename, so a crash mid write keeps the last checkpoint
+	bool save(const char* filename);
+	bool load(const char* filename);
+
+	CampaignState campaign;
+	bool hasDay = false;
+	DayState day;
+	std::vector<EnemyState> enemies;
+private:
+	void appendChunk(unsigned int tag, const void* data, size_t size, const void* extra = NULL, size_t extraSize = 0);
+	std::vector<char> bytes;
+};
@@ -0,0 +1,144 @@
+#include "InputQueue.h"
+#include <algorithm>
+#include <input/input_manager.h>
+#include <input/touch_input_manager.h>
+#include "PerfRecorder.h"
+
+void InputQueue::watchKey(gef::Keyboard::KeyCode key)
+{
+	if (std::find(watchedKeys.begin(), watchedKeys.end(), key) == watchedKeys.end())
+	{
+		watchedKeys.push_back(key);
+	}
+}
+
+void InputQueue::gather(gef::InputManager* inputManager)
+{
+	events.clear();
+	//gef polls once a frame and doesn't timestamp events, so they all share the time they were read
+	double now = PerfRecorder::nowMilliseconds();
+
+	const gef::TouchInputManager* touchInput = inputManager->touch_manager();
+	if (touchInput && touchInput->max_num_panels() > 0)
+	{
+		const gef::TouchContainer& panelTouches = touchInput->touches(0);
+		for (gef::ConstTouchIterator touch = panelTouches.begin(); touch != panelTouches.end(); ++touch)
+		{
+			InputEvent event;
+			event.touchID = touch->id;
+			event.position = touch->position;
+			event.key = -1;
+			event.timestamp = now;
+
+			if (touch->type == gef::TT_NEW)
+			{
+				event.type = InputEvent::TouchPressed;
+				heldTouches.push_back(touch->id);
+				events.push_back(event);
+			}
+			else if (touch->type == gef::TT_RELEASED)
+			{
+				event.type = InputEvent::TouchReleased;
+				std::vector<Int32>::iterator held = std::find(heldTouches.begin(), heldTouches.end(), touch->id);
+				if (held != heldTouches.end())
+				{
+					heldTouches.erase(held);
+				}
+				events.push_back(event);
+			}
+		}
+	}
+
+	gef::Keyboard* keyboard = inputManager->keyboard();
+	if (keyboard)
+	{
+		for (unsigned int i = 0; i < watchedKeys.size(); i++)
+		{
+			if (keyboard->IsKeyPressed(watchedKeys[i]))
+			{
+				InputEvent event;
+				event.type = InputEvent::KeyPressed;
+				event.touchID = -1;
+				event.key = (Int32)watchedKeys[i];
+				event.timestamp = now;
+				events.push_back(event);
+			}
+		}
+	}
+}
+
+void InputQueue::gatherScripted(const std::vector<InputEvent>& pressed)
+{
+	events.clear();
+	double now = PerfRecorder::nowMilliseconds();
+
+	for (unsigned int i = 0; i < heldTouches.size(); i++)
+	{
+		InputEvent event;
+		event.type = InputEvent::TouchReleased;
+		event.touchID = heldTouches[i];
+		event.position = gef::Vector2(0.0f, 0.0f);
+		event.key = -1;
+		event.timestamp = now;
+		events.push_back(event);
+	}
+	heldTouches.clear();
+
+	for (unsigned int i = 0; i < pressed.size(); i++)
+	{
+		InputEvent event = pressed[i];
+		if (event.type == InputEvent::KeyPressed && std::find(watchedKeys.begin(), watchedKeys.end(), (gef::Keyboard::KeyCode)event.key) == watchedKeys.end())
+			continue;
+
+		if (event.type == InputEvent::TouchPressed)
+		{
+			heldTouches.push_back(event.touchID);
+		}
+		event.timestamp = now;
+		events.push_back(event);
+	}
+}
+
+const std::vector<InputEvent>& InputQueue::getEvents()
+{
+	return events;
+}
+
+unsigned int InputQueue::getHeldTouchCount()
+{
+	return (unsigned int)heldTouches.size();
+}
+
+void InputQueue::recordLatency(const InputEvent& event)
+{
+	double latency = PerfRecorder::nowMilliseconds() - event.timestamp;
+	latencyCount++;
+	latencyTotal += latency;
+	latencyMax = std::max(latencyMax, latency);
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("Input/touch_to_hit", latency);
+	}
+}
+
+unsigned int InputQueue::getLatencyCount()
+{
+	return latencyCount;
+}
+
+double InputQueue::getAverageLatency()
+{
+	return latencyCount > 0 ? latencyTotal / latencyCount : 0.0;
+}
+
+double InputQueue::getMaxLatency()
+{
+	return latencyMax;
+}
+
+void InputQueue::resetLatency()
+{
+	latencyCount = 0;
+	latencyTotal = 0.0;
+	latencyMax = 0.0;
+}
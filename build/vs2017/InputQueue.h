@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <gef.h>
+#include <maths/vector2.h>
+#include <input/keyboard.h>
+
+namespace gef
+{
+	class InputManager;
+}
+
+struct InputEvent
+{
+	enum Type
+	{
+		TouchPressed,
+		TouchReleased,
+		KeyPressed
+	};
+	Type type;
+	//Touch id for touch events
+	Int32 touchID;
+	gef::Vector2 position;
+	//gef::Keyboard::KeyCode for key events, -1 otherwise
+	Int32 key;
+	//PerfRecorder::nowMilliseconds when the event was read from gef
+	double timestamp;
+};
+
+//Every touch and watched key event for a frame, in the order gef reported them.
+//Any number of touches can be held at once, each new one is its own TouchPressed event.
+class InputQueue
+{
+public:
+	//Keys that are not watched are left out of the queue
+	void watchKey(gef::Keyboard::KeyCode key);
+	//Replace last frame's events with this frame's. Call after the input manager's Update.
+	void gather(gef::InputManager* inputManager);
+	//The same from key presses and touches made up by the caller, e.g. an InputScript, when there is no input manager.
+	//The touches are taps and are released on the next gather.
+	void gatherScripted(const std::vector<InputEvent>& pressed);
+	const std::vector<InputEvent>& getEvents();
+	unsigned int getHeldTouchCount();
+
+	//Time from an event being read to its effect being applied, e.g. a touch to the shot it fired hitting
+	void recordLatency(const InputEvent& event);
+	unsigned int getLatencyCount();
+	double getAverageLatency();
+	double getMaxLatency();
+	void resetLatency();
+private:
+	std::vector<gef::Keyboard::KeyCode> watchedKeys;
+	std::vector<InputEvent> events;
+	std::vector<Int32> heldTouches;
+	unsigned int latencyCount = 0;
+	double latencyTotal = 0.0;
+	double latencyMax = 0.0;
+};
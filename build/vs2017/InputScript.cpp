@@ -0,0 +1,179 @@
+#include "InputScript.h"
+#include <cstdio>
+#include <cstring>
+#include <system/debug_log.h>
+
+struct ScriptKey
+{
+	const char* name;
+	gef::Keyboard::KeyCode key;
+};
+
+//The keys the game watches, see SceneApp::Init
+static const ScriptKey scriptKeys[] =
+{
+	{ "RETURN", gef::Keyboard::KC_RETURN },
+	{ "L", gef::Keyboard::KC_L },
+	{ "K", gef::Keyboard::KC_K },
+	{ "M", gef::Keyboard::KC_M },
+	{ "F5", gef::Keyboard::KC_F5 },
+	{ "F9", gef::Keyboard::KC_F9 },
+};
+
+bool InputScript::load(const char* filename)
+{
+	commands.clear();
+	FILE* file = fopen(filename, "r");
+	if (file == NULL)
+	{
+		gef::DebugOut("InputScript: Could not open %s\n", filename);
+		return false;
+	}
+
+	char buffer[256];
+	unsigned int lineNumber = 0;
+	bool success = true;
+	while (success && fgets(buffer, sizeof(buffer), file) != NULL)
+	{
+		lineNumber++;
+		std::string line(buffer);
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r\n") == std::string::npos)
+			continue;
+
+		Command command;
+		success = parseLine(line, command);
+		if (success)
+		{
+			commands.push_back(command);
+		}
+		else
+		{
+			gef::DebugOut("InputScript: %s line %u is not a command\n", filename, lineNumber);
+		}
+	}
+	fclose(file);
+	return success;
+}
+
+bool InputScript::parseLine(const std::string& line, Command& command)
+{
+	char when[16];
+	char action[16];
+	unsigned int frame = 0;
+	//Stays at the end of the line if nothing follows the action
+	int consumed = (int)line.size();
+	if (sscanf(line.c_str(), "%15s %u %15s %n", when, &frame, action, &consumed) < 3)
+		return false;
+
+	if (strcmp(when, "at") == 0)
+	{
+		command.repeating = false;
+	}
+	else if (strcmp(when, "every") == 0 && frame > 0)
+	{
+		command.repeating = true;
+	}
+	else
+	{
+		return false;
+	}
+	command.frame = frame;
+	command.key = gef::Keyboard::KC_RETURN;
+	command.position = gef::Vector2(0.0f, 0.0f);
+
+	const char* arguments = line.c_str() + consumed;
+	if (strcmp(action, "key") == 0)
+	{
+		char name[16];
+		if (sscanf(arguments, "%15s", name) != 1)
+			return false;
+
+		for (unsigned int i = 0; i < sizeof(scriptKeys) / sizeof(scriptKeys[0]); i++)
+		{
+			if (strcmp(name, scriptKeys[i].name) == 0)
+			{
+				command.action = PressKey;
+				command.key = scriptKeys[i].key;
+				return true;
+			}
+		}
+		return false;
+	}
+	if (strcmp(action, "tap") == 0)
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		if (sscanf(arguments, "%f %f", &x, &y) != 2)
+			return false;
+
+		command.action = Tap;
+		command.position = gef::Vector2(x, y);
+		return true;
+	}
+	if (strcmp(action, "aim") == 0)
+	{
+		command.action = Aim;
+		return true;
+	}
+	return false;
+}
+
+void InputScript::setAimTarget(std::function<bool(gef::Vector2&)> target)
+{
+	aimTarget = target;
+}
+
+void InputScript::getEvents(unsigned int frame, std::vector<InputEvent>& events)
+{
+	for (unsigned int i = 0; i < commands.size(); i++)
+	{
+		const Command& command = commands[i];
+		bool due = command.repeating ? frame % command.frame == 0 : frame == command.frame;
+		if (due == false)
+			continue;
+
+		switch (command.action)
+		{
+		case PressKey:
+		{
+			InputEvent event;
+			event.type = InputEvent::KeyPressed;
+			event.touchID = -1;
+			event.position = gef::Vector2(0.0f, 0.0f);
+			event.key = (Int32)command.key;
+			event.timestamp = 0.0;
+			events.push_back(event);
+			break;
+		}
+		case Tap:
+			addTouch(command.position, events);
+			break;
+		case Aim:
+		{
+			gef::Vector2 position(0.0f, 0.0f);
+			if (aimTarget && aimTarget(position))
+			{
+				addTouch(position, events);
+			}
+			break;
+		}
+		}
+	}
+}
+
+unsigned int InputScript::getCommandCount()
+{
+	return (unsigned int)commands.size();
+}
+
+void InputScript::addTouch(const gef::Vector2& position, std::vector<InputEvent>& events)
+{
+	InputEvent event;
+	event.type = InputEvent::TouchPressed;
+	event.touchID = nextTouchID++;
+	event.position = position;
+	event.key = -1;
+	event.timestamp = 0.0;
+	events.push_back(event);
+}
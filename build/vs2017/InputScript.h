@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include <gef.h>
+#include <maths/vector2.h>
+#include <input/keyboard.h>
+#include "InputQueue.h"
+
+//Input read from a text file instead of the devices, for headless runs. One command a line, # starts a comment:
+//  at FRAME key NAME    press a key on that frame. NAME is RETURN, L, K, M, F5 or F9.
+//  at FRAME tap X Y     touch the screen at X, Y on that frame
+//  at FRAME aim         touch whatever the aim callback picks
+//  every N ...          the same on every Nth frame
+//Frames count from 1, the first frame the game updates. Touches are taps, released the frame after.
+class InputScript
+{
+public:
+	bool load(const char* filename);
+	//Asked for the screen position of each aim command. Returning false skips the touch.
+	void setAimTarget(std::function<bool(gef::Vector2&)> target);
+	//The key presses and new touches due on frame, in the order they were written
+	void getEvents(unsigned int frame, std::vector<InputEvent>& events);
+	unsigned int getCommandCount();
+private:
+	enum Action
+	{
+		PressKey,
+		Tap,
+		Aim
+	};
+	struct Command
+	{
+		//The frame for at, the period for every
+		unsigned int frame;
+		bool repeating;
+		Action action;
+		gef::Keyboard::KeyCode key;
+		gef::Vector2 position;
+	};
+
+	bool parseLine(const std::string& line, Command& command);
+	void addTouch(const gef::Vector2& position, std::vector<InputEvent>& events);
+
+	std::vector<Command> commands;
+	std::function<bool(gef::Vector2&)> aimTarget;
+	Int32 nextTouchID = 0;
+};
@@ -0,0 +1,143 @@
+#include "LaneMovementModel.h"
+#include "EnemyObject.h"
+#include "GameRules.h"
+#include <algorithm>
+
+LaneMovementModel::LaneMovementModel()
+{
+	walkSpeed = 0.0f;
+	stopX = 0.0f;
+	spacing = 0.0f;
+}
+
+void LaneMovementModel::setWalkSpeed(float value)
+{
+	walkSpeed = value;
+}
+
+void LaneMovementModel::setStopX(float value)
+{
+	stopX = value;
+}
+
+void LaneMovementModel::setSpacing(float value)
+{
+	spacing = value;
+}
+
+void LaneMovementModel::add(EnemyObject* enemy, int lane, float x)
+{
+	Lane& target = lanes[lane];
+
+	//Positions are sorted largest first, new spawns are nearly always behind everyone so this is normally an append
+	std::vector<float>::iterator slot = std::upper_bound(target.positions.begin(), target.positions.end(), x, [](float value, float element) { return value > element; });
+	unsigned int index = slot - target.positions.begin();
+	target.positions.insert(slot, x);
+	target.enemies.insert(target.enemies.begin() + index, enemy);
+}
+
+void LaneMovementModel::remove(EnemyObject* enemy)
+{
+	Lane& lane = lanes[enemy->getLane()];
+	for (unsigned int i = 0; i < lane.enemies.size(); i++)
+	{
+		if (lane.enemies[i] == enemy)
+		{
+			lane.enemies[i] = NULL;
+			removedCount++;
+			return;
+		}
+	}
+}
+
+void LaneMovementModel::update(float frame_time)
+{
+	const float step = walkSpeed * frame_time;
+	queuedCount = 0;
+	lanesAtHouse = 0;
+
+	for (int laneIndex = 0; laneIndex < laneCount; laneIndex++)
+	{
+		Lane& lane = lanes[laneIndex];
+		if (removedCount > 0)
+		{
+			compact(lane);
+		}
+
+		const unsigned int count = lane.positions.size();
+		if (count == 0)
+		{
+			continue;
+		}
+		float* positions = &lane.positions[0];
+
+		//Same walk and queue rules SessionSim plays by
+		bool atHouse = AdvanceLane(positions, count, step, stopX, spacing, [&](unsigned int i, bool queued)
+		{
+			if (queued)
+			{
+				queuedCount++;
+			}
+			EnemyObject* enemy = lane.enemies[i];
+			enemy->moveWithoutBody(positions[i]);
+			enemy->setStoppedMoving(queued);
+			enemy->setCollidingWithPlayer(queued && i == 0);
+		});
+
+		if (atHouse)
+		{
+			lanesAtHouse++;
+		}
+	}
+
+	removedCount = 0;
+}
+
+void LaneMovementModel::clear()
+{
+	for (int lane = 0; lane < laneCount; lane++)
+	{
+		lanes[lane].positions.clear();
+		lanes[lane].enemies.clear();
+	}
+	removedCount = 0;
+	queuedCount = 0;
+	lanesAtHouse = 0;
+}
+
+unsigned int LaneMovementModel::getEnemyCount()
+{
+	unsigned int count = 0;
+	for (int lane = 0; lane < laneCount; lane++)
+	{
+		count += lanes[lane].enemies.size();
+	}
+	return count - removedCount;
+}
+
+unsigned int LaneMovementModel::getQueuedCount()
+{
+	return queuedCount;
+}
+
+unsigned int LaneMovementModel::getLanesAtHouse()
+{
+	return lanesAtHouse;
+}
+
+void LaneMovementModel::compact(Lane& lane)
+{
+	//Keeps the order, so the lane stays sorted
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < lane.enemies.size(); i++)
+	{
+		if (lane.enemies[i])
+		{
+			lane.enemies[kept] = lane.enemies[i];
+			lane.positions[kept] = lane.positions[i];
+			kept++;
+		}
+	}
+	lane.enemies.resize(kept);
+	lane.positions.resize(kept);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+
+class EnemyObject;
+
+//Moves enemies along the five lanes without the physics solver.
+//Each lane keeps its enemies sorted front (nearest the house) to back, so queueing is a single pass per lane.
+class LaneMovementModel
+{
+public:
+	static const int laneCount = 5;
+	LaneMovementModel();
+	void setWalkSpeed(float value);
+	//Centre x an enemy stops at when it reaches the house
+	void setStopX(float value);
+	//Gap kept between queued enemies
+	void setSpacing(float value);
+	void add(EnemyObject* enemy, int lane, float x);
+	//Removed enemies are dropped from the lane on the next update
+	void remove(EnemyObject* enemy);
+	//Advance every lane and write the results back to the enemies
+	void update(float frame_time);
+	void clear();
+	unsigned int getEnemyCount();
+	unsigned int getQueuedCount();
+	//Number of lanes with an enemy pressed up against the house
+	unsigned int getLanesAtHouse();
+private:
+	struct Lane
+	{
+		std::vector<float> positions;
+		std::vector<EnemyObject*> enemies;
+	};
+	void compact(Lane& lane);
+	Lane lanes[laneCount];
+	float walkSpeed;
+	float stopX;
+	float spacing;
+	unsigned int removedCount = 0;
+	unsigned int queuedCount = 0;
+	unsigned int lanesAtHouse = 0;
+};
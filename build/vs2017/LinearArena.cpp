@@ -0,0 +1,108 @@
+#include "LinearArena.h"
+#include "PerfRecorder.h"
+
+LinearArena::LinearArena(size_t chunkBytes, MemoryTag tag) :
+	chunkSize(chunkBytes),
+	memoryTag(tag)
+{
+}
+
+LinearArena::~LinearArena()
+{
+	release();
+}
+
+void* LinearArena::allocate(size_t bytes, size_t alignment)
+{
+	//Try the current chunk, then the ones after it that were kept from before the last reset
+	while (currentChunk < chunks.size())
+	{
+		Chunk& chunk = chunks[currentChunk];
+		size_t start = (size_t)(((uintptr_t)chunk.memory + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (size_t)(uintptr_t)chunk.memory;
+		if (start + bytes <= chunk.size)
+		{
+			offset = start + bytes;
+			allocationCount++;
+			usedBytes += bytes;
+			if (usedBytes > peakBytes)
+			{
+				peakBytes = usedBytes;
+			}
+			return chunk.memory + start;
+		}
+		currentChunk++;
+		offset = 0;
+	}
+
+	//Oversized requests get a chunk of their own
+	Chunk chunk;
+	chunk.size = bytes + alignment > chunkSize ? bytes + alignment : chunkSize;
+	{
+		//Chunks are reused by every day after this one
+		ScopedMemoryTag tag(memoryTag);
+		ScopedLongLivedAllocations longLived;
+		chunk.memory = new char[chunk.size];
+	}
+	chunks.push_back(chunk);
+	currentChunk = (unsigned int)chunks.size() - 1;
+	offset = 0;
+	return allocate(bytes, alignment);
+}
+
+void LinearArena::reset()
+{
+	double startTime = PerfRecorder::nowMilliseconds();
+
+	for (size_t i = destructors.size(); i > 0; i--)
+	{
+		destructors[i - 1].destroy(destructors[i - 1].object);
+	}
+	destructors.clear();
+
+	currentChunk = 0;
+	offset = 0;
+	allocationCount = 0;
+	usedBytes = 0;
+	resetCount++;
+	lastResetMilliseconds = PerfRecorder::nowMilliseconds() - startTime;
+}
+
+void LinearArena::release()
+{
+	reset();
+	for (unsigned int i = 0; i < chunks.size(); i++)
+	{
+		delete[] chunks[i].memory;
+	}
+	chunks.clear();
+}
+
+unsigned int LinearArena::getAllocationCount()
+{
+	return allocationCount;
+}
+
+size_t LinearArena::getUsedBytes()
+{
+	return usedBytes;
+}
+
+size_t LinearArena::getPeakBytes()
+{
+	return peakBytes;
+}
+
+unsigned int LinearArena::getChunkCount()
+{
+	return (unsigned int)chunks.size();
+}
+
+unsigned int LinearArena::getResetCount()
+{
+	return resetCount;
+}
+
+double LinearArena::getLastResetMilliseconds()
+{
+	return lastResetMilliseconds;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "MemoryTracker.h"
+
+//Bump allocator for objects that all die at the same time, such as a day's enemies.
+//Objects are carved out of large chunks one after another and reset destroys them all at once.
+//Chunks are kept between resets, so after the first day nothing is allocated from the heap.
+class LinearArena
+{
+public:
+	LinearArena(size_t chunkBytes = 64 * 1024, MemoryTag tag = MEMORY_TAG_ENTITIES);
+	~LinearArena();
+
+	//Raw memory that lives until the next reset
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	//Construct an object in the arena. Its destructor runs on reset, newest object first.
+	template<typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			Destructor destructor;
+			destructor.object = object;
+			destructor.destroy = &destroyObject<T>;
+			destructors.push_back(destructor);
+		}
+		return object;
+	}
+
+	//Destroy everything in the arena and start again from the first chunk
+	void reset();
+	//Reset and hand the chunks back to the heap
+	void release();
+
+	unsigned int getAllocationCount();
+	size_t getUsedBytes();
+	size_t getPeakBytes();
+	unsigned int getChunkCount();
+	unsigned int getResetCount();
+	double getLastResetMilliseconds();
+private:
+	//Objects can't be copied out of the arena
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	struct Chunk
+	{
+		char* memory;
+		size_t size;
+	};
+	struct Destructor
+	{
+		void* object;
+		void (*destroy)(void*);
+	};
+	template<typename T>
+	static void destroyObject(void* object)
+	{
+		static_cast<T*>(object)->~T();
+	}
+
+	std::vector<Chunk> chunks;
+	std::vector<Destructor> destructors;
+	size_t chunkSize;
+	MemoryTag memoryTag;
+	unsigned int currentChunk = 0;
+	size_t offset = 0;
+	unsigned int allocationCount = 0;
+	size_t usedBytes = 0;
+	size_t peakBytes = 0;
+	unsigned int resetCount = 0;
+	double lastResetMilliseconds = 0.0;
+};
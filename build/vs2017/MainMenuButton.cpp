@@ -1,5 +1,5 @@
 #include "MainMenuButton.h"
-#include <system\debug_log.h>
+#include <system/debug_log.h>
 
 MainMenuButton::MainMenuButton(const char* pngFileName, gef::Platform* platform, std::string newType, b2World* world, b2Vec2 bodyPos)
 {
@@ -72,6 +72,12 @@ b2Body* MainMenuButton::getBody()
 	return body;
 }
 
+MainMenuButton::~MainMenuButton()
+{
+	delete icon;
+	icon = NULL;
+}
+
 gef::Texture* MainMenuButton::getIcon()
 {
 	return icon;
@@ -2,7 +2,7 @@
 
 #include <graphics/sprite.h>
 #include <load_texture.h>
-#include <box2d/box2d.h>
+#include <box2d/Box2D.h>
 
 namespace gef
 {
@@ -20,6 +20,7 @@ class MainMenuButton: public gef::Sprite
 {
 public:
 	MainMenuButton(const char* pngFileName, gef::Platform* platform, std::string newType, b2World* world, b2Vec2 bodyPos);
+	~MainMenuButton();
 	unsigned short int run(unsigned short int value);
 	b2Body* getBody();
 	gef::Texture* getIcon();
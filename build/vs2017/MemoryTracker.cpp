@@ -0,0 +1,349 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <system/debug_log.h>
+
+//Every allocation is preceded by this, padded so the memory handed out keeps malloc's alignment
+struct AllocationHeader
+{
+	size_t size;
+	unsigned int epoch;
+	unsigned short tag;
+};
+static const size_t headerSize = 16;
+static_assert(sizeof(AllocationHeader) <= headerSize, "Allocation header must fit in its padding");
+
+//Live bytes are kept for this many state epochs. A leak from a state this many transitions ago is counted against a newer one.
+static const unsigned int epochSlots = 64;
+//Epoch 0 is the application itself, and untagged allocations have no epoch
+static const unsigned int applicationEpoch = 0;
+static const unsigned int noEpoch = 0xffffffff;
+
+//Plain atomics at file scope are zero initialised before any constructor runs, so operator new can use them from the start
+static std::atomic<long long> tagBytes[MEMORY_TAG_COUNT];
+static std::atomic<long long> tagPeaks[MEMORY_TAG_COUNT];
+static std::atomic<unsigned int> tagLive[MEMORY_TAG_COUNT];
+static std::atomic<unsigned long long> totalAllocations;
+static std::atomic<long long> epochBytes[epochSlots];
+static std::atomic<unsigned int> epochLive[epochSlots];
+static std::atomic<unsigned int> currentEpoch;
+static unsigned int epochCounter = 0;
+static thread_local MemoryTag threadTag = MEMORY_TAG_UNTAGGED;
+static thread_local bool threadLongLived = false;
+
+static const char* tagNames[MEMORY_TAG_COUNT] = { "untagged", "physics", "assets", "entities", "audio", "ui" };
+
+#if MEMORY_TRACKING
+static void* TrackedAllocate(size_t size)
+{
+	AllocationHeader* header = (AllocationHeader*)malloc(size + headerSize);
+	if (header == NULL)
+		return NULL;
+
+	MemoryTag tag = threadTag;
+	header->size = size;
+	header->tag = (unsigned short)tag;
+	header->epoch = tag == MEMORY_TAG_UNTAGGED ? noEpoch : (threadLongLived ? applicationEpoch : currentEpoch.load(std::memory_order_relaxed));
+
+	long long bytes = tagBytes[tag].fetch_add(size, std::memory_order_relaxed) + (long long)size;
+	long long peak = tagPeaks[tag].load(std::memory_order_relaxed);
+	while (bytes > peak && !tagPeaks[tag].compare_exchange_weak(peak, bytes, std::memory_order_relaxed))
+	{
+	}
+	tagLive[tag].fetch_add(1, std::memory_order_relaxed);
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (header->epoch != noEpoch)
+	{
+		epochBytes[header->epoch % epochSlots].fetch_add(size, std::memory_order_relaxed);
+		epochLive[header->epoch % epochSlots].fetch_add(1, std::memory_order_relaxed);
+	}
+	return (char*)header + headerSize;
+}
+
+static void TrackedFree(void* pointer)
+{
+	if (pointer == NULL)
+		return;
+
+	AllocationHeader* header = (AllocationHeader*)((char*)pointer - headerSize);
+	tagBytes[header->tag].fetch_sub(header->size, std::memory_order_relaxed);
+	tagLive[header->tag].fetch_sub(1, std::memory_order_relaxed);
+	if (header->epoch != noEpoch)
+	{
+		epochBytes[header->epoch % epochSlots].fetch_sub(header->size, std::memory_order_relaxed);
+		epochLive[header->epoch % epochSlots].fetch_sub(1, std::memory_order_relaxed);
+	}
+	free(header);
+}
+
+void* operator new(size_t size)
+{
+	void* pointer = TrackedAllocate(size);
+	if (pointer == NULL)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	TrackedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	TrackedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	TrackedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	TrackedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	TrackedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	TrackedFree(pointer);
+}
+#endif
+
+MemoryTracker& MemoryTracker::instance()
+{
+	static MemoryTracker tracker;
+	return tracker;
+}
+
+const char* MemoryTracker::getTagName(MemoryTag tag)
+{
+	return tag < MEMORY_TAG_COUNT ? tagNames[tag] : "unknown";
+}
+
+void MemoryTracker::enterState(const char* name)
+{
+	if (stackDepth > 0)
+	{
+		endFrame(stack[stackDepth - 1], false);
+		stackDepth--;
+	}
+	beginFrame(name);
+}
+
+void MemoryTracker::pushState(const char* name)
+{
+	if (stackDepth > 0)
+	{
+		endFrame(stack[stackDepth - 1], true);
+	}
+	if (stackDepth == maxStackDepth)
+	{
+		gef::DebugOut("MemoryTracker: State stack is full, %s replaces %s\n", name, stack[stackDepth - 1].name);
+		stackDepth--;
+	}
+	beginFrame(name);
+}
+
+void MemoryTracker::popState()
+{
+	if (stackDepth == 0)
+	{
+		return;
+	}
+
+	endFrame(stack[stackDepth - 1], false);
+	stackDepth--;
+	if (stackDepth > 0)
+	{
+		//The state underneath carries on with its own epoch and a fresh high-water mark
+		currentEpoch = stack[stackDepth - 1].epoch;
+		for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+		{
+			tagPeaks[tag] = tagBytes[tag].load();
+		}
+	}
+	else
+	{
+		currentEpoch = applicationEpoch;
+	}
+}
+
+void MemoryTracker::beginFrame(const char* name)
+{
+	epochCounter++;
+	if (epochCounter % epochSlots == applicationEpoch)
+	{
+		epochCounter++;
+	}
+	//Bytes from an epoch that wrapped around are forgotten rather than blamed on the new state
+	epochBytes[epochCounter % epochSlots] = 0;
+	epochLive[epochCounter % epochSlots] = 0;
+
+	StateFrame& frame = stack[stackDepth++];
+	frame.name = name;
+	frame.epoch = epochCounter;
+	currentEpoch = epochCounter;
+	for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+	{
+		tagPeaks[tag] = tagBytes[tag].load();
+	}
+}
+
+//Peaks are the whole program's use while the state was on top, so states underneath count towards them
+void MemoryTracker::endFrame(const StateFrame& frame, bool suspended)
+{
+	StateRecord* record = findRecord(frame.name);
+	for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+	{
+		size_t peak = (size_t)tagPeaks[tag].load();
+		if (record && peak > record->peakBytes[tag])
+		{
+			record->peakBytes[tag] = peak;
+		}
+	}
+	checkBudgets(frame.name);
+
+	if (suspended)
+	{
+		return;
+	}
+
+	long long leakedBytes = epochBytes[frame.epoch % epochSlots].load();
+	unsigned int leakedAllocations = epochLive[frame.epoch % epochSlots].load();
+	if (leakedAllocations > 0)
+	{
+		gef::DebugOut("MemoryTracker: %s left %lld bytes in %u tagged allocations\n", frame.name, leakedBytes, leakedAllocations);
+	}
+}
+
+void MemoryTracker::checkBudgets(const char* stateName)
+{
+	for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+	{
+		size_t peak = (size_t)tagPeaks[tag].load();
+		if (budgets[tag] > 0 && peak > budgets[tag])
+		{
+			gef::DebugOut("MemoryTracker: %s went over the %s budget, %llu of %llu bytes\n", stateName, tagNames[tag], (unsigned long long)peak, (unsigned long long)budgets[tag]);
+			overBudget = true;
+		}
+	}
+}
+
+MemoryTracker::StateRecord* MemoryTracker::findRecord(const char* name)
+{
+	for (unsigned int i = 0; i < recordCount; i++)
+	{
+		if (strcmp(records[i].name, name) == 0)
+		{
+			return &records[i];
+		}
+	}
+	if (recordCount == maxStateNames)
+	{
+		return NULL;
+	}
+
+	StateRecord& record = records[recordCount++];
+	record.name = name;
+	memset(record.peakBytes, 0, sizeof(record.peakBytes));
+	return &record;
+}
+
+size_t MemoryTracker::getCurrentBytes(MemoryTag tag)
+{
+	return (size_t)tagBytes[tag].load();
+}
+
+size_t MemoryTracker::getPeakBytes(MemoryTag tag)
+{
+	return (size_t)tagPeaks[tag].load();
+}
+
+unsigned int MemoryTracker::getLiveAllocations(MemoryTag tag)
+{
+	return tagLive[tag].load();
+}
+
+unsigned long long MemoryTracker::getTotalAllocations()
+{
+	return totalAllocations.load();
+}
+
+void MemoryTracker::setBudget(MemoryTag tag, size_t bytes)
+{
+	budgets[tag] = bytes;
+}
+
+bool MemoryTracker::isOverBudget()
+{
+	return overBudget;
+}
+
+void MemoryTracker::resetBudgets()
+{
+	overBudget = false;
+}
+
+void MemoryTracker::report()
+{
+	//The state still running hasn't been ended, so fold its peaks in first
+	if (stackDepth > 0)
+	{
+		endFrame(stack[stackDepth - 1], true);
+	}
+
+	for (unsigned int i = 0; i < recordCount; i++)
+	{
+		const StateRecord& record = records[i];
+		gef::DebugOut("MemoryTracker: %s peak physics %llu, assets %llu, entities %llu, audio %llu, ui %llu, untagged %llu\n", record.name,
+			(unsigned long long)record.peakBytes[MEMORY_TAG_PHYSICS], (unsigned long long)record.peakBytes[MEMORY_TAG_ASSETS],
+			(unsigned long long)record.peakBytes[MEMORY_TAG_ENTITIES], (unsigned long long)record.peakBytes[MEMORY_TAG_AUDIO],
+			(unsigned long long)record.peakBytes[MEMORY_TAG_UI], (unsigned long long)record.peakBytes[MEMORY_TAG_UNTAGGED]);
+	}
+	gef::DebugOut("MemoryTracker: %llu allocations in total, %s\n", totalAllocations.load(), overBudget ? "OVER BUDGET" : "within budget");
+}
+
+ScopedMemoryTag::ScopedMemoryTag(MemoryTag tag) :
+	previousTag(threadTag)
+{
+	threadTag = tag;
+}
+
+ScopedMemoryTag::~ScopedMemoryTag()
+{
+	threadTag = previousTag;
+}
+
+ScopedLongLivedAllocations::ScopedLongLivedAllocations() :
+	previous(threadLongLived)
+{
+	threadLongLived = true;
+}
+
+ScopedLongLivedAllocations::~ScopedLongLivedAllocations()
+{
+	threadLongLived = previous;
+}
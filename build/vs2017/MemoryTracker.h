@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+
+//Set to 0 to build without the tracking operator new and delete
+#ifndef MEMORY_TRACKING
+#define MEMORY_TRACKING 1
+#endif
+
+//What an allocation is for, set with ScopedMemoryTag around the code that makes it
+enum MemoryTag
+{
+	MEMORY_TAG_UNTAGGED,
+	MEMORY_TAG_PHYSICS,
+	MEMORY_TAG_ASSETS,
+	MEMORY_TAG_ENTITIES,
+	MEMORY_TAG_AUDIO,
+	MEMORY_TAG_UI,
+	MEMORY_TAG_COUNT
+};
+
+//Counts every operator new by tag and by the game state that made it.
+//States are entered, pushed and popped alongside SceneApp's state stack. When a state ends,
+//its peak use per tag is logged along with any tagged allocations it made that are still alive.
+//Untagged allocations are counted but never reported as leaks, as per-frame containers keep their capacity on purpose.
+//Box2D allocates bodies and fixtures with malloc through b2Alloc, so only the b2World itself shows up under physics.
+class MemoryTracker
+{
+public:
+	static MemoryTracker& instance();
+	static const char* getTagName(MemoryTag tag);
+
+	//Replace the state on top of the stack, reporting the one that ended. Call between the old state's Release and the new one's Init.
+	void enterState(const char* name);
+	//Suspend the state on top and start a new one above it
+	void pushState(const char* name);
+	//End the state on top and carry on with the one underneath
+	void popState();
+
+	size_t getCurrentBytes(MemoryTag tag);
+	size_t getPeakBytes(MemoryTag tag);
+	unsigned int getLiveAllocations(MemoryTag tag);
+	unsigned long long getTotalAllocations();
+
+	//Zero means no budget. Going over one is remembered until resetBudgets.
+	void setBudget(MemoryTag tag, size_t bytes);
+	bool isOverBudget();
+	void resetBudgets();
+	//Log each state's high-water marks and any budgets that were broken
+	void report();
+private:
+	static const unsigned int maxStackDepth = 8;
+	static const unsigned int maxStateNames = 16;
+	struct StateFrame
+	{
+		const char* name;
+		unsigned int epoch;
+	};
+	struct StateRecord
+	{
+		const char* name;
+		size_t peakBytes[MEMORY_TAG_COUNT];
+	};
+
+	void beginFrame(const char* name);
+	void endFrame(const StateFrame& frame, bool suspended);
+	void checkBudgets(const char* stateName);
+	StateRecord* findRecord(const char* name);
+
+	//Fixed arrays, so the tracker never allocates while it is being called from operator new's callers
+	StateFrame stack[maxStackDepth];
+	unsigned int stackDepth = 0;
+	StateRecord records[maxStateNames];
+	unsigned int recordCount = 0;
+	size_t budgets[MEMORY_TAG_COUNT] = {};
+	bool overBudget = false;
+};
+
+//Tags allocations on this thread until the end of the scope
+class ScopedMemoryTag
+{
+public:
+	ScopedMemoryTag(MemoryTag tag);
+	~ScopedMemoryTag();
+private:
+	MemoryTag previousTag;
+};
+
+//Allocations in the scope are kept for the life of the application, such as pooled objects or weapon icons
+//shared across days, so they are not reported against the state that happened to make them
+class ScopedLongLivedAllocations
+{
+public:
+	ScopedLongLivedAllocations();
+	~ScopedLongLivedAllocations();
+private:
+	bool previous;
+};
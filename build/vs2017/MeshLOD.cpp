@@ -0,0 +1,294 @@
+#include "MeshLOD.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+#include <graphics/scene.h>
+#include <graphics/mesh_data.h>
+#include <graphics/primitive.h>
+#include <system/debug_log.h>
+#include "PerfRecorder.h"
+
+//Grid resolution along the longest axis for levels 1 and 2
+static const unsigned int lodGridCells[MeshLODSet::MaxLevels] = { 0, 24, 10 };
+//Smallest on-screen height in pixels that still gets levels 0 and 1, anything smaller gets the last level
+static const float lodMinPixels[MeshLODSet::MaxLevels - 1] = { 100.0f, 40.0f };
+
+MeshLODSet::MeshLODSet() :
+	levelCount(0),
+	radius(0.0f),
+	pixelsPerUnit(0.0f),
+	frameTriangles(0)
+{
+	for (unsigned int i = 0; i < MaxLevels; i++)
+	{
+		meshes[i] = NULL;
+		ownsMesh[i] = false;
+		triangleCounts[i] = 0;
+		frameInstances[i] = 0;
+	}
+}
+
+MeshLODSet::~MeshLODSet()
+{
+	release();
+}
+
+void MeshLODSet::build(gef::Platform& platform, gef::Scene* scene)
+{
+	release();
+	if (scene == NULL || scene->meshes.empty() || scene->mesh_data.empty())
+	{
+		return;
+	}
+
+	double startTime = PerfRecorder::nowMilliseconds();
+	const gef::MeshData& data = scene->mesh_data.front();
+	meshes[0] = scene->meshes.front();
+	radius = meshes[0]->bounding_sphere().radius();
+	levelCount = 1;
+	for (unsigned int i = 0; i < data.primitives.size(); i++)
+	{
+		triangleCounts[0] += data.primitives[i]->num_indices / 3;
+	}
+
+	//Skinned and otherwise custom vertex layouts are left at full detail
+	if (data.vertex_data.vertex_byte_size != sizeof(gef::Mesh::Vertex))
+	{
+		gef::DebugOut("MeshLODSet: Mesh does not use the static vertex layout, no LODs built\n");
+		return;
+	}
+
+	for (unsigned int level = 1; level < MaxLevels; level++)
+	{
+		unsigned int triangles = 0;
+		gef::Mesh* mesh = simplify(platform, meshes[0], data, lodGridCells[level], triangles);
+		//Stop once simplifying no longer removes anything
+		if (mesh == NULL || triangles >= triangleCounts[levelCount - 1])
+		{
+			delete mesh;
+			break;
+		}
+		meshes[levelCount] = mesh;
+		ownsMesh[levelCount] = true;
+		triangleCounts[levelCount] = triangles;
+		levelCount++;
+	}
+
+	gef::DebugOut("MeshLODSet: %u levels, triangles %u/%u/%u\n", levelCount, triangleCounts[0], triangleCounts[1], triangleCounts[2]);
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("MeshLOD/build", PerfRecorder::nowMilliseconds() - startTime);
+	}
+}
+
+gef::Mesh* MeshLODSet::simplify(gef::Platform& platform, gef::Mesh* source, const gef::MeshData& data, unsigned int gridCells, unsigned int& triangles)
+{
+	const gef::Mesh::Vertex* vertices = (const gef::Mesh::Vertex*)data.vertex_data.vertices;
+	unsigned int vertexCount = data.vertex_data.num_vertices;
+	if (vertexCount == 0)
+		return NULL;
+
+	//Cubic cells sized from the longest side of the bounds
+	float minimum[3] = { vertices[0].px, vertices[0].py, vertices[0].pz };
+	float maximum[3] = { vertices[0].px, vertices[0].py, vertices[0].pz };
+	for (unsigned int i = 1; i < vertexCount; i++)
+	{
+		const float position[3] = { vertices[i].px, vertices[i].py, vertices[i].pz };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], position[axis]);
+			maximum[axis] = std::max(maximum[axis], position[axis]);
+		}
+	}
+	float longest = std::max(maximum[0] - minimum[0], std::max(maximum[1] - minimum[1], maximum[2] - minimum[2]));
+	float cellSize = longest > 0.0f ? longest / gridCells : 1.0f;
+
+	//Average the vertices in each cell, keeping the UV of the first one in
+	std::unordered_map<unsigned long long, unsigned int> cellToCluster;
+	std::vector<unsigned int> vertexToCluster(vertexCount);
+	std::vector<gef::Mesh::Vertex> clusters;
+	std::vector<unsigned int> clusterSizes;
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const gef::Mesh::Vertex& vertex = vertices[i];
+		unsigned long long x = (unsigned long long)((vertex.px - minimum[0]) / cellSize);
+		unsigned long long y = (unsigned long long)((vertex.py - minimum[1]) / cellSize);
+		unsigned long long z = (unsigned long long)((vertex.pz - minimum[2]) / cellSize);
+		unsigned long long cell = (x << 42) | (y << 21) | z;
+
+		std::unordered_map<unsigned long long, unsigned int>::iterator found = cellToCluster.find(cell);
+		if (found == cellToCluster.end())
+		{
+			cellToCluster[cell] = (unsigned int)clusters.size();
+			vertexToCluster[i] = (unsigned int)clusters.size();
+			clusters.push_back(vertex);
+			clusterSizes.push_back(1);
+		}
+		else
+		{
+			gef::Mesh::Vertex& cluster = clusters[found->second];
+			cluster.px += vertex.px;
+			cluster.py += vertex.py;
+			cluster.pz += vertex.pz;
+			cluster.nx += vertex.nx;
+			cluster.ny += vertex.ny;
+			cluster.nz += vertex.nz;
+			clusterSizes[found->second]++;
+			vertexToCluster[i] = found->second;
+		}
+	}
+
+	for (unsigned int i = 0; i < clusters.size(); i++)
+	{
+		gef::Mesh::Vertex& cluster = clusters[i];
+		float count = (float)clusterSizes[i];
+		cluster.px /= count;
+		cluster.py /= count;
+		cluster.pz /= count;
+		float length = sqrtf(cluster.nx * cluster.nx + cluster.ny * cluster.ny + cluster.nz * cluster.nz);
+		if (length > 0.0f)
+		{
+			cluster.nx /= length;
+			cluster.ny /= length;
+			cluster.nz /= length;
+		}
+	}
+
+	//Remap every triangle list, dropping triangles that collapsed or now repeat another
+	std::vector<std::vector<unsigned int> > primitiveIndices(data.primitives.size());
+	std::unordered_set<unsigned long long> seenTriangles;
+	triangles = 0;
+	for (unsigned int p = 0; p < data.primitives.size(); p++)
+	{
+		const gef::PrimitiveData* primitive = data.primitives[p];
+		if (primitive->type != gef::TRIANGLE_LIST)
+		{
+			return NULL;
+		}
+
+		for (UInt32 i = 0; i + 2 < primitive->num_indices; i += 3)
+		{
+			unsigned int corner[3];
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int index = primitive->index_byte_size == 2
+					? ((const unsigned short*)primitive->indices)[i + c]
+					: ((const unsigned int*)primitive->indices)[i + c];
+				corner[c] = vertexToCluster[index];
+			}
+			if (corner[0] == corner[1] || corner[1] == corner[2] || corner[0] == corner[2])
+				continue;
+
+			unsigned long long sorted[3] = { corner[0], corner[1], corner[2] };
+			std::sort(sorted, sorted + 3);
+			if (!seenTriangles.insert((sorted[0] << 42) | (sorted[1] << 21) | sorted[2]).second)
+				continue;
+
+			primitiveIndices[p].insert(primitiveIndices[p].end(), corner, corner + 3);
+			triangles++;
+		}
+	}
+
+	//Primitives that lost every triangle are left out rather than given an empty index buffer
+	UInt32 primitiveCount = 0;
+	for (unsigned int p = 0; p < primitiveIndices.size(); p++)
+	{
+		if (!primitiveIndices[p].empty())
+			primitiveCount++;
+	}
+	if (primitiveCount == 0)
+		return NULL;
+
+	gef::Mesh* mesh = new gef::Mesh(platform);
+	mesh->InitVertexBuffer(platform, clusters.data(), (UInt32)clusters.size(), sizeof(gef::Mesh::Vertex));
+	mesh->AllocatePrimitives(primitiveCount);
+	UInt32 next = 0;
+	for (unsigned int p = 0; p < primitiveIndices.size(); p++)
+	{
+		if (primitiveIndices[p].empty())
+			continue;
+
+		gef::Primitive* primitive = mesh->GetPrimitive(next++);
+		primitive->set_type(gef::TRIANGLE_LIST);
+		primitive->set_material(source->GetPrimitive(p)->material());
+		primitive->InitIndexBuffer(platform, primitiveIndices[p].data(), (UInt32)primitiveIndices[p].size(), sizeof(unsigned int));
+	}
+	mesh->set_aabb(source->aabb());
+	mesh->set_bounding_sphere(source->bounding_sphere());
+	return mesh;
+}
+
+void MeshLODSet::release()
+{
+	for (unsigned int i = 0; i < MaxLevels; i++)
+	{
+		if (ownsMesh[i])
+		{
+			delete meshes[i];
+		}
+		meshes[i] = NULL;
+		ownsMesh[i] = false;
+		triangleCounts[i] = 0;
+	}
+	levelCount = 0;
+}
+
+unsigned int MeshLODSet::getLevelCount()
+{
+	return levelCount;
+}
+
+gef::Mesh* MeshLODSet::getMesh(unsigned int level)
+{
+	return level < levelCount ? meshes[level] : NULL;
+}
+
+unsigned int MeshLODSet::getTriangleCount(unsigned int level)
+{
+	return level < levelCount ? triangleCounts[level] : 0;
+}
+
+void MeshLODSet::setCamera(const gef::Vector4& eye, float fovY, float screenHeight)
+{
+	cameraEye = eye;
+	pixelsPerUnit = screenHeight / (2.0f * tanf(fovY * 0.5f));
+}
+
+gef::Mesh* MeshLODSet::select(const gef::Vector4& position, float scale)
+{
+	if (levelCount == 0)
+		return NULL;
+
+	float distance = (position - cameraEye).Length();
+	float pixels = distance > 0.0f ? 2.0f * radius * scale * pixelsPerUnit / distance : pixelsPerUnit;
+
+	unsigned int level = 0;
+	while (level + 1 < levelCount && pixels < lodMinPixels[level])
+	{
+		level++;
+	}
+
+	frameTriangles += triangleCounts[level];
+	frameInstances[level]++;
+	return meshes[level];
+}
+
+void MeshLODSet::beginFrame()
+{
+	frameTriangles = 0;
+	for (unsigned int i = 0; i < MaxLevels; i++)
+	{
+		frameInstances[i] = 0;
+	}
+}
+
+unsigned int MeshLODSet::getFrameTriangles()
+{
+	return frameTriangles;
+}
+
+unsigned int MeshLODSet::getFrameInstances(unsigned int level)
+{
+	return level < MaxLevels ? frameInstances[level] : 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <graphics/mesh.h>
+#include <maths/vector4.h>
+
+namespace gef
+{
+	class Platform;
+	class Scene;
+	class MeshData;
+}
+
+//Simplified versions of a scene mesh for objects that are drawn small and often.
+//Levels past the first are built at load by vertex clustering: vertices are snapped to a grid,
+//each occupied cell becomes one vertex and triangles that collapse are dropped.
+class MeshLODSet
+{
+public:
+	static const unsigned int MaxLevels = 3;
+
+	MeshLODSet();
+	~MeshLODSet();
+	//Level 0 is the scene's first mesh and stays owned by the scene. Only static meshes are simplified.
+	void build(gef::Platform& platform, gef::Scene* scene);
+	void release();
+	unsigned int getLevelCount();
+	gef::Mesh* getMesh(unsigned int level);
+	unsigned int getTriangleCount(unsigned int level);
+
+	//Camera values used to turn a world size into a height on screen, set once per frame
+	void setCamera(const gef::Vector4& eye, float fovY, float screenHeight);
+	//Pick the level for an object whose mesh is scaled by scale at position, and count what it will draw
+	gef::Mesh* select(const gef::Vector4& position, float scale);
+	void beginFrame();
+	unsigned int getFrameTriangles();
+	unsigned int getFrameInstances(unsigned int level);
+private:
+	gef::Mesh* simplify(gef::Platform& platform, gef::Mesh* source, const gef::MeshData& data, unsigned int gridCells, unsigned int& triangles);
+
+	gef::Mesh* meshes[MaxLevels];
+	bool ownsMesh[MaxLevels];
+	unsigned int triangleCounts[MaxLevels];
+	unsigned int levelCount;
+	float radius;
+	gef::Vector4 cameraEye;
+	//Screen pixels covered by one world unit at distance one
+	float pixelsPerUnit;
+	unsigned int frameTriangles;
+	unsigned int frameInstances[MaxLevels];
+};
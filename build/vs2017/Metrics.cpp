@@ -0,0 +1,234 @@
+#include "Metrics.h"
+#include <system/debug_log.h>
+#include "PerfRecorder.h"
+#include "MemoryTracker.h"
+#include "TemporaryFile.h"
+
+bool MetricsRegistry::enabled = false;
+
+unsigned long long MetricCounter::get()
+{
+	return count.load(std::memory_order_relaxed);
+}
+
+double MetricGauge::get()
+{
+	return value.load(std::memory_order_relaxed);
+}
+
+MetricHistogram::MetricHistogram(const double* newBounds, unsigned int count)
+{
+	boundCount = count < maxBuckets ? count : maxBuckets;
+	for (unsigned int i = 0; i < boundCount; i++)
+	{
+		bounds[i] = newBounds[i];
+	}
+	for (unsigned int i = 0; i <= maxBuckets; i++)
+	{
+		counts[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void MetricHistogram::add(double value)
+{
+	unsigned int bucket = 0;
+	while (bucket < boundCount && value > bounds[bucket])
+	{
+		bucket++;
+	}
+	counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+	double current = sum.load(std::memory_order_relaxed);
+	while (sum.compare_exchange_weak(current, current + value, std::memory_order_relaxed) == false)
+	{
+	}
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		switch (entries[i].type)
+		{
+		case Counter:
+			delete (MetricCounter*)entries[i].metric;
+			break;
+		case Gauge:
+			delete (MetricGauge*)entries[i].metric;
+			break;
+		case Histogram:
+			delete (MetricHistogram*)entries[i].metric;
+			break;
+		}
+	}
+}
+
+MetricsRegistry::Entry* MetricsRegistry::find(const char* name, const std::string& labels)
+{
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].name == name && entries[i].labels == labels)
+		{
+			return &entries[i];
+		}
+	}
+	return NULL;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::add(const char* name, const char* help, const std::string& labels, MetricType type, void* metric)
+{
+	Entry entry;
+	entry.name = name;
+	entry.help = help;
+	entry.labels = labels;
+	entry.type = type;
+	entry.metric = metric;
+	entries.push_back(entry);
+	return entries.back();
+}
+
+MetricCounter& MetricsRegistry::counter(const char* name, const char* help, const std::string& labels)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	//Metrics live for the whole run, whichever state registered them
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UNTAGGED);
+	Entry* entry = find(name, labels);
+	if (entry == NULL)
+	{
+		entry = &add(name, help, labels, Counter, new MetricCounter());
+	}
+	return *(MetricCounter*)entry->metric;
+}
+
+MetricGauge& MetricsRegistry::gauge(const char* name, const char* help, const std::string& labels)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UNTAGGED);
+	Entry* entry = find(name, labels);
+	if (entry == NULL)
+	{
+		entry = &add(name, help, labels, Gauge, new MetricGauge());
+	}
+	return *(MetricGauge*)entry->metric;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const char* name, const char* help, const double* bounds, unsigned int boundCount)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UNTAGGED);
+	Entry* entry = find(name, "");
+	if (entry == NULL)
+	{
+		entry = &add(name, help, "", Histogram, new MetricHistogram(bounds, boundCount));
+	}
+	return *(MetricHistogram*)entry->metric;
+}
+
+void MetricsRegistry::enable(const char* filename, double intervalMilliseconds)
+{
+	outputFilename = filename;
+	flushInterval = intervalMilliseconds;
+	lastFlushTime = PerfRecorder::nowMilliseconds();
+	enabled = true;
+}
+
+void MetricsRegistry::disable()
+{
+	enabled = false;
+}
+
+void MetricsRegistry::update()
+{
+	if (enabled == false)
+	{
+		return;
+	}
+
+	double now = PerfRecorder::nowMilliseconds();
+	if (now - lastFlushTime >= flushInterval)
+	{
+		write(outputFilename.c_str());
+		lastFlushTime = now;
+	}
+}
+
+void MetricsRegistry::writeEntry(FILE* file, const Entry& entry)
+{
+	const char* name = entry.name.c_str();
+	const char* labels = entry.labels.c_str();
+	switch (entry.type)
+	{
+	case Counter:
+		fprintf(file, entry.labels.empty() ? "%s%s %llu\n" : "%s{%s} %llu\n", name, labels, ((MetricCounter*)entry.metric)->get());
+		break;
+	case Gauge:
+		fprintf(file, entry.labels.empty() ? "%s%s %.17g\n" : "%s{%s} %.17g\n", name, labels, ((MetricGauge*)entry.metric)->get());
+		break;
+	case Histogram:
+	{
+		MetricHistogram* histogram = (MetricHistogram*)entry.metric;
+		//Prometheus buckets are cumulative
+		unsigned long long total = 0;
+		for (unsigned int i = 0; i < histogram->boundCount; i++)
+		{
+			total += histogram->counts[i].load(std::memory_order_relaxed);
+			fprintf(file, "%s_bucket{le=\"%.17g\"} %llu\n", name, histogram->bounds[i], total);
+		}
+		total += histogram->counts[histogram->boundCount].load(std::memory_order_relaxed);
+		fprintf(file, "%s_bucket{le=\"+Inf\"} %llu\n", name, total);
+		fprintf(file, "%s_sum %.17g\n", name, histogram->sum.load(std::memory_order_relaxed));
+		fprintf(file, "%s_count %llu\n", name, total);
+		break;
+	}
+	}
+}
+
+bool MetricsRegistry::write(const char* filename)
+{
+	static const char* typeNames[] = { "counter", "gauge", "histogram" };
+
+	std::string temporaryFilename = std::string(filename) + ".tmp";
+	FILE* file = fopen(temporaryFilename.c_str(), "w");
+	if (file == NULL)
+	{
+		gef::DebugOut("Metrics: Could not write %s\n", temporaryFilename.c_str());
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		//HELP and TYPE go once per name, ahead of every labelled series with that name
+		std::vector<bool> written(entries.size(), false);
+		for (unsigned int i = 0; i < entries.size(); i++)
+		{
+			if (written[i])
+				continue;
+
+			fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", entries[i].name.c_str(), entries[i].help.c_str(), entries[i].name.c_str(), typeNames[entries[i].type]);
+			for (unsigned int j = i; j < entries.size(); j++)
+			{
+				if (written[j] == false && entries[j].name == entries[i].name)
+				{
+					writeEntry(file, entries[j]);
+					written[j] = true;
+				}
+			}
+		}
+	}
+	fclose(file);
+
+	//Replaced in one step so a scraper never finds the file missing
+	if (CommitTemporaryFile(temporaryFilename.c_str(), filename, false) == false)
+	{
+		gef::DebugOut("Metrics: Could not replace %s\n", filename);
+		remove(temporaryFilename.c_str());
+		return false;
+	}
+	return true;
+}
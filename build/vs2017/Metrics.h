@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MetricsRegistry;
+
+//Only written to while the registry is enabled, so instrumented code pays one flag check otherwise
+class MetricCounter
+{
+public:
+	inline void add(unsigned long long value = 1);
+	unsigned long long get();
+private:
+	std::atomic<unsigned long long> count{ 0 };
+};
+
+class MetricGauge
+{
+public:
+	inline void set(double value);
+	double get();
+private:
+	std::atomic<double> value{ 0.0 };
+};
+
+//Counts observations into fixed buckets. bounds are the buckets' upper edges in increasing order.
+class MetricHistogram
+{
+public:
+	static const unsigned int maxBuckets = 16;
+	MetricHistogram(const double* bounds, unsigned int count);
+	inline void observe(double value);
+private:
+	friend class MetricsRegistry;
+	void add(double value);
+
+	double bounds[maxBuckets];
+	unsigned int boundCount;
+	//One more than the bounds for everything above the last
+	std::atomic<unsigned long long> counts[maxBuckets + 1];
+	std::atomic<double> sum{ 0.0 };
+};
+
+//Named counters, gauges and histograms that are written out in Prometheus' text format,
+//to a file a textfile collector can scrape or that can simply be watched while the game runs.
+//Asking for a name and labels that are already registered returns the same metric, so it is safe to look one up on a rare event.
+//Metrics are never unregistered and the references stay valid for the whole run.
+class MetricsRegistry
+{
+public:
+	static MetricsRegistry& instance();
+	static inline bool isEnabled() { return enabled; }
+
+	//labels are in Prometheus form without the braces, e.g. item="Health"
+	MetricCounter& counter(const char* name, const char* help, const std::string& labels = "");
+	MetricGauge& gauge(const char* name, const char* help, const std::string& labels = "");
+	MetricHistogram& histogram(const char* name, const char* help, const double* bounds, unsigned int boundCount);
+
+	//Start collecting and write filename every intervalMilliseconds from update
+	void enable(const char* filename, double intervalMilliseconds);
+	void disable();
+	//Call once a frame. Writes the file when the interval is up, and does nothing while disabled.
+	void update();
+	//Written to a temporary file and renamed over filename, so readers never see half a file
+	bool write(const char* filename);
+private:
+	enum MetricType
+	{
+		Counter,
+		Gauge,
+		Histogram
+	};
+	struct Entry
+	{
+		std::string name;
+		std::string help;
+		std::string labels;
+		MetricType type;
+		void* metric;
+	};
+
+	MetricsRegistry() {}
+	~MetricsRegistry();
+	Entry* find(const char* name, const std::string& labels);
+	Entry& add(const char* name, const char* help, const std::string& labels, MetricType type, void* metric);
+	void writeEntry(FILE* file, const Entry& entry);
+
+	static bool enabled;
+	std::mutex lock;
+	std::vector<Entry> entries;
+	std::string outputFilename;
+	double flushInterval = 1000.0;
+	double lastFlushTime = 0.0;
+};
+
+inline void MetricCounter::add(unsigned long long value)
+{
+	if (MetricsRegistry::isEnabled())
+	{
+		count.fetch_add(value, std::memory_order_relaxed);
+	}
+}
+
+inline void MetricGauge::set(double newValue)
+{
+	if (MetricsRegistry::isEnabled())
+	{
+		value.store(newValue, std::memory_order_relaxed);
+	}
+}
+
+inline void MetricHistogram::observe(double value)
+{
+	if (MetricsRegistry::isEnabled())
+	{
+		add(value);
+	}
+}
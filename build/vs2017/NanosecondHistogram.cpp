@@ -0,0 +1,39 @@
+#include "NanosecondHistogram.h"
+#include <algorithm>
+
+void NanosecondHistogram::add(unsigned long long nanoseconds)
+{
+	unsigned int bucket = 0;
+	while (bucket + 1 < bucketCount && (nanoseconds >> (bucket + 1)) != 0)
+	{
+		bucket++;
+	}
+	buckets[bucket]++;
+	count++;
+	maxNanoseconds = std::max(maxNanoseconds, nanoseconds);
+}
+
+void NanosecondHistogram::merge(const NanosecondHistogram& other)
+{
+	for (unsigned int i = 0; i < bucketCount; i++)
+	{
+		buckets[i] += other.buckets[i];
+	}
+	count += other.count;
+	maxNanoseconds = std::max(maxNanoseconds, other.maxNanoseconds);
+}
+
+unsigned long long NanosecondHistogram::percentile(double fraction) const
+{
+	unsigned long long target = (unsigned long long)(fraction * count);
+	unsigned long long seen = 0;
+	for (unsigned int i = 0; i < bucketCount; i++)
+	{
+		seen += buckets[i];
+		if (seen > target)
+		{
+			return std::min(2ull << i, maxNanoseconds);
+		}
+	}
+	return maxNanoseconds;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+//Counts durations in power of two nanosecond buckets, for frame costs and queue latencies
+struct NanosecondHistogram
+{
+	static const unsigned int bucketCount = 40;
+	unsigned long long buckets[bucketCount] = { 0 };
+	unsigned long long count = 0;
+	unsigned long long maxNanoseconds = 0;
+
+	void add(unsigned long long nanoseconds);
+	void merge(const NanosecondHistogram& other);
+	//Upper edge of the bucket the fraction falls in
+	unsigned long long percentile(double fraction) const;
+};
@@ -0,0 +1,171 @@
+#include "PerfRecorder.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cstdio>
+
+PerfRecorder& PerfRecorder::instance()
+{
+	static PerfRecorder recorder;
+	return recorder;
+}
+
+void PerfRecorder::setEnabled(bool value)
+{
+	enabled = value;
+}
+
+bool PerfRecorder::isEnabled()
+{
+	return enabled;
+}
+
+void PerfRecorder::addSample(const std::string& scenario, double milliseconds)
+{
+	if (enabled == false)
+	{
+		return;
+	}
+	//Samples are kept for the whole run, whatever was being timed
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UNTAGGED);
+	samples[scenario].push_back(milliseconds);
+}
+
+void PerfRecorder::addCount(const std::string& name, unsigned int value)
+{
+	if (enabled == false)
+	{
+		return;
+	}
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UNTAGGED);
+	counts[name].push_back(value);
+}
+
+unsigned int PerfRecorder::getSampleCount(const std::string& scenario)
+{
+	std::map<std::string, std::vector<double> >::iterator found = samples.find(scenario);
+	if (found == samples.end())
+	{
+		return 0;
+	}
+	return found->second.size();
+}
+
+double PerfRecorder::getMean(const std::string& scenario)
+{
+	std::map<std::string, std::vector<double> >::iterator found = samples.find(scenario);
+	if (found == samples.end() || found->second.empty())
+	{
+		return 0.0;
+	}
+
+	double total = 0.0;
+	for (unsigned int i = 0; i < found->second.size(); i++)
+	{
+		total += found->second[i];
+	}
+	return total / found->second.size();
+}
+
+bool PerfRecorder::writeJSON(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\n  \"scenarios\": [");
+
+	bool first = true;
+	for (std::map<std::string, std::vector<double> >::iterator it = samples.begin(); it != samples.end(); ++it)
+	{
+		std::vector<double> sorted = it->second;
+		if (sorted.empty())
+		{
+			continue;
+		}
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (unsigned int i = 0; i < sorted.size(); i++)
+		{
+			total += sorted[i];
+		}
+
+		fprintf(file, "%s\n    {\"name\": \"%s\", \"samples\": %u, \"total_ms\": %.6f, \"mean_ms\": %.6f, \"min_ms\": %.6f, \"p50_ms\": %.6f, \"p95_ms\": %.6f, \"max_ms\": %.6f}",
+			first ? "" : ",",
+			it->first.c_str(),
+			(unsigned int)sorted.size(),
+			total,
+			total / sorted.size(),
+			sorted.front(),
+			sorted[sorted.size() / 2],
+			sorted[(sorted.size() * 95) / 100],
+			sorted.back());
+		first = false;
+	}
+
+	fprintf(file, "\n  ],\n  \"counts\": [");
+
+	first = true;
+	for (std::map<std::string, std::vector<unsigned int> >::iterator it = counts.begin(); it != counts.end(); ++it)
+	{
+		std::vector<unsigned int> sorted = it->second;
+		if (sorted.empty())
+		{
+			continue;
+		}
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (unsigned int i = 0; i < sorted.size(); i++)
+		{
+			total += sorted[i];
+		}
+
+		fprintf(file, "%s\n    {\"name\": \"%s\", \"samples\": %u, \"mean\": %.3f, \"min\": %u, \"p50\": %u, \"p95\": %u, \"max\": %u}",
+			first ? "" : ",",
+			it->first.c_str(),
+			(unsigned int)sorted.size(),
+			total / sorted.size(),
+			sorted.front(),
+			sorted[sorted.size() / 2],
+			sorted[(sorted.size() * 95) / 100],
+			sorted.back());
+		first = false;
+	}
+
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+	return true;
+}
+
+void PerfRecorder::reset()
+{
+	samples.clear();
+	counts.clear();
+}
+
+double PerfRecorder::nowMilliseconds()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ScopedPerfTimer::ScopedPerfTimer(const char* scenario)
+{
+	name = scenario;
+	startTime = 0.0;
+	active = PerfRecorder::instance().isEnabled();
+	if (active)
+	{
+		startTime = PerfRecorder::nowMilliseconds();
+	}
+}
+
+ScopedPerfTimer::~ScopedPerfTimer()
+{
+	if (active)
+	{
+		PerfRecorder::instance().addSample(name, PerfRecorder::nowMilliseconds() - startTime);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+//Collects timing samples for named scenarios and writes a JSON summary so runs can be compared across commits.
+//Recording is off until setEnabled(true) so normal play pays nothing but a flag check.
+class PerfRecorder
+{
+public:
+	static PerfRecorder& instance();
+	void setEnabled(bool value);
+	bool isEnabled();
+	void addSample(const std::string& scenario, double milliseconds);
+	//Per frame quantities that are not times, written to their own section
+	void addCount(const std::string& name, unsigned int value);
+	unsigned int getSampleCount(const std::string& scenario);
+	double getMean(const std::string& scenario);
+	bool writeJSON(const char* filename);
+	void reset();
+	static double nowMilliseconds();
+private:
+	std::map<std::string, std::vector<double> > samples;
+	std::map<std::string, std::vector<unsigned int> > counts;
+	bool enabled = false;
+};
+
+//Times the enclosing scope into a PerfRecorder scenario.
+//Takes a literal so nothing is allocated while recording is disabled.
+class ScopedPerfTimer
+{
+public:
+	ScopedPerfTimer(const char* scenario);
+	~ScopedPerfTimer();
+private:
+	const char* name;
+	double startTime;
+	bool active;
+};
@@ -1,5 +1,6 @@
 #include "PlayerData.h"
-#include <system\debug_log.h>
+#include <system/debug_log.h>
+#include <cstring>
 
 int PlayerData::getHealth()
 {
@@ -21,11 +22,51 @@ void PlayerData::decrementCredits(int value)
 	credits = credits - value;
 }
 
+bool PlayerData::spendCredits(int cost)
+{
+	if (credits - cost < 0)
+	{
+		return false;
+	}
+	credits = credits - cost;
+	return true;
+}
+
+bool PlayerData::buyHealthPack(int cost)
+{
+	if (spendCredits(cost) == false)
+	{
+		return false;
+	}
+	addHealth(healthPackHealth);
+	return true;
+}
+
+bool PlayerData::buyRifleman(int cost)
+{
+	if (spendCredits(cost) == false)
+	{
+		return false;
+	}
+	addRiflemen(1);
+	return true;
+}
+
+bool PlayerData::buyRepairGuy(int cost)
+{
+	if (spendCredits(cost) == false)
+	{
+		return false;
+	}
+	addRepairGuys(1);
+	return true;
+}
+
 void PlayerData::decrementHealth(float time, int value)
 {
-	if (lastDamageTime + 0.5f <= time)
+	if (lastDamageTime + playerDamageInterval <= time)
 	{
-		//We last took damge 0.5 seconds ago, deal damage.
+		//We last took damge long enough ago, deal damage.
 		health--;
 		lastDamageTime = time;
 	}
@@ -40,17 +81,17 @@ Weapon PlayerData::getActiveWeapon()
 void PlayerData::addWeapon(Weapon newWeapon)
 {
 	//Check all the data before we push it
-	if (newWeapon.getAmmo() == NULL)
+	if (newWeapon.getAmmo() == 0)
 	{
 		gef::DebugOut("ERROR: Weapon has a null ammo count!");
 		return;
 	}
-	else if (newWeapon.getCost() == NULL)
+	else if (newWeapon.getCost() == 0)
 	{
 		gef::DebugOut("ERROR: Weapon has a null cost!");
 		return;
 	}
-	else if(newWeapon.getDamage() == NULL)
+	else if(newWeapon.getDamage() == 0)
 	{
 		gef::DebugOut("ERROR: Weapon has a null damage count!");
 		return;
@@ -60,12 +101,12 @@ void PlayerData::addWeapon(Weapon newWeapon)
 		gef::DebugOut("ERROR: Weapon has a null icon!");
 		return;
 	}
-	else if (newWeapon.getReloadTime() == NULL)
+	else if (newWeapon.getReloadTime() == 0)
 	{
 		gef::DebugOut("ERROR: Weapon has a null reload time!");
 		return;
 	}
-	else if (newWeapon.getName() == "")
+	else if (newWeapon.getName()[0] == '\0')
 	{
 		gef::DebugOut("ERROR: Weapon has a null name!");
 		return;
@@ -75,17 +116,19 @@ void PlayerData::addWeapon(Weapon newWeapon)
 	return;
 }
 
-void PlayerData::setActiveWeapon(char* name)
+bool PlayerData::setActiveWeapon(const char* name)
 {
 	for (unsigned int i = 0; i < weapons.size(); i++)
 	{
-		if (weapons[i].getName() == name)
+		if (strcmp(weapons[i].getName(), name) == 0)
 		{
 			activeWeapon = weapons[i];
+			return true;
 		}
 	}
 
-	gef::DebugOut("ERROR: Unable to set active weapon!\n");
+	gef::DebugOut("ERROR: Unable to set active weapon %s!\n", name);
+	return false;
 }
 
 void PlayerData::removeMostRecentWeapon()
@@ -95,9 +138,9 @@ void PlayerData::removeMostRecentWeapon()
 
 void PlayerData::addHealth(int value)
 {
-	if (health + value > 100)
+	if (health + value > playerMaxHealth)
 	{
-		health = 100;
+		health = playerMaxHealth;
 	}
 	else
 	{
@@ -130,18 +173,23 @@ void PlayerData::setLastDamageTime(float value)
 	lastDamageTime = value;
 }
 
+float PlayerData::getLastDamageTime()
+{
+	return lastDamageTime;
+}
+
 unsigned int PlayerData::getWeaponsSize()
 {
 	return weapons.size();
 }
 
-bool PlayerData::hasWeapon(char* weaponName)
+bool PlayerData::hasWeapon(const char* weaponName)
 {
 	bool found = false;
 
 	for (unsigned int i = 0; i < weapons.size(); i++)
 	{
-		if (weapons[i].getName() == weaponName)
+		if (strcmp(weapons[i].getName(), weaponName) == 0)
 		{
 			found = true;
 			return found;
@@ -156,8 +204,16 @@ void PlayerData::resetData()
 	credits = 0;
 	weapons.clear();
 	weapons.shrink_to_fit();
-	health = 100;
+	health = playerMaxHealth;
 	lastDamageTime = 0.0f;
 	riflemen = 0;
 	repairGuys = 0;
 }
+
+void PlayerData::restore(int newCredits, int newHealth, unsigned short int newRiflemen, unsigned short int newRepairGuys)
+{
+	credits = newCredits;
+	health = newHealth;
+	riflemen = newRiflemen;
+	repairGuys = newRepairGuys;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <Weapon.h>
+#include "GameBalance.h"
 class PlayerData
 {
 public:
@@ -8,10 +9,17 @@ public:
 	int getCredits();
 	void addCredits(int value);
 	void decrementCredits(int value);
+	//Takes cost if the player can afford it. False, leaving the credits alone, if they can't.
+	bool spendCredits(int cost);
+	//Store purchases, false without changing anything if the player can't afford cost
+	bool buyHealthPack(int cost);
+	bool buyRifleman(int cost);
+	bool buyRepairGuy(int cost);
 	void decrementHealth(float time, int value);
 	Weapon getActiveWeapon();
 	void addWeapon(Weapon newWeapon);
-	void setActiveWeapon(char* name);
+	//False if the player doesn't own a weapon with that name, leaving the active weapon as it was
+	bool setActiveWeapon(const char* name);
 	void removeMostRecentWeapon();
 	void addHealth(int value);
 	void addRiflemen(int value);
@@ -19,14 +27,17 @@ public:
 	void addRepairGuys(int value);
 	unsigned short int getReapirGuys();
 	void setLastDamageTime(float value);
+	float getLastDamageTime();
 	unsigned int getWeaponsSize();
-	bool hasWeapon(char* weaponName);
+	bool hasWeapon(const char* weaponName);
 	void resetData();
+	//Put back what a snapshot saved, weapons are added separately with addWeapon
+	void restore(int newCredits, int newHealth, unsigned short int newRiflemen, unsigned short int newRepairGuys);
 private:
 	int credits = 0;
 	std::vector<Weapon> weapons;
 	Weapon activeWeapon;
-	int health = 100;
+	int health = playerMaxHealth;
 	float lastDamageTime = 0.0f;
 	unsigned short int riflemen = 0;
 	unsigned short int repairGuys = 0;
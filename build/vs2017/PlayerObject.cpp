@@ -97,12 +97,13 @@ void PlayerObject::update()
 {
 	objectTranslation = gef::Vector4(body->GetPosition().x, body->GetPosition().y, 0);
 	translationMatrix.SetTranslation(objectTranslation);
+	//Set here rather than in render so culling can test the object before it is drawn
+	this->set_transform((scaleMatrix * rotationMatrix) * translationMatrix);
 	return;
 }
 
 void PlayerObject::render(gef::Renderer3D* renderer_3d_)
 {
-	this->set_transform((scaleMatrix * rotationMatrix) * translationMatrix);
 	renderer_3d_->DrawMesh(*this);
 	return;
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <game_object.h>
-#include <box2d/box2d.h>
+#include <box2d/Box2D.h>
 #include "graphics/scene.h"
 #include <maths/vector4.h>
 #include <maths/math_utils.h>
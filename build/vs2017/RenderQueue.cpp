@@ -0,0 +1,222 @@
+#include "RenderQueue.h"
+#include <cstdarg>
+#include <cstdio>
+#include <graphics/mesh_instance.h>
+#include <graphics/renderer_3d.h>
+#include <graphics/sprite_renderer.h>
+
+static const int layerShift = 60;
+static const int materialShift = 48;
+static const int resourceShift = 32;
+static const unsigned int materialIDMask = 0xfff;
+static const unsigned int resourceIDMask = 0xffff;
+//3D depth is stored in 1/256ths of a world unit
+static const float depthScale = 256.0f;
+
+void RenderQueue::begin(const gef::Vector4& cameraEye)
+{
+	eye = cameraEye;
+	items.clear();
+	entries.clear();
+	meshes.clear();
+	sprites.clear();
+	texts.clear();
+	materialIDs.clear();
+	resourceIDs.clear();
+	sorted = false;
+	stats = Stats();
+}
+
+unsigned int RenderQueue::idFor(std::vector<const void*>& table, const void* pointer)
+{
+	//Only a handful of materials and textures are used in a frame, so a linear search is enough
+	for (unsigned int i = 0; i < table.size(); i++)
+	{
+		if (table[i] == pointer)
+		{
+			return i;
+		}
+	}
+	table.push_back(pointer);
+	return (unsigned int)table.size() - 1;
+}
+
+unsigned long long RenderQueue::makeKey(Layer layer, const void* material, const void* resource, unsigned int depth)
+{
+	unsigned long long material_id = idFor(materialIDs, material) & materialIDMask;
+	unsigned long long resource_id = idFor(resourceIDs, resource) & resourceIDMask;
+	return ((unsigned long long)layer << layerShift) | (material_id << materialShift) | (resource_id << resourceShift) | depth;
+}
+
+void RenderQueue::addItem(ItemType type, unsigned int index, unsigned long long key)
+{
+	Item item;
+	item.type = type;
+	item.index = index;
+	SortEntry entry;
+	entry.key = key;
+	entry.item = (unsigned int)items.size();
+	items.push_back(item);
+	entries.push_back(entry);
+	sorted = false;
+}
+
+void RenderQueue::addMesh(const gef::MeshInstance& instance, const gef::Material* overrideMaterial)
+{
+	//Opaque meshes go front to back so the depth test rejects hidden pixels early
+	float distance = (instance.transform().GetTranslation() - eye).Length() * depthScale;
+	unsigned int depth = distance < 4294967295.0f ? (unsigned int)distance : 0xffffffff;
+
+	MeshDraw draw;
+	draw.instance = &instance;
+	draw.overrideMaterial = overrideMaterial;
+	meshes.push_back(draw);
+	addItem(MeshItem, (unsigned int)meshes.size() - 1, makeKey(Opaque3D, overrideMaterial, instance.mesh(), depth));
+}
+
+void RenderQueue::addSprite(const gef::Sprite& sprite, Layer layer)
+{
+	sprites.push_back(sprite);
+	addItem(SpriteItem, (unsigned int)sprites.size() - 1, makeKey(layer, NULL, sprite.texture(), (unsigned int)items.size()));
+}
+
+void RenderQueue::addText(gef::Font* font, const gef::Vector4& position, float scale, UInt32 colour, gef::TextJustification justification, const char* format, ...)
+{
+	char text[256];
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(text, sizeof(text), format, arguments);
+	va_end(arguments);
+
+	TextDraw draw;
+	draw.font = font;
+	draw.position = position;
+	draw.scale = scale;
+	draw.colour = colour;
+	draw.justification = justification;
+	draw.text = text;
+	texts.push_back(draw);
+	addItem(TextItem, (unsigned int)texts.size() - 1, makeKey(Text, NULL, font, (unsigned int)items.size()));
+}
+
+//LSD radix sort a byte at a time. Passes where every key has the same byte are skipped,
+//which is most of them as the layer and id fields only use a few values.
+void RenderQueue::sort()
+{
+	if (sorted)
+		return;
+
+	scratch.resize(entries.size());
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		unsigned int counts[256] = { 0 };
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			counts[(entries[i].key >> shift) & 0xff]++;
+		}
+		if (entries.empty() || counts[(entries[0].key >> shift) & 0xff] == entries.size())
+			continue;
+
+		unsigned int offsets[256];
+		unsigned int total = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			offsets[bucket] = total;
+			total += counts[bucket];
+		}
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			scratch[offsets[(entries[i].key >> shift) & 0xff]++] = entries[i];
+		}
+		entries.swap(scratch);
+	}
+	sorted = true;
+}
+
+void RenderQueue::draw3D(gef::Renderer3D* renderer)
+{
+	sort();
+
+	const gef::Material* currentOverride = NULL;
+	const gef::Mesh* currentMesh = NULL;
+	for (size_t i = 0; i < entries.size() && (entries[i].key >> layerShift) == Opaque3D; i++)
+	{
+		const Item& item = items[entries[i].item];
+		const MeshDraw& draw = meshes[item.index];
+		if (draw.overrideMaterial != currentOverride)
+		{
+			if (renderer != NULL)
+			{
+				renderer->set_override_material(draw.overrideMaterial);
+			}
+			currentOverride = draw.overrideMaterial;
+			stats.materialChanges++;
+		}
+		if (draw.instance->mesh() != currentMesh)
+		{
+			currentMesh = draw.instance->mesh();
+			stats.meshChanges++;
+		}
+		if (renderer != NULL)
+		{
+			renderer->DrawMesh(*draw.instance);
+		}
+		stats.meshDraws++;
+	}
+
+	if (currentOverride != NULL && renderer != NULL)
+	{
+		renderer->set_override_material(NULL);
+	}
+}
+
+void RenderQueue::drawSprites(gef::SpriteRenderer* renderer)
+{
+	sort();
+
+	const void* currentTexture = NULL;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if ((entries[i].key >> layerShift) == Opaque3D)
+			continue;
+
+		const Item& item = items[entries[i].item];
+		if (item.type == SpriteItem)
+		{
+			const gef::Sprite& sprite = sprites[item.index];
+			if (sprite.texture() != currentTexture)
+			{
+				currentTexture = sprite.texture();
+				stats.textureChanges++;
+			}
+			if (renderer != NULL)
+			{
+				renderer->DrawSprite(sprite);
+			}
+			stats.spriteDraws++;
+		}
+		else if (item.type == TextItem)
+		{
+			const TextDraw& draw = texts[item.index];
+			//Text is drawn with the font's texture
+			if (draw.font != currentTexture)
+			{
+				currentTexture = draw.font;
+				stats.textureChanges++;
+			}
+			if (renderer != NULL)
+			{
+				draw.font->RenderText(renderer, draw.position, draw.scale, draw.colour, draw.justification, "%s", draw.text.c_str());
+			}
+			stats.textDraws++;
+		}
+	}
+
+	//Sprites are the last thing drawn each frame, so the counts are only published once all of them are in
+	lastFrameStats = stats;
+}
+
+const RenderQueue::Stats& RenderQueue::getStats()
+{
+	return lastFrameStats;
+}
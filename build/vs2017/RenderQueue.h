@@ -0,0 +1,106 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <gef.h>
+#include <graphics/sprite.h>
+#include <graphics/font.h>
+#include <maths/vector4.h>
+
+namespace gef
+{
+	class MeshInstance;
+	class Material;
+	class Renderer3D;
+	class SpriteRenderer;
+}
+
+//Collects a frame's draws, sorts them by a 64-bit key and submits them so each material and texture is set as few times as possible.
+//Key layout from the top bit down: layer (4 bits), material (12), mesh or texture (16), depth or submission order (32).
+//The sort is stable, so draws with the same key keep the order they were added in.
+class RenderQueue
+{
+public:
+	//3D layers are drawn by draw3D, the rest by drawSprites in this order
+	enum Layer
+	{
+		Opaque3D,
+		Background,
+		Sprites,
+		Overlay,
+		Text,
+		LayerCount
+	};
+
+	struct Stats
+	{
+		unsigned int meshDraws = 0;
+		unsigned int spriteDraws = 0;
+		unsigned int textDraws = 0;
+		unsigned int materialChanges = 0;
+		unsigned int meshChanges = 0;
+		unsigned int textureChanges = 0;
+	};
+
+	//Start a new frame. Depth for 3D draws is measured from cameraEye.
+	void begin(const gef::Vector4& cameraEye);
+	void addMesh(const gef::MeshInstance& instance, const gef::Material* overrideMaterial = NULL);
+	void addSprite(const gef::Sprite& sprite, Layer layer = Sprites);
+	void addText(gef::Font* font, const gef::Vector4& position, float scale, UInt32 colour, gef::TextJustification justification, const char* format, ...);
+	//Call between the renderer's Begin and End. With no renderer the draws are only counted, for headless runs.
+	void draw3D(gef::Renderer3D* renderer);
+	//Call last each frame, after draw3D
+	void drawSprites(gef::SpriteRenderer* renderer);
+	//Counts from the last frame that finished drawing, so they can be shown while the next one is queued
+	const Stats& getStats();
+private:
+	enum ItemType
+	{
+		MeshItem,
+		SpriteItem,
+		TextItem
+	};
+	struct Item
+	{
+		ItemType type;
+		//Index into the array for the item's type
+		unsigned int index;
+	};
+	struct SortEntry
+	{
+		unsigned long long key;
+		unsigned int item;
+	};
+	struct MeshDraw
+	{
+		const gef::MeshInstance* instance;
+		const gef::Material* overrideMaterial;
+	};
+	struct TextDraw
+	{
+		gef::Font* font;
+		gef::Vector4 position;
+		float scale;
+		UInt32 colour;
+		gef::TextJustification justification;
+		std::string text;
+	};
+
+	unsigned long long makeKey(Layer layer, const void* material, const void* resource, unsigned int depth);
+	unsigned int idFor(std::vector<const void*>& table, const void* pointer);
+	void addItem(ItemType type, unsigned int index, unsigned long long key);
+	void sort();
+
+	std::vector<Item> items;
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+	std::vector<MeshDraw> meshes;
+	std::vector<gef::Sprite> sprites;
+	std::vector<TextDraw> texts;
+	//Small ids for the pointers seen this frame so they fit in the key
+	std::vector<const void*> materialIDs;
+	std::vector<const void*> resourceIDs;
+	gef::Vector4 eye;
+	bool sorted = false;
+	Stats stats;
+	Stats lastFrameStats;
+};
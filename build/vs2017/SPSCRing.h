@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+
+//Fixed size queue between exactly one producer thread and one consumer thread, without locks.
+//Each side only writes its own index and keeps a copy of the other side's, so it only reads the shared one
+//when the ring looks full or empty. The indices sit on their own cache lines so the two threads don't share one.
+template <typename T, unsigned int Capacity>
+class SPSCRing
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	//Producer only. Returns false when the ring is full.
+	bool push(const T& item)
+	{
+		unsigned int write = writeIndex.load(std::memory_order_relaxed);
+		if (write - cachedReadIndex == Capacity)
+		{
+			cachedReadIndex = readIndex.load(std::memory_order_acquire);
+			if (write - cachedReadIndex == Capacity)
+			{
+				return false;
+			}
+		}
+		items[write & (Capacity - 1)] = item;
+		writeIndex.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Consumer only. Returns false when the ring is empty.
+	bool pop(T& item)
+	{
+		unsigned int read = readIndex.load(std::memory_order_relaxed);
+		if (read == cachedWriteIndex)
+		{
+			cachedWriteIndex = writeIndex.load(std::memory_order_acquire);
+			if (read == cachedWriteIndex)
+			{
+				return false;
+			}
+		}
+		item = items[read & (Capacity - 1)];
+		readIndex.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Either side, only a hint as the other side may be moving
+	bool empty() const
+	{
+		return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+	}
+
+	static unsigned int capacity()
+	{
+		return Capacity;
+	}
+private:
+	//Written by the producer
+	alignas(64) std::atomic<unsigned int> writeIndex{ 0 };
+	unsigned int cachedReadIndex = 0;
+	//Written by the consumer
+	alignas(64) std::atomic<unsigned int> readIndex{ 0 };
+	unsigned int cachedWriteIndex = 0;
+	alignas(64) T items[Capacity];
+};
@@ -0,0 +1,423 @@
+#include "SessionSim.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <system/debug_log.h>
+#include "PerfRecorder.h"
+
+static const float sessionFrameTime = 1.0f / 60.0f;
+static const char* storePolicyNames[STORE_POLICY_COUNT] = { "none", "health", "riflemen", "repair_guys", "weapons", "balanced" };
+//Balanced players keep at least this much health before spending on helpers
+static const int balancedHealthFloor = 50;
+static const WeaponBalance* storeWeapons[] = { &shotgunBalance, &sniperBalance, &assaultRifleBalance };
+
+const char* GetStorePolicyName(StorePolicy policy)
+{
+	return policy < STORE_POLICY_COUNT ? storePolicyNames[policy] : "unknown";
+}
+
+SessionSim::SessionSim(const SessionSettings& newSettings, unsigned int seed) :
+	settings(newSettings),
+	randomState(seed)
+{
+}
+
+float SessionSim::nextRandom()
+{
+	randomState = randomState * 1664525 + 1013904223;
+	return (randomState >> 8) / 16777216.0f;
+}
+
+void SessionSim::run(SessionResult& result, NanosecondHistogram* frameCosts)
+{
+	result.days.clear();
+	result.won = false;
+
+	//Every session starts with the handgun and nothing else
+	weapons.assign(1, &handgunBalance);
+	activeWeapon = &handgunBalance;
+	player.resetData();
+
+	for (int day = 1; day <= settings.roundsToBeat; day++)
+	{
+		SessionDayResult dayResult;
+		bool cleared = playDay(day, dayResult, frameCosts != NULL ? &frameCosts[day - 1] : NULL);
+		result.days.push_back(dayResult);
+		if (cleared == false)
+		{
+			return;
+		}
+		if (day < settings.roundsToBeat)
+		{
+			visitStore();
+		}
+	}
+	result.won = true;
+}
+
+bool SessionSim::playDay(int day, SessionDayResult& result, NanosecondHistogram* frameCosts)
+{
+	//Same set up as GameStartDay and ScheduleDayTimers
+	gameTime = 0.0f;
+	player.setLastDamageTime(0.0f);
+	timers.clear();
+	timers.scheduleRepeating(NextHelperTick(gameTime, riflemanInterval), riflemanInterval, [this](float time) { riflemenAttack(); });
+	timers.scheduleRepeating(NextHelperTick(gameTime, repairGuyInterval), repairGuyInterval, [this](float time) { player.addHealth(player.getReapirGuys()); });
+	ammo = activeWeapon->maxAmmo;
+	tapTimer = 0.0f;
+
+	pool.clear();
+	alive.clear();
+	for (int lane = 0; lane < 5; lane++)
+	{
+		lanes[lane].clear();
+	}
+	int enemyCount = DayEnemyCount(day, false);
+	for (int i = 0; i < enemyCount; i++)
+	{
+		Enemy enemy;
+		enemy.x = enemySpawnX - i;
+		enemy.lane = (int)(nextRandom() * 5) % 5;
+		enemy.health = enemyHealth;
+		pool.push_back(enemy);
+		alive.push_back(i);
+		//Later enemies spawn further back, so pushing keeps each lane front to back
+		lanes[enemy.lane].push_back(i);
+	}
+
+	damageTaken = 0;
+	while (alive.empty() == false && player.getHealth() > 0 && gameTime < settings.maxDaySeconds)
+	{
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		step(sessionFrameTime);
+		if (frameCosts != NULL)
+		{
+			frameCosts->add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart).count());
+		}
+		result.frames++;
+	}
+
+	result.cleared = alive.empty() && player.getHealth() > 0;
+	result.timeToClear = gameTime;
+	result.damageTaken = damageTaken;
+	result.credits = player.getCredits();
+	return result.cleared;
+}
+
+//One frame in the order GameUpdate runs it: enemies, timers, then the player's taps
+void SessionSim::step(float frame_time)
+{
+	gameTime += frame_time;
+
+	moveEnemies(frame_time);
+	removeDeadEnemies();
+
+	timers.update(gameTime);
+
+	tapTimer += frame_time * settings.tapsPerSecond;
+	while (tapTimer >= 1.0f)
+	{
+		tap();
+		tapTimer -= 1.0f;
+	}
+}
+
+void SessionSim::moveEnemies(float frame_time)
+{
+	bool atHouse = false;
+	for (int lane = 0; lane < 5; lane++)
+	{
+		const std::vector<unsigned int>& queue = lanes[lane];
+		positions.resize(queue.size());
+		for (unsigned int i = 0; i < queue.size(); i++)
+		{
+			positions[i] = pool[queue[i]].x;
+		}
+		if (AdvanceLane(positions.data(), positions.size(), enemyWalkSpeed * frame_time, houseStopX, enemySpacing, [&](unsigned int i, bool queued) { pool[queue[i]].x = positions[i]; }))
+		{
+			atHouse = true;
+		}
+	}
+
+	if (atHouse)
+	{
+		int health = player.getHealth();
+		player.decrementHealth(gameTime, 1);
+		damageTaken += health - player.getHealth();
+	}
+}
+
+void SessionSim::removeDeadEnemies()
+{
+	//Kept in order, as UpdateEnemies does, so riflemen pick the same targets
+	KeepInOrder(alive, [this](unsigned int index)
+	{
+		if (pool[index].health <= 0)
+		{
+			player.addCredits(enemyKillCredits);
+			enemyDied = true;
+			return false;
+		}
+		return true;
+	});
+
+	if (enemyDied)
+	{
+		for (int lane = 0; lane < 5; lane++)
+		{
+			std::vector<unsigned int>& queue = lanes[lane];
+			queue.erase(std::remove_if(queue.begin(), queue.end(), [this](unsigned int index) { return pool[index].health <= 0; }), queue.end());
+		}
+		enemyDied = false;
+	}
+}
+
+//Same volley as SceneApp::RiflemenAttack
+void SessionSim::riflemenAttack()
+{
+	unsigned int targets = RiflemanTargetCount(player.getRiflemen(), alive.size());
+	for (unsigned int i = 0; i < targets; i++)
+	{
+		pool[alive[i]].health -= riflemanDamage;
+	}
+}
+
+void SessionSim::reloadWeapon()
+{
+	ammo = activeWeapon->maxAmmo;
+}
+
+//A tap fires one round at the enemy nearest the house and also hits anything else in its pick sphere.
+//Nobody taps before the first enemy walks on screen.
+void SessionSim::tap()
+{
+	int target = -1;
+	for (unsigned int i = 0; i < alive.size(); i++)
+	{
+		const Enemy& enemy = pool[alive[i]];
+		if (enemy.health > 0 && enemy.x >= enemySpawnX && (target < 0 || enemy.x > pool[target].x))
+		{
+			target = alive[i];
+		}
+	}
+	if (target < 0 || ammo <= 0)
+	{
+		return;
+	}
+
+	//Runs out and reloads the way SceneApp::FireWeapon does
+	ammo--;
+	if (ammo <= 0)
+	{
+		timers.schedule(gameTime + activeWeapon->reloadTime, [this](float time) { reloadWeapon(); });
+	}
+	if (nextRandom() >= settings.hitChance)
+	{
+		return;
+	}
+
+	//Lanes are further apart than the pick radius, so only the target's lane can be hit
+	float aimX = pool[target].x;
+	const std::vector<unsigned int>& queue = lanes[pool[target].lane];
+	for (unsigned int i = 0; i < queue.size(); i++)
+	{
+		Enemy& enemy = pool[queue[i]];
+		if (enemy.x >= aimX - enemyPickRadius && enemy.x <= aimX + enemyPickRadius)
+		{
+			enemy.health -= activeWeapon->damage;
+		}
+	}
+}
+
+bool SessionSim::buyWeapon(const WeaponBalance& weapon)
+{
+	if (std::find(weapons.begin(), weapons.end(), &weapon) != weapons.end() || player.spendCredits(weapon.cost) == false)
+	{
+		return false;
+	}
+	//A bought weapon is equipped straight away, as PlayerData::addWeapon does
+	weapons.push_back(&weapon);
+	activeWeapon = &weapon;
+	return true;
+}
+
+//Purchases go through the same PlayerData calls as the store's items, the loop conditions do the buying
+void SessionSim::visitStore()
+{
+	switch (settings.policy)
+	{
+	case STORE_POLICY_HEALTH:
+		while (player.getHealth() < playerMaxHealth && player.buyHealthPack(healthPackCost))
+		{
+		}
+		break;
+	case STORE_POLICY_RIFLEMEN:
+		while (player.buyRifleman(riflemanCost))
+		{
+		}
+		break;
+	case STORE_POLICY_REPAIR_GUYS:
+		while (player.buyRepairGuy(repairGuyCost))
+		{
+		}
+		break;
+	case STORE_POLICY_WEAPONS:
+		//Most expensive weapon that can be afforded, then save for the next
+		for (unsigned int i = 0; i < sizeof(storeWeapons) / sizeof(storeWeapons[0]); i++)
+		{
+			if (buyWeapon(*storeWeapons[i]))
+			{
+				break;
+			}
+		}
+		break;
+	case STORE_POLICY_BALANCED:
+		while (player.getHealth() < balancedHealthFloor && player.buyHealthPack(healthPackCost))
+		{
+		}
+		while (player.getCredits() >= std::min(riflemanCost, repairGuyCost))
+		{
+			if (player.getRiflemen() <= player.getReapirGuys() && player.buyRifleman(riflemanCost))
+			{
+				continue;
+			}
+			if (player.buyRepairGuy(repairGuyCost) == false)
+			{
+				player.buyRifleman(riflemanCost);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+//Nearest rank percentile of an unsorted copy
+static float Percentile(std::vector<float> values, double fraction)
+{
+	if (values.empty())
+	{
+		return 0.0f;
+	}
+	size_t rank = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+	std::nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+static float Mean(const std::vector<float>& values)
+{
+	double total = 0.0;
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		total += values[i];
+	}
+	return values.empty() ? 0.0f : (float)(total / values.size());
+}
+
+bool RunSessionSweep(unsigned int sessionsPerPolicy, unsigned int threadCount, const char* outputFilename)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	SessionSettings settings;
+	const unsigned int days = settings.roundsToBeat;
+	const unsigned int jobCount = sessionsPerPolicy * STORE_POLICY_COUNT;
+	std::vector<SessionResult> results(jobCount);
+	//Per thread, per policy, per day, merged once every thread is done
+	std::vector<NanosecondHistogram> threadFrameCosts(threadCount * STORE_POLICY_COUNT * days);
+	std::atomic<unsigned int> nextJob(0);
+
+	double startTime = PerfRecorder::nowMilliseconds();
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.push_back(std::thread([&, t]()
+		{
+			for (unsigned int job = nextJob++; job < jobCount; job = nextJob++)
+			{
+				SessionSettings jobSettings = settings;
+				jobSettings.policy = (StorePolicy)(job / sessionsPerPolicy);
+				SessionSim sim(jobSettings, 208 + job % sessionsPerPolicy);
+				sim.run(results[job], &threadFrameCosts[(t * STORE_POLICY_COUNT + jobSettings.policy) * days]);
+			}
+		}));
+	}
+	for (unsigned int t = 0; t < threadCount; t++)
+	{
+		threads[t].join();
+	}
+	double elapsed = PerfRecorder::nowMilliseconds() - startTime;
+
+	FILE* file = fopen(outputFilename, "w");
+	if (file == NULL)
+	{
+		gef::DebugOut("SessionSim: Could not write %s\n", outputFilename);
+		return false;
+	}
+
+	unsigned long long totalFrames = 0;
+	for (unsigned int job = 0; job < jobCount; job++)
+	{
+		for (unsigned int day = 0; day < results[job].days.size(); day++)
+		{
+			totalFrames += results[job].days[day].frames;
+		}
+	}
+
+	fprintf(file, "{\n  \"sessions_per_policy\": %u,\n  \"threads\": %u,\n  \"wall_ms\": %.3f,\n  \"sessions_per_second\": %.1f,\n  \"frames_per_second\": %.1f,\n  \"policies\": [",
+		sessionsPerPolicy, threadCount, elapsed, jobCount * 1000.0 / elapsed, totalFrames * 1000.0 / elapsed);
+	for (unsigned int policy = 0; policy < STORE_POLICY_COUNT; policy++)
+	{
+		unsigned int wins = 0;
+		for (unsigned int session = 0; session < sessionsPerPolicy; session++)
+		{
+			wins += results[policy * sessionsPerPolicy + session].won ? 1 : 0;
+		}
+		fprintf(file, "%s\n    {\"policy\": \"%s\", \"win_rate\": %.4f, \"days\": [", policy == 0 ? "" : ",", storePolicyNames[policy], (double)wins / sessionsPerPolicy);
+		gef::DebugOut("SessionSim: %s wins %u/%u\n", storePolicyNames[policy], wins, sessionsPerPolicy);
+
+		for (unsigned int day = 0; day < days; day++)
+		{
+			std::vector<float> clearTimes;
+			std::vector<float> damage;
+			std::vector<float> credits;
+			unsigned int played = 0;
+			for (unsigned int session = 0; session < sessionsPerPolicy; session++)
+			{
+				const SessionResult& result = results[policy * sessionsPerPolicy + session];
+				if (day >= result.days.size())
+					continue;
+
+				const SessionDayResult& dayResult = result.days[day];
+				played++;
+				if (dayResult.cleared)
+				{
+					clearTimes.push_back(dayResult.timeToClear);
+				}
+				damage.push_back((float)dayResult.damageTaken);
+				credits.push_back((float)dayResult.credits);
+			}
+
+			NanosecondHistogram frameCosts;
+			for (unsigned int t = 0; t < threadCount; t++)
+			{
+				frameCosts.merge(threadFrameCosts[(t * STORE_POLICY_COUNT + policy) * days + day]);
+			}
+
+			fprintf(file, "%s\n      {\"day\": %u, \"played\": %u, \"cleared\": %u, \"clear_s_mean\": %.3f, \"clear_s_p50\": %.3f, \"clear_s_p95\": %.3f, "
+				"\"damage_mean\": %.3f, \"damage_p95\": %.1f, \"credits_mean\": %.1f, \"frames\": %llu, \"frame_ns_p50\": %llu, \"frame_ns_p99\": %llu, \"frame_ns_max\": %llu}",
+				day == 0 ? "" : ",", day + 1, played, (unsigned int)clearTimes.size(), Mean(clearTimes), Percentile(clearTimes, 0.5), Percentile(clearTimes, 0.95),
+				Mean(damage), Percentile(damage, 0.95), Mean(credits), frameCosts.count, frameCosts.percentile(0.5), frameCosts.percentile(0.99), frameCosts.maxNanoseconds);
+		}
+		fprintf(file, "\n    ]}");
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+
+	gef::DebugOut("SessionSim: %u sessions on %u threads in %.1f ms, %.0f frames per second\n", jobCount, threadCount, elapsed, totalFrames * 1000.0 / elapsed);
+	return true;
+}
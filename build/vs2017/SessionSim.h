@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "GameBalance.h"
+#include "GameRules.h"
+#include "PlayerData.h"
+#include "TimerScheduler.h"
+#include "NanosecondHistogram.h"
+
+//What the simulated player buys on each visit to the store
+enum StorePolicy
+{
+	STORE_POLICY_NONE,
+	STORE_POLICY_HEALTH,
+	STORE_POLICY_RIFLEMEN,
+	STORE_POLICY_REPAIR_GUYS,
+	STORE_POLICY_WEAPONS,
+	STORE_POLICY_BALANCED,
+	STORE_POLICY_COUNT
+};
+
+const char* GetStorePolicyName(StorePolicy policy);
+
+//How the simulated player plays a session
+struct SessionSettings
+{
+	StorePolicy policy = STORE_POLICY_BALANCED;
+	unsigned short int roundsToBeat = defaultRoundsToBeat;
+	//Taps go at the enemy nearest the house, taps while reloading are wasted
+	float tapsPerSecond = 4.0f;
+	float hitChance = 0.8f;
+	//A day that runs this long is given up as lost
+	float maxDaySeconds = 600.0f;
+};
+
+struct SessionDayResult
+{
+	bool cleared = false;
+	//Game seconds until the last enemy died, or until the player did
+	float timeToClear = 0.0f;
+	int damageTaken = 0;
+	//Credits at the end of the day, before the store
+	int credits = 0;
+	unsigned int frames = 0;
+};
+
+struct SessionResult
+{
+	std::vector<SessionDayResult> days;
+	bool won = false;
+};
+
+//Plays a whole session with the game's rules and none of its rendering, audio or Box2D.
+//The rules are SceneApp's own: the day, helper and lane rules come from GameRules.h, the player is a PlayerData
+//and the helpers and reloads run on a TimerScheduler. Only the enemies and the player's taps are modelled here.
+//A session only depends on its seed, so results are the same whichever thread runs it.
+class SessionSim
+{
+public:
+	SessionSim(const SessionSettings& settings, unsigned int seed);
+	//Frame costs for day n go in frameCosts[n - 1] when frameCosts is not NULL
+	void run(SessionResult& result, NanosecondHistogram* frameCosts);
+private:
+	struct Enemy
+	{
+		float x;
+		int lane;
+		int health;
+	};
+
+	bool playDay(int day, SessionDayResult& result, NanosecondHistogram* frameCosts);
+	void step(float frame_time);
+	void moveEnemies(float frame_time);
+	void removeDeadEnemies();
+	void riflemenAttack();
+	void reloadWeapon();
+	void tap();
+	void visitStore();
+	bool buyWeapon(const WeaponBalance& weapon);
+	float nextRandom();
+
+	SessionSettings settings;
+	unsigned int randomState;
+
+	//Every enemy of the day keeps its slot. alive is in the order the game's enemy vector would be in,
+	//lanes hold each lane's enemies front (nearest the house) to back.
+	std::vector<Enemy> pool;
+	std::vector<unsigned int> alive;
+	std::vector<unsigned int> lanes[5];
+	//Scratch for moving one lane
+	std::vector<float> positions;
+	bool enemyDied = false;
+
+	float gameTime = 0.0f;
+	TimerScheduler timers;
+	PlayerData player;
+	int damageTaken = 0;
+	//PlayerData's weapons need icons, so the sim keeps its own list of what has been bought
+	std::vector<const WeaponBalance*> weapons;
+	const WeaponBalance* activeWeapon = NULL;
+	int ammo = 0;
+	float tapTimer = 0.0f;
+};
+
+//Play sessionsPerPolicy sessions for every store policy across threadCount threads and write per day stats as JSON.
+//Session i of every policy uses the same seed, so the policies see the same waves.
+bool RunSessionSweep(unsigned int sessionsPerPolicy, unsigned int threadCount, const char* outputFilename);
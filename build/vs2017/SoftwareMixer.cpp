@@ -0,0 +1,362 @@
+#include "SoftwareMixer.h"
+#include <cstdio>
+#include <cstring>
+#include <system/debug_log.h>
+#include "PerfRecorder.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const float sampleScale = 1.0f / 32768.0f;
+static const unsigned int benchmarkBufferFrames = 1024;
+static const unsigned int benchmarkBuffers = 200;
+static const unsigned int benchmarkSoundCount = 8;
+static const unsigned int benchmarkSoundSeconds = 10;
+
+void VoiceLimiter::setVoiceCap(Int32 sampleID, unsigned int maxVoices, float holdTime)
+{
+	SampleVoices& sample = samples[sampleID];
+	sample.maxVoices = maxVoices > 0 ? maxVoices : 1;
+	sample.holdTime = holdTime;
+}
+
+void VoiceLimiter::beginFrame(float time)
+{
+	currentTime = time;
+	frame++;
+}
+
+bool VoiceLimiter::allow(Int32 sampleID)
+{
+	SampleVoices& sample = samples[sampleID];
+	if (sample.lastFrame == frame)
+	{
+		coalescedCount++;
+		return false;
+	}
+
+	//Forget voices that have finished playing, and any started after now as the clock must have been reset since
+	for (unsigned int i = 0; i < sample.startTimes.size();)
+	{
+		if (sample.startTimes[i] > currentTime || currentTime - sample.startTimes[i] >= sample.holdTime)
+		{
+			sample.startTimes[i] = sample.startTimes.back();
+			sample.startTimes.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (sample.startTimes.size() >= sample.maxVoices)
+	{
+		cappedCount++;
+		return false;
+	}
+
+	sample.lastFrame = frame;
+	sample.startTimes.push_back(currentTime);
+	return true;
+}
+
+void VoiceLimiter::forgetVoices()
+{
+	for (std::map<Int32, SampleVoices>::iterator it = samples.begin(); it != samples.end(); ++it)
+	{
+		it->second.startTimes.clear();
+		it->second.lastFrame = 0;
+	}
+}
+
+void VoiceLimiter::clear()
+{
+	samples.clear();
+	coalescedCount = 0;
+	cappedCount = 0;
+}
+
+unsigned int VoiceLimiter::getCoalescedCount()
+{
+	return coalescedCount;
+}
+
+unsigned int VoiceLimiter::getCappedCount()
+{
+	return cappedCount;
+}
+
+SoftwareMixer::SoftwareMixer(unsigned int rate) :
+	sampleRate(rate),
+	useSIMD(true)
+{
+}
+
+Int32 SoftwareMixer::addSound(const std::vector<Int16>& samples, unsigned int channels)
+{
+	if (channels != 1 && channels != 2)
+	{
+		gef::DebugOut("SoftwareMixer: Only mono and stereo sounds can be mixed\n");
+		return -1;
+	}
+
+	Sound sound;
+	sound.samples = samples;
+	sound.channels = channels;
+	sound.frameCount = (unsigned int)(samples.size() / channels);
+	sound.maxVoices = 8;
+	sounds.push_back(sound);
+	return (Int32)sounds.size() - 1;
+}
+
+void SoftwareMixer::setVoiceCap(Int32 soundID, unsigned int maxVoices)
+{
+	if (soundID >= 0 && soundID < (Int32)sounds.size())
+	{
+		sounds[soundID].maxVoices = maxVoices > 0 ? maxVoices : 1;
+	}
+}
+
+void SoftwareMixer::trigger(Int32 soundID, float volume)
+{
+	if (soundID < 0 || soundID >= (Int32)sounds.size())
+		return;
+
+	stats.triggers++;
+	std::map<Int32, float>::iterator pending = pendingTriggers.find(soundID);
+	if (pending != pendingTriggers.end())
+	{
+		stats.coalesced++;
+		pending->second += volume;
+	}
+	else
+	{
+		pendingTriggers[soundID] = volume;
+	}
+}
+
+void SoftwareMixer::stopAll()
+{
+	voices.clear();
+	pendingTriggers.clear();
+	stats.activeVoices = 0;
+}
+
+void SoftwareMixer::startVoice(Int32 soundID, float volume)
+{
+	//Stacked triggers get louder but should not clip on their own
+	if (volume > 1.0f)
+		volume = 1.0f;
+
+	unsigned int playing = 0;
+	int oldest = -1;
+	for (unsigned int i = 0; i < voices.size(); i++)
+	{
+		if (voices[i].soundID == soundID)
+		{
+			playing++;
+			if (oldest < 0 || voices[i].position > voices[oldest].position)
+			{
+				oldest = i;
+			}
+		}
+	}
+
+	if (playing >= sounds[soundID].maxVoices)
+	{
+		stats.stolen++;
+		voices[oldest].position = 0;
+		voices[oldest].volume = volume;
+		return;
+	}
+
+	Voice voice;
+	voice.soundID = soundID;
+	voice.position = 0;
+	voice.volume = volume;
+	voices.push_back(voice);
+}
+
+void SoftwareMixer::mixVoice(const Sound& sound, Voice& voice, float* output, unsigned int frames)
+{
+	unsigned int remaining = sound.frameCount - voice.position;
+	if (frames > remaining)
+		frames = remaining;
+
+	const Int16* source = sound.samples.data() + voice.position * sound.channels;
+	float gain = voice.volume * sampleScale;
+	unsigned int i = 0;
+
+#ifdef MIXER_SSE2
+	if (useSIMD)
+	{
+		__m128 gainVector = _mm_set1_ps(gain);
+		if (sound.channels == 2)
+		{
+			for (; i + 4 <= frames; i += 4)
+			{
+				//Four stereo frames, sign extended to 32 bits by duplicating each sample and shifting
+				__m128i packed = _mm_loadu_si128((const __m128i*)(source + i * 2));
+				__m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+				__m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16));
+				float* destination = output + i * 2;
+				_mm_storeu_ps(destination, _mm_add_ps(_mm_loadu_ps(destination), _mm_mul_ps(low, gainVector)));
+				_mm_storeu_ps(destination + 4, _mm_add_ps(_mm_loadu_ps(destination + 4), _mm_mul_ps(high, gainVector)));
+			}
+		}
+		else
+		{
+			for (; i + 4 <= frames; i += 4)
+			{
+				//Four mono samples, each written to both channels
+				__m128i packed = _mm_loadl_epi64((const __m128i*)(source + i));
+				__m128 samples = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16)), gainVector);
+				float* destination = output + i * 2;
+				_mm_storeu_ps(destination, _mm_add_ps(_mm_loadu_ps(destination), _mm_unpacklo_ps(samples, samples)));
+				_mm_storeu_ps(destination + 4, _mm_add_ps(_mm_loadu_ps(destination + 4), _mm_unpackhi_ps(samples, samples)));
+			}
+		}
+	}
+#endif
+
+	if (sound.channels == 2)
+	{
+		for (; i < frames; i++)
+		{
+			output[i * 2] += source[i * 2] * gain;
+			output[i * 2 + 1] += source[i * 2 + 1] * gain;
+		}
+	}
+	else
+	{
+		for (; i < frames; i++)
+		{
+			float sample = source[i] * gain;
+			output[i * 2] += sample;
+			output[i * 2 + 1] += sample;
+		}
+	}
+
+	voice.position += frames;
+}
+
+void SoftwareMixer::mix(float* output, unsigned int frames)
+{
+	double startTime = PerfRecorder::nowMilliseconds();
+
+	for (std::map<Int32, float>::iterator pending = pendingTriggers.begin(); pending != pendingTriggers.end(); ++pending)
+	{
+		startVoice(pending->first, pending->second);
+	}
+	pendingTriggers.clear();
+
+	memset(output, 0, frames * 2 * sizeof(float));
+	for (unsigned int i = 0; i < voices.size();)
+	{
+		const Sound& sound = sounds[voices[i].soundID];
+		mixVoice(sound, voices[i], output, frames);
+		if (voices[i].position >= sound.frameCount)
+		{
+			voices[i] = voices.back();
+			voices.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	stats.activeVoices = (unsigned int)voices.size();
+	if (stats.activeVoices > stats.peakVoices)
+	{
+		stats.peakVoices = stats.activeVoices;
+	}
+	stats.lastMixMilliseconds = PerfRecorder::nowMilliseconds() - startTime;
+	stats.load = stats.lastMixMilliseconds / (frames * 1000.0 / sampleRate);
+}
+
+void SoftwareMixer::setUseSIMD(bool value)
+{
+	useSIMD = value;
+}
+
+const MixerStats& SoftwareMixer::getStats()
+{
+	return stats;
+}
+
+void SoftwareMixer::resetStats()
+{
+	stats = MixerStats();
+	stats.activeVoices = (unsigned int)voices.size();
+}
+
+//Mean milliseconds per buffer once voiceCount voices are playing
+static double BenchmarkMix(unsigned int voiceCount, bool simd, const std::vector<Int16>& stereo, const std::vector<Int16>& mono)
+{
+	SoftwareMixer mixer;
+	mixer.setUseSIMD(simd);
+	for (unsigned int i = 0; i < benchmarkSoundCount; i++)
+	{
+		Int32 id = (i & 1) ? mixer.addSound(mono, 1) : mixer.addSound(stereo, 2);
+		mixer.setVoiceCap(id, voiceCount);
+	}
+
+	//Each sound starts one voice per buffer, coalescing stops more in the same frame
+	std::vector<float> output(benchmarkBufferFrames * 2);
+	while (mixer.getStats().activeVoices < voiceCount)
+	{
+		for (unsigned int i = 0; i < benchmarkSoundCount && mixer.getStats().activeVoices + i < voiceCount; i++)
+		{
+			mixer.trigger(i);
+		}
+		mixer.mix(output.data(), benchmarkBufferFrames);
+	}
+
+	double total = 0.0;
+	for (unsigned int buffer = 0; buffer < benchmarkBuffers; buffer++)
+	{
+		mixer.mix(output.data(), benchmarkBufferFrames);
+		total += mixer.getStats().lastMixMilliseconds;
+	}
+	return total / benchmarkBuffers;
+}
+
+bool RunMixerBenchmark(const unsigned int* voiceCounts, unsigned int count, const char* outputFilename)
+{
+	//Long enough that no voice finishes during the measured buffers
+	const unsigned int sampleRate = 44100;
+	std::vector<Int16> stereo(sampleRate * benchmarkSoundSeconds * 2);
+	std::vector<Int16> mono(sampleRate * benchmarkSoundSeconds);
+	unsigned int seed = 208;
+	for (size_t i = 0; i < stereo.size(); i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		stereo[i] = (Int16)(seed >> 16);
+		if (i < mono.size())
+			mono[i] = stereo[i];
+	}
+
+	FILE* file = fopen(outputFilename, "w");
+	if (file == NULL)
+	{
+		gef::DebugOut("SoftwareMixer: Could not write %s\n", outputFilename);
+		return false;
+	}
+
+	double bufferMilliseconds = benchmarkBufferFrames * 1000.0 / sampleRate;
+	fprintf(file, "{\n  \"buffer_frames\": %u,\n  \"buffer_ms\": %.6f,\n  \"voices\": [", benchmarkBufferFrames, bufferMilliseconds);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		double simd = BenchmarkMix(voiceCounts[i], true, stereo, mono);
+		double scalar = BenchmarkMix(voiceCounts[i], false, stereo, mono);
+		fprintf(file, "%s\n    {\"count\": %u, \"simd_ms\": %.6f, \"simd_load\": %.6f, \"scalar_ms\": %.6f, \"scalar_load\": %.6f}",
+			i == 0 ? "" : ",", voiceCounts[i], simd, simd / bufferMilliseconds, scalar, scalar / bufferMilliseconds);
+		gef::DebugOut("SoftwareMixer: %u voices simd %.4f ms scalar %.4f ms per buffer\n", voiceCounts[i], simd, scalar);
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+	return true;
+}
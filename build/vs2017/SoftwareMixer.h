@@ -0,0 +1,92 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <gef.h>
+
+//Decides whether a sample trigger should start a new voice.
+//Triggers of the same sample in one frame are merged into one and each sample has a cap on how many voices may overlap.
+class VoiceLimiter
+{
+public:
+	//holdTime is how long a voice counts against the cap, normally the length of the sample
+	void setVoiceCap(Int32 sampleID, unsigned int maxVoices, float holdTime);
+	//Call once per frame before any triggers
+	void beginFrame(float time);
+	bool allow(Int32 sampleID);
+	//Forget every playing voice but keep the caps, for when the clock beginFrame is given starts again
+	void forgetVoices();
+	void clear();
+	unsigned int getCoalescedCount();
+	unsigned int getCappedCount();
+private:
+	struct SampleVoices
+	{
+		unsigned int maxVoices = 1;
+		float holdTime = 0.0f;
+		unsigned int lastFrame = 0;
+		std::vector<float> startTimes;
+	};
+	std::map<Int32, SampleVoices> samples;
+	float currentTime = 0.0f;
+	unsigned int frame = 1;
+	unsigned int coalescedCount = 0;
+	unsigned int cappedCount = 0;
+};
+
+struct MixerStats
+{
+	unsigned int activeVoices = 0;
+	unsigned int peakVoices = 0;
+	unsigned int triggers = 0;
+	unsigned int coalesced = 0;
+	unsigned int stolen = 0;
+	double lastMixMilliseconds = 0.0;
+	//Time spent mixing the last buffer as a fraction of the time it plays for
+	double load = 0.0;
+};
+
+//Mixes 16-bit sounds into an interleaved stereo float buffer, four frames at a time with SSE2 where available.
+//Triggers queue up between mix calls so repeats of one sound in the same frame become a single louder voice,
+//and a sound at its voice cap restarts its oldest voice instead of adding another.
+class SoftwareMixer
+{
+public:
+	SoftwareMixer(unsigned int sampleRate = 44100);
+	//samples are interleaved and must be at the mixer's sample rate
+	Int32 addSound(const std::vector<Int16>& samples, unsigned int channels);
+	void setVoiceCap(Int32 soundID, unsigned int maxVoices);
+	void trigger(Int32 soundID, float volume = 1.0f);
+	void stopAll();
+	//Overwrites output with frames stereo frames
+	void mix(float* output, unsigned int frames);
+	void setUseSIMD(bool value);
+	const MixerStats& getStats();
+	void resetStats();
+private:
+	struct Sound
+	{
+		std::vector<Int16> samples;
+		unsigned int channels;
+		unsigned int frameCount;
+		unsigned int maxVoices;
+	};
+	struct Voice
+	{
+		Int32 soundID;
+		unsigned int position;
+		float volume;
+	};
+	void startVoice(Int32 soundID, float volume);
+	void mixVoice(const Sound& sound, Voice& voice, float* output, unsigned int frames);
+
+	std::vector<Sound> sounds;
+	std::vector<Voice> voices;
+	//Summed volume of each sound triggered since the last mix
+	std::map<Int32, float> pendingTriggers;
+	unsigned int sampleRate;
+	bool useSIMD;
+	MixerStats stats;
+};
+
+//Mixes voiceCounts[i] overlapping voices for a fixed number of buffers and writes per-buffer cost and load, SIMD against scalar, to JSON
+bool RunMixerBenchmark(const unsigned int* voiceCounts, unsigned int count, const char* outputFilename);
@@ -0,0 +1,144 @@
+#include "StartupTrace.h"
+#include <atomic>
+#include <cstdio>
+#include <system/debug_log.h>
+#include "PerfRecorder.h"
+
+//Small ids in the order threads first record a span, the main thread being 0
+static std::atomic<unsigned int> nextThreadIndex(0);
+static thread_local unsigned int threadIndex = nextThreadIndex++;
+static const unsigned int noSpan = 0xffffffff;
+
+StartupTrace& StartupTrace::instance()
+{
+	static StartupTrace trace;
+	return trace;
+}
+
+void StartupTrace::start()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	//Touch the thread index so the main thread gets 0
+	(void)threadIndex;
+	spans.clear();
+	spans.reserve(64);
+	startTime = PerfRecorder::nowMilliseconds();
+	timeToFirstFrame = 0.0;
+	recording = true;
+}
+
+unsigned int StartupTrace::beginSpan(const char* name)
+{
+	if (recording == false)
+	{
+		return noSpan;
+	}
+
+	Span span;
+	span.name = name;
+	span.start = PerfRecorder::nowMilliseconds() - startTime;
+	span.end = -1.0;
+	span.thread = threadIndex;
+
+	std::lock_guard<std::mutex> guard(lock);
+	//The first frame may have ended the trace since the check above
+	if (recording == false)
+	{
+		return noSpan;
+	}
+	spans.push_back(span);
+	return (unsigned int)spans.size() - 1;
+}
+
+void StartupTrace::endSpan(unsigned int span)
+{
+	if (span == noSpan)
+	{
+		return;
+	}
+
+	double now = PerfRecorder::nowMilliseconds() - startTime;
+	std::lock_guard<std::mutex> guard(lock);
+	if (span < spans.size())
+	{
+		spans[span].end = now;
+	}
+}
+
+bool StartupTrace::isRecording()
+{
+	return recording;
+}
+
+void StartupTrace::firstFrame(const char* filename)
+{
+	if (recording == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		recording = false;
+		timeToFirstFrame = PerfRecorder::nowMilliseconds() - startTime;
+	}
+
+	gef::DebugOut("Startup: first frame after %.1f ms\n", timeToFirstFrame);
+	if (isOverBudget())
+	{
+		gef::DebugOut("Startup: over the %.1f ms budget\n", budget);
+	}
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("Startup/time_to_first_frame", timeToFirstFrame);
+	}
+	write(filename);
+}
+
+double StartupTrace::getTimeToFirstFrame()
+{
+	return timeToFirstFrame;
+}
+
+void StartupTrace::setBudget(double milliseconds)
+{
+	budget = milliseconds;
+}
+
+bool StartupTrace::isOverBudget()
+{
+	return budget > 0.0 && timeToFirstFrame > budget;
+}
+
+bool StartupTrace::write(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if (file == NULL)
+	{
+		gef::DebugOut("Startup: Could not write %s\n", filename);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	fprintf(file, "{\n  \"time_to_first_frame_ms\": %.3f,\n  \"budget_ms\": %.3f,\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [", timeToFirstFrame, budget);
+	for (unsigned int i = 0; i < spans.size(); i++)
+	{
+		//Spans still open at the first frame run on past it, so they are cut off there
+		double end = spans[i].end >= 0.0 ? spans[i].end : timeToFirstFrame;
+		fprintf(file, "\n    {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.1f, \"dur\": %.1f},",
+			spans[i].name, spans[i].thread, spans[i].start * 1000.0, (end - spans[i].start) * 1000.0);
+	}
+	fprintf(file, "\n    {\"name\": \"First frame\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": %.1f}\n  ]\n}\n", timeToFirstFrame * 1000.0);
+	fclose(file);
+	return true;
+}
+
+ScopedStartupSpan::ScopedStartupSpan(const char* name)
+{
+	span = StartupTrace::instance().beginSpan(name);
+}
+
+ScopedStartupSpan::~ScopedStartupSpan()
+{
+	StartupTrace::instance().endSpan(span);
+}
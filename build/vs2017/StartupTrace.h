@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+//Timeline of start up from WinMain to the first frame, written as a Chrome trace (chrome://tracing or Perfetto) to startup_trace.json.
+//Spans can come from any thread and are shown on their own rows, so work done alongside the main thread is easy to see.
+//Recording stops at the first frame, after that spans cost a flag check.
+class StartupTrace
+{
+public:
+	static StartupTrace& instance();
+	//Call first thing in WinMain, every time in the trace is measured from here
+	void start();
+	//Spans are given by name, which must be a literal as only the pointer is kept
+	unsigned int beginSpan(const char* name);
+	void endSpan(unsigned int span);
+	bool isRecording();
+	//Ends the trace, logs the time to first frame and writes the trace out
+	void firstFrame(const char* filename);
+	double getTimeToFirstFrame();
+	//Zero means no budget. Going over it fails a --benchmark run.
+	void setBudget(double milliseconds);
+	bool isOverBudget();
+private:
+	struct Span
+	{
+		const char* name;
+		double start;
+		double end;
+		unsigned int thread;
+	};
+	bool write(const char* filename);
+
+	std::mutex lock;
+	std::vector<Span> spans;
+	double startTime = 0.0;
+	double timeToFirstFrame = 0.0;
+	double budget = 0.0;
+	//Read without the lock by spans from the prefetch threads, long after the main thread has stopped recording
+	std::atomic<bool> recording{ false };
+};
+
+//Times the enclosing scope into the startup trace
+class ScopedStartupSpan
+{
+public:
+	ScopedStartupSpan(const char* name);
+	~ScopedStartupSpan();
+private:
+	unsigned int span;
+};
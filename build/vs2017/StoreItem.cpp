@@ -1,5 +1,5 @@
 #include "StoreItem.h"
-#include <system\debug_log.h>
+#include <system/debug_log.h>
 
 StoreItem::StoreItem(const char* pngFileName, gef::Platform* platform, int newCost, string newType, b2World* world, b2Vec2 bodyPos)
 {
@@ -56,42 +56,16 @@ PlayerData StoreItem::run(PlayerData playerData)
 {
 	switch (type)
 	{
+	//PlayerData does the buying so SessionSim's store works the same way
 	case itemType::Health:
-		if (canPlayerAfford(&playerData) == true)
-		{
-			playerData.addHealth(10);
-			purchaseSuccessful = true;
-			playerData.decrementCredits(cost);
-			break;
-		}
-		else
-		{
-			break;
-		}
+		purchaseSuccessful = playerData.buyHealthPack(cost);
+		break;
 	case itemType::Rifleman:
-		if (canPlayerAfford(&playerData) == true)
-		{
-			playerData.addRiflemen(1);
-			purchaseSuccessful = true;
-			playerData.decrementCredits(cost);
-			break;
-		}
-		else
-		{
-			break;
-		}
+		purchaseSuccessful = playerData.buyRifleman(cost);
+		break;
 	case itemType::RepairGuy:
-		if (canPlayerAfford(&playerData) == true)
-		{
-			playerData.addRepairGuys(1);
-			purchaseSuccessful = true;
-			playerData.decrementCredits(cost);
-			break;
-		}
-		else
-		{
-			break;
-		}
+		purchaseSuccessful = playerData.buyRepairGuy(cost);
+		break;
 	case itemType::Weapon:
 		break;
 	default:
@@ -121,24 +95,18 @@ bool StoreItem::didPurchaseSucced()
 	}
 }
 
-char* StoreItem::getName()
+const char* StoreItem::getName()
 {
 	return name;
 }
 
-gef::Texture* StoreItem::getIcon()
+StoreItem::~StoreItem()
 {
-	return icon;
+	delete icon;
+	icon = NULL;
 }
 
-bool StoreItem::canPlayerAfford(PlayerData* playerData)
+gef::Texture* StoreItem::getIcon()
 {
-	if ((playerData->getCredits() - cost) < 0)
-	{
-		return false;
-	}
-	else
-	{
-		return true;
-	}
-}
\ No newline at end of file
+	return icon;
+}
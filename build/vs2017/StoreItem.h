@@ -2,7 +2,7 @@
 
 #include <graphics/sprite.h>
 #include <load_texture.h>
-#include <box2d/box2d.h>
+#include <box2d/Box2D.h>
 #include "PlayerData.h"
 
 namespace gef
@@ -22,12 +22,13 @@ class StoreItem: public gef::Sprite
 {
 public:
 	StoreItem(const char* pngFileName, gef::Platform* platform, int newCost, string newType, b2World* world, b2Vec2 bodyPos);
+	~StoreItem();
 	int getCost();
 	//Do something
 	PlayerData run(PlayerData playerData);
 	b2Body* getBody();
 	bool didPurchaseSucced();
-	char* getName();
+	const char* getName();
 	gef::Texture* getIcon();
 private:
 	gef::Texture* icon;
@@ -35,8 +36,7 @@ private:
 	itemType type;
 	b2Body* body;
 	b2BodyDef bodyDef;
-	bool canPlayerAfford(PlayerData* playerData);
 	bool purchaseSuccessful = false;
-	char* name = "";
+	const char* name = "";
 };
 
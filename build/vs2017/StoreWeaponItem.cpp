@@ -1,5 +1,5 @@
 #include "StoreWeaponItem.h"
-#include <system\debug_log.h>
+#include <system/debug_log.h>
 
 StoreWeaponItem::StoreWeaponItem(const char* pngFileName, gef::Platform* platform, int newCost, b2World* world, b2Vec2 bodyPos, Weapon weapon){
 	icon = CreateTextureFromPNG(pngFileName, *platform);
@@ -37,11 +37,10 @@ PlayerData StoreWeaponItem::run(PlayerData playerData)
 		playerData.setActiveWeapon(linkedWeapon.getName());
 		return playerData;
 	}
-	else if (canPlayerAfford(&playerData) == true)
+	else if (playerData.spendCredits(cost) == true)
 	{
 		playerData.addWeapon(linkedWeapon);
 		purchaseSuccessful = true;
-		playerData.decrementCredits(cost);
 		return playerData;
 	}
 	return playerData;
@@ -66,24 +65,19 @@ bool StoreWeaponItem::didPurchaseSucced()
 	}
 }
 
-char* StoreWeaponItem::getName()
+const char* StoreWeaponItem::getName()
 {
 	return name;
 }
 
-gef::Texture* StoreWeaponItem::getIcon()
+StoreWeaponItem::~StoreWeaponItem()
 {
-	return icon;
+	delete icon;
+	icon = NULL;
 }
 
-bool StoreWeaponItem::canPlayerAfford(PlayerData* playerData)
+gef::Texture* StoreWeaponItem::getIcon()
 {
-	if ((playerData->getCredits() - cost) < 0)
-	{
-		return false;
-	}
-	else
-	{
-		return true;
-	}
+	return icon;
 }
+
@@ -3,28 +3,28 @@
 #include "Weapon.h"
 #include <graphics/sprite.h>
 #include <load_texture.h>
-#include <box2d/box2d.h>
+#include <box2d/Box2D.h>
 #include "PlayerData.h"
 
 class StoreWeaponItem: public gef::Sprite
 {
 public:
 	StoreWeaponItem(const char* pngFileName, gef::Platform* platform, int newCost, b2World* world, b2Vec2 bodyPos, Weapon weapon);
+	~StoreWeaponItem();
 	int getCost();
 	//Do something
 	PlayerData run(PlayerData playerData);
 	b2Body* getBody();
 	bool didPurchaseSucced();
-	char* getName();
+	const char* getName();
 	gef::Texture* getIcon();
 private:
 	gef::Texture* icon;
 	int cost = 0;
 	b2Body* body;
 	b2BodyDef bodyDef;
-	bool canPlayerAfford(PlayerData* playerData);
 	bool purchaseSuccessful = false;
-	char* name = "";
+	const char* name = "";
 	Weapon linkedWeapon;
 };
 
@@ -0,0 +1,20 @@
+#include "TemporaryFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cstdio>
+#endif
+
+bool CommitTemporaryFile(const char* temporaryFilename, const char* filename, bool writeThrough)
+{
+#ifdef _WIN32
+	//rename won't replace an existing file on Windows, and removing it first leaves a moment with no file at all
+	DWORD flags = MOVEFILE_REPLACE_EXISTING | (writeThrough ? MOVEFILE_WRITE_THROUGH : 0);
+	return MoveFileExA(temporaryFilename, filename, flags) != 0;
+#else
+	//POSIX rename already replaces the target atomically
+	return rename(temporaryFilename, filename) == 0;
+#endif
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+//Moves a fully written temporary file over filename in one step, so a reader or a crash never sees filename missing or half written.
+//writeThrough also waits for the move to reach the disk, for files such as saves that must survive a power cut.
+//On failure filename is left as it was and the temporary file is still there for the caller to remove.
+bool CommitTemporaryFile(const char* temporaryFilename, const char* filename, bool writeThrough);
@@ -0,0 +1,89 @@
+#include "TimerScheduler.h"
+#include <algorithm>
+
+unsigned int TimerScheduler::schedule(float deadline, Callback callback)
+{
+	return scheduleRepeating(deadline, 0.0f, callback);
+}
+
+unsigned int TimerScheduler::scheduleRepeating(float firstDeadline, float interval, Callback callback)
+{
+	Timer timer;
+	timer.deadline = firstDeadline;
+	timer.interval = interval;
+	timer.id = nextID++;
+	timer.callback = callback;
+	push(timer);
+	return timer.id;
+}
+
+void TimerScheduler::cancel(unsigned int id)
+{
+	//Cancelled timers stay in the heap with no callback and are dropped when they come due
+	for (unsigned int i = 0; i < timers.size(); i++)
+	{
+		if (timers[i].id == id)
+		{
+			timers[i].callback = nullptr;
+			timers[i].interval = 0.0f;
+		}
+	}
+}
+
+bool TimerScheduler::isScheduled(unsigned int id)
+{
+	for (unsigned int i = 0; i < timers.size(); i++)
+	{
+		if (timers[i].id == id && timers[i].callback)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void TimerScheduler::update(float time)
+{
+	while (timers.empty() == false && timers.front().deadline <= time)
+	{
+		std::pop_heap(timers.begin(), timers.end(), laterDeadline);
+		Timer timer = timers.back();
+		timers.pop_back();
+
+		if (!timer.callback)
+		{
+			continue;
+		}
+
+		//Re-arm before firing so the callback is free to cancel or clear
+		if (timer.interval > 0.0f)
+		{
+			Timer next = timer;
+			next.deadline = time + timer.interval;
+			push(next);
+		}
+
+		timer.callback(time);
+	}
+}
+
+void TimerScheduler::clear()
+{
+	timers.clear();
+}
+
+unsigned int TimerScheduler::getTimerCount()
+{
+	return timers.size();
+}
+
+bool TimerScheduler::laterDeadline(const Timer& a, const Timer& b)
+{
+	return a.deadline > b.deadline;
+}
+
+void TimerScheduler::push(Timer timer)
+{
+	timers.push_back(timer);
+	std::push_heap(timers.begin(), timers.end(), laterDeadline);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+//Fires callbacks when the game clock passes their deadline.
+//Timers are kept in a min-heap so an update only touches the timers that are actually due.
+class TimerScheduler
+{
+public:
+	typedef std::function<void(float)> Callback;
+	//Fire once when time reaches deadline. Returns an ID that can be passed to cancel.
+	unsigned int schedule(float deadline, Callback callback);
+	//Fire at firstDeadline and then every interval seconds after each firing.
+	unsigned int scheduleRepeating(float firstDeadline, float interval, Callback callback);
+	void cancel(unsigned int id);
+	bool isScheduled(unsigned int id);
+	//Run every timer whose deadline is <= time
+	void update(float time);
+	void clear();
+	unsigned int getTimerCount();
+private:
+	struct Timer
+	{
+		float deadline;
+		float interval;
+		unsigned int id;
+		Callback callback;
+	};
+	//std heap functions build a max-heap, so order by the later deadline to get a min-heap
+	static bool laterDeadline(const Timer& a, const Timer& b);
+	void push(Timer timer);
+	std::vector<Timer> timers;
+	unsigned int nextID = 1;
+};
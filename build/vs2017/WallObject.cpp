@@ -15,7 +15,7 @@ WallObject::WallObject(gef::Scene* sceneFile, b2World* world)
 
 	body->SetUserData(this);
 
-	this->set_type(PLAYER);
+	this->set_type(WALL);
 
 	lastDamageTime = 0;
 
@@ -65,12 +65,13 @@ void WallObject::update()
 {
 	objectTranslation = gef::Vector4(body->GetPosition().x, body->GetPosition().y, 0);
 	translationMatrix.SetTranslation(objectTranslation);
+	//Set here rather than in render so culling can test the object before it is drawn
+	this->set_transform((scaleMatrix * rotationMatrix) * translationMatrix);
 	return;
 }
 
 void WallObject::render(gef::Renderer3D* renderer_3d_)
 {
-	this->set_transform((scaleMatrix * rotationMatrix) * translationMatrix);
 	renderer_3d_->DrawMesh(*this);
 	return;
 }
@@ -7,14 +7,21 @@ Weapon::Weapon()
 	ammo = 0;
 	reloadTime = 0.0f;
 	name = "";
+	sfxPath = "";
 }
 
 Weapon::~Weapon()
 {
-	//delete icon;
 	icon = NULL;
 }
 
+void Weapon::releaseIcon()
+{
+	delete icon;
+	icon = NULL;
+	this->set_texture(NULL);
+}
+
 gef::Texture* Weapon::getIcon()
 {
 	return icon;
@@ -40,12 +47,12 @@ float Weapon::getReloadTime()
 	return reloadTime;
 }
 
-char* Weapon::getName()
+const char* Weapon::getName()
 {
 	return name;
 }
 
-void Weapon::create(const char* pngFileName, gef::Platform* platform, int newCost, int newDamage, int newMaxAmmo, float newReloadTime, char* newName, char* newSfxPath)
+void Weapon::create(const char* pngFileName, gef::Platform* platform, int newCost, int newDamage, int newMaxAmmo, float newReloadTime, const char* newName, const char* newSfxPath)
 {
 	if (icon == NULL)
 	{
@@ -91,7 +98,7 @@ void Weapon::setAmmo(int value)
 	ammo = value;
 }
 
-char* Weapon::getSfxPath()
+const char* Weapon::getSfxPath()
 {
 	return sfxPath;
 }
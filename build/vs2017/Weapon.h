@@ -17,18 +17,20 @@ public:
 	Weapon();
 	~Weapon();
 	gef::Texture* getIcon();
+	//Copies of a weapon share its icon, so only the copy create was called on deletes it
+	void releaseIcon();
 	int getCost();
 	int getDamage();
 	int getAmmo();
 	float getReloadTime();
-	char* getName();
-	void create(const char* pngFileName, gef::Platform* platform, int newCost, int newDamage, int newMaxAmmo, float newReloadTime, char* newName, char* newSfxPath);
+	const char* getName();
+	void create(const char* pngFileName, gef::Platform* platform, int newCost, int newDamage, int newMaxAmmo, float newReloadTime, const char* newName, const char* newSfxPath);
 	void decrementAmmo(int value);
 	float getRanOutOfAmmoTime();
 	void setRanOutOfAmmoTime(float newTime);
 	int getMaxAmmo();
 	void setAmmo(int value);
-	char* getSfxPath();
+	const char* getSfxPath();
 private:
 	gef::Texture* icon = NULL;
 	unsigned short int cost = 0;
@@ -37,7 +39,7 @@ private:
 	float reloadTime = 0.0f;
 	float ranOutOfAmmoTime = 0.0f;
 	unsigned short int maxAmmo = 0;
-	char* name;
-	char* sfxPath;
+	const char* name;
+	const char* sfxPath;
 };
 
@@ -1,6 +1,5 @@
 #include "game_object.h"
 #include <system/debug_log.h>
-#include <dos.h>
 
 //
 // UpdateFromSimulation
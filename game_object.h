@@ -3,14 +3,14 @@
 
 #include <graphics/mesh_instance.h>
 #include <box2d/Box2D.h>
-#include <thread>
-#include <dos.h>
 
 enum OBJECT_TYPE
 {
 	PLAYER,
 	ENEMY,
-	BULLET
+	BULLET,
+	WALL,
+	OBJECT_TYPE_COUNT
 };
 
 class GameObject : public gef::MeshInstance
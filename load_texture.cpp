@@ -4,19 +4,309 @@
 #include <graphics/image_data.h>
 #include <graphics/texture.h>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "PerfRecorder.h"
+#include "AssetPack.h"
+#include "AssetPrefetcher.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
+#include "TemporaryFile.h"
 
-gef::Texture* CreateTextureFromPNG(const char* png_filename, gef::Platform& platform)
+// Bump when the layout below changes so old cache files are rebuilt
+static const unsigned int textureCacheVersion = 2;
+static const char textureCacheMagic[4] = { 'G', 'T', 'C', '1' };
+static const unsigned int textureCacheFlagPremultiplied = 1;
+static const unsigned int textureCacheFlagMips = 2;
+
+struct TextureCacheHeader
+{
+	char magic[4];
+	unsigned int version;
+	// The PNG's modification time and size when the cache was built
+	unsigned long long sourceTime;
+	unsigned long long sourceSize;
+	unsigned int flags;
+	unsigned int width;
+	unsigned int height;
+	// Levels stored after the header, the base image included
+	unsigned int mipCount;
+};
+
+static TextureCacheOptions cacheOptions;
+// Atomic as images are also decoded on the prefetch threads
+static std::atomic<unsigned int> cacheHits(0);
+static std::atomic<unsigned int> cacheMisses(0);
+static MetricCounter& cacheHitsMetric = MetricsRegistry::instance().counter("asset_texture_cache_hits_total", "Textures read from the decoded cache or the asset pack");
+static MetricCounter& cacheMissesMetric = MetricsRegistry::instance().counter("asset_texture_cache_misses_total", "Textures decoded from PNG");
+static std::atomic<unsigned int> cacheWrites(0);
+
+static std::string CacheFilename(const char* png_filename)
+{
+	return std::string(png_filename) + ".texcache";
+}
+
+static unsigned int CacheFlags()
+{
+	unsigned int flags = 0;
+	if (cacheOptions.premultiplyAlpha)
+		flags |= textureCacheFlagPremultiplied;
+	if (cacheOptions.generateMips)
+		flags |= textureCacheFlagMips;
+	return flags;
+}
+
+// Notices a changed PNG from the file system alone, so a cache hit never reads the PNG
+static bool GetSourceStamp(const char* filename, unsigned long long& time, unsigned long long& size)
+{
+	struct stat info;
+	if (stat(filename, &info) != 0 || info.st_size <= 0)
+		return false;
+
+	time = (unsigned long long)info.st_mtime;
+	size = (unsigned long long)info.st_size;
+	return true;
+}
+
+// Reads the base level straight into a buffer the ImageData takes ownership of
+static bool ReadCache(const char* png_filename, unsigned long long sourceTime, unsigned long long sourceSize, gef::ImageData& image_data)
+{
+	FILE* file = fopen(CacheFilename(png_filename).c_str(), "rb");
+	if (!file)
+		return false;
+
+	TextureCacheHeader header;
+	bool success = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, textureCacheMagic, sizeof(header.magic)) == 0
+		&& header.version == textureCacheVersion
+		&& header.sourceTime == sourceTime
+		&& header.sourceSize == sourceSize
+		&& header.flags == CacheFlags()
+		&& header.width > 0 && header.height > 0;
+
+	if (success)
+	{
+		size_t pixelBytes = (size_t)header.width * header.height * 4;
+		UInt8* pixels = new UInt8[pixelBytes];
+		success = fread(pixels, 1, pixelBytes, file) == pixelBytes;
+		if (success)
+		{
+			image_data.set_width(header.width);
+			image_data.set_height(header.height);
+			image_data.set_image(pixels);
+		}
+		else
+		{
+			delete[] pixels;
+		}
+	}
+
+	fclose(file);
+	return success;
+}
+
+// The pack is built from freshly written caches, so only the layout and options need checking
+static bool ReadCacheFromPack(const char* png_filename, gef::ImageData& image_data)
+{
+	const char* data = NULL;
+	unsigned int size = 0;
+	if (!AssetPack::instance().find(CacheFilename(png_filename).c_str(), data, size) || size < sizeof(TextureCacheHeader))
+		return false;
+
+	TextureCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	size_t pixelBytes = (size_t)header.width * header.height * 4;
+	if (memcmp(header.magic, textureCacheMagic, sizeof(header.magic)) != 0
+		|| header.version != textureCacheVersion
+		|| header.flags != CacheFlags()
+		|| size < sizeof(header) + pixelBytes)
+		return false;
+
+	UInt8* pixels = new UInt8[pixelBytes];
+	memcpy(pixels, data + sizeof(header), pixelBytes);
+	image_data.set_width(header.width);
+	image_data.set_height(header.height);
+	image_data.set_image(pixels);
+	return true;
+}
+
+static void PremultiplyAlpha(UInt8* pixels, size_t pixelCount)
+{
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		UInt8* pixel = pixels + i * 4;
+		unsigned int alpha = pixel[3];
+		pixel[0] = (UInt8)((pixel[0] * alpha + 127) / 255);
+		pixel[1] = (UInt8)((pixel[1] * alpha + 127) / 255);
+		pixel[2] = (UInt8)((pixel[2] * alpha + 127) / 255);
+	}
+}
+
+// Appends each 2x2 box filtered level after the previous one until the image is 1x1
+static unsigned int BuildMipChain(std::vector<UInt8>& levels, unsigned int width, unsigned int height)
+{
+	unsigned int mipCount = 1;
+	size_t previous = 0;
+
+	while (width > 1 || height > 1)
+	{
+		unsigned int mipWidth = width > 1 ? width / 2 : 1;
+		unsigned int mipHeight = height > 1 ? height / 2 : 1;
+		size_t start = levels.size();
+		levels.resize(start + (size_t)mipWidth * mipHeight * 4);
+
+		for (unsigned int y = 0; y < mipHeight; y++)
+		{
+			for (unsigned int x = 0; x < mipWidth; x++)
+			{
+				unsigned int x0 = x * 2, y0 = y * 2;
+				unsigned int x1 = x0 + 1 < width ? x0 + 1 : x0;
+				unsigned int y1 = y0 + 1 < height ? y0 + 1 : y0;
+				for (unsigned int channel = 0; channel < 4; channel++)
+				{
+					unsigned int sum = levels[previous + ((size_t)y0 * width + x0) * 4 + channel]
+						+ levels[previous + ((size_t)y0 * width + x1) * 4 + channel]
+						+ levels[previous + ((size_t)y1 * width + x0) * 4 + channel]
+						+ levels[previous + ((size_t)y1 * width + x1) * 4 + channel];
+					levels[start + ((size_t)y * mipWidth + x) * 4 + channel] = (UInt8)((sum + 2) / 4);
+				}
+			}
+		}
+
+		previous = start;
+		width = mipWidth;
+		height = mipHeight;
+		mipCount++;
+	}
+
+	return mipCount;
+}
+
+static void WriteCache(const char* png_filename, unsigned long long sourceTime, unsigned long long sourceSize, gef::ImageData& image_data)
 {
+	TextureCacheHeader header;
+	memcpy(header.magic, textureCacheMagic, sizeof(header.magic));
+	header.version = textureCacheVersion;
+	header.sourceTime = sourceTime;
+	header.sourceSize = sourceSize;
+	header.flags = CacheFlags();
+	header.width = image_data.width();
+	header.height = image_data.height();
+	header.mipCount = 1;
+
+	std::vector<UInt8> levels(image_data.image(), image_data.image() + (size_t)header.width * header.height * 4);
+	if (cacheOptions.generateMips)
+	{
+		header.mipCount = BuildMipChain(levels, header.width, header.height);
+	}
+
+	// Write to a temporary name first so a half written cache is never picked up,
+	// and only replace the old cache once the new one is complete
+	std::string cacheFilename = CacheFilename(png_filename);
+	std::string tempFilename = cacheFilename + ".tmp";
+	FILE* file = fopen(tempFilename.c_str(), "wb");
+	if (!file)
+		return;
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(&levels[0], 1, levels.size(), file) == levels.size();
+	success = fclose(file) == 0 && success;
+
+	if (success && CommitTemporaryFile(tempFilename.c_str(), cacheFilename.c_str(), false))
+	{
+		cacheWrites++;
+	}
+	else
+	{
+		remove(tempFilename.c_str());
+	}
+}
+
+bool LoadImageDataFromPNG(const char* png_filename, gef::Platform& platform, gef::ImageData& image_data)
+{
+	ScopedMemoryTag memoryTag(MEMORY_TAG_ASSETS);
+
+	if (cacheOptions.enabled && AssetPack::instance().isMounted() && ReadCacheFromPack(png_filename, image_data))
+	{
+		cacheHits++;
+		cacheHitsMetric.add();
+		return true;
+	}
+
+	unsigned long long sourceTime = 0;
+	unsigned long long sourceSize = 0;
+	bool haveSource = cacheOptions.enabled && GetSourceStamp(png_filename, sourceTime, sourceSize);
+
+	if (haveSource && ReadCache(png_filename, sourceTime, sourceSize, image_data))
+	{
+		cacheHits++;
+		cacheHitsMetric.add();
+		return true;
+	}
+
+	// load image data from PNG file 
 	gef::PNGLoader png_loader;
+	png_loader.Load(png_filename, platform, image_data);
+	if (image_data.image() == NULL)
+		return false;
+
+	cacheMisses++;
+	cacheMissesMetric.add();
+
+	if (cacheOptions.premultiplyAlpha)
+		PremultiplyAlpha(image_data.image(), (size_t)image_data.width() * image_data.height());
+
+	if (haveSource)
+		WriteCache(png_filename, sourceTime, sourceSize, image_data);
+
+	return true;
+}
+
+gef::Texture* CreateTextureFromPNG(const char* png_filename, gef::Platform& platform)
+{
+	ScopedMemoryTag memoryTag(MEMORY_TAG_ASSETS);
 	gef::ImageData image_data;
 	gef::Texture* texture = NULL;
+	double startTime = PerfRecorder::nowMilliseconds();
 
-	// load image data from PNG file 
-	png_loader.Load(png_filename, platform, image_data);
+	// use the image data if it was decoded ahead of time, otherwise load it now
+	if (!AssetPrefetcher::instance().createTexture(png_filename, platform, texture))
+	{
+		AssetPrefetcher::instance().recordMiss();
+
+		// if the image data is valid, then create a texture from it
+		if (LoadImageDataFromPNG(png_filename, platform, image_data))
+			texture = gef::Texture::Create(platform, image_data);
+	}
 
-	// if the image data is valid, then create a texture from it
-	if (image_data.image() != NULL)
-		texture = gef::Texture::Create(platform, image_data);
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample(std::string("CreateTextureFromPNG/") + png_filename, PerfRecorder::nowMilliseconds() - startTime);
+	}
 
 	return texture;
 }
+
+bool PrewarmTextureCache(const char* png_filename, gef::Platform& platform)
+{
+	gef::ImageData image_data;
+	return LoadImageDataFromPNG(png_filename, platform, image_data);
+}
+
+void SetTextureCacheOptions(const TextureCacheOptions& options)
+{
+	cacheOptions = options;
+}
+
+TextureCacheStats GetTextureCacheStats()
+{
+	TextureCacheStats stats;
+	stats.hits = cacheHits;
+	stats.misses = cacheMisses;
+	stats.writes = cacheWrites;
+	return stats;
+}
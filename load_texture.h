@@ -4,9 +4,38 @@
 #include <system/platform.h>
 #include <graphics/texture.h>
 
+namespace gef
+{
+	class ImageData;
+}
+
+// Decoded PNGs are cached next to the source as <name>.texcache, keyed by the PNG's modification time and size,
+// so a hit reads only the cache.
+// A cache that is missing, stale or was written with different options falls back to decoding the PNG.
+struct TextureCacheOptions
+{
+	bool enabled = true;
+	// Multiply colour by alpha when the cache is built
+	bool premultiplyAlpha = false;
+	// Also store box filtered mip levels after the base image
+	bool generateMips = false;
+};
+
+struct TextureCacheStats
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int writes = 0;
+};
+
 // FUNCTION PROTOTYPES
 gef::Texture* CreateTextureFromPNG(const char* png_filename, gef::Platform& platform);
+// Fill image_data with the decoded RGBA for a PNG, using the cache when it is up to date
+bool LoadImageDataFromPNG(const char* png_filename, gef::Platform& platform, gef::ImageData& image_data);
+// Decode a PNG and write its cache file if it is missing or stale
+bool PrewarmTextureCache(const char* png_filename, gef::Platform& platform);
+void SetTextureCacheOptions(const TextureCacheOptions& options);
+TextureCacheStats GetTextureCacheStats();
 
 #endif // _LOAD_TEXTURE_H
 
-
@@ -1,15 +1,183 @@
 #include <platform/d3d11/system/platform_d3d11.h>
 #include "scene_app.h"
+#include "load_texture.h"
+#include "AssetPack.h"
+#include "CompactAudio.h"
+#include "MemoryTracker.h"
+#include "SessionSim.h"
+#include "Metrics.h"
+#include "StartupTrace.h"
+#include "AudioCommands.h"
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
 
 unsigned int sceLibcHeapSize = 128*1024*1024;	// Sets up the heap area size as 128MiB.
 
+// everything the game loads through LoadSceneAssets and CreateTextureFromPNG, grouped by the state that loads it
+// textures are packed as their decoded cache files
+static const AssetPackSource pack_sources[] =
+{
+	{ "groundSprite.png.texcache", ASSET_GROUP_SHARED },
+	{ "SplashIcon.png.texcache", ASSET_GROUP_SPLASH },
+	{ "playbuttonWhite.png.texcache", ASSET_GROUP_FRONTEND },
+	{ "mainMenuBackground.png.texcache", ASSET_GROUP_FRONTEND },
+	{ "fast-forward-button.png.texcache", ASSET_GROUP_FRONTEND },
+	{ "fast-backward-button.png.texcache", ASSET_GROUP_FRONTEND },
+	{ "NewHouse.scn", ASSET_GROUP_GAME },
+	{ "stickman.scn", ASSET_GROUP_GAME },
+	{ "wall.scn", ASSET_GROUP_GAME },
+	{ "handgun.png.texcache", ASSET_GROUP_GAME },
+	{ "healthpackicon.png.texcache", ASSET_GROUP_STORE },
+	{ "on-sight.png.texcache", ASSET_GROUP_STORE },
+	{ "hammer-nails.png.texcache", ASSET_GROUP_STORE },
+	{ "sniper_icon_2.png.texcache", ASSET_GROUP_STORE },
+	{ "assault_rifle_icon_1.png.texcache", ASSET_GROUP_STORE },
+	{ "shotgun_icon_2.png.texcache", ASSET_GROUP_STORE },
+	{ "SelectedWeaponSprite.png.texcache", ASSET_GROUP_STORE },
+	{ "failScreenBackground.png.texcache", ASSET_GROUP_FAIL },
+};
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
 {
+	// time to first frame is measured from here and written to startup_trace.json
+	StartupTrace::instance().start();
+	unsigned int platform_span = StartupTrace::instance().beginSpan("Platform");
+
 	// initialisation
 	gef::PlatformD3D11 platform(hInstance, 960, 544, false, true);
+	StartupTrace::instance().endSpan(platform_span);
+
+	// decode every PNG in the working directory (media) into the texture cache and exit
+	// --build-pack does the same and then packs the caches and scenes into assets.pak
+	bool build_pack = pScmdline && strstr(pScmdline, "--build-pack");
+	if (pScmdline && (strstr(pScmdline, "--prewarm-textures") || build_pack))
+	{
+		WIN32_FIND_DATAA find_data;
+		HANDLE find = FindFirstFileA("*.png", &find_data);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				PrewarmTextureCache(find_data.cFileName, platform);
+			} while (FindNextFileA(find, &find_data));
+			FindClose(find);
+		}
+
+		if (build_pack)
+		{
+			AssetPack::build("assets.pak", pack_sources, sizeof(pack_sources) / sizeof(pack_sources[0]));
+		}
+		return 0;
+	}
+
+	// convert every WAV in the working directory to a compact .adp next to it,
+	// --audio-benchmark then compares resident memory and load time of the two formats
+	bool audio_benchmark = pScmdline && strstr(pScmdline, "--audio-benchmark");
+	if (pScmdline && (strstr(pScmdline, "--convert-audio") || audio_benchmark))
+	{
+		std::vector<std::string> wav_filenames;
+		WIN32_FIND_DATAA find_data;
+		HANDLE find = FindFirstFileA("*.wav", &find_data);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				std::string wav_filename(find_data.cFileName);
+				std::string compact_filename = wav_filename.substr(0, wav_filename.find_last_of('.')) + ".adp";
+				if (ConvertWavToCompact(wav_filename.c_str(), compact_filename.c_str()))
+				{
+					wav_filenames.push_back(wav_filename);
+				}
+			} while (FindNextFileA(find, &find_data));
+			FindClose(find);
+		}
+
+		if (audio_benchmark)
+		{
+			std::vector<const char*> names;
+			for (size_t i = 0; i < wav_filenames.size(); i++)
+			{
+				names.push_back(wav_filenames[i].c_str());
+			}
+			RunAudioBenchmark(names.data(), (unsigned int)names.size(), "audio_benchmark.json");
+		}
+		return 0;
+	}
+
+	// mix hundreds of software voices and write the cost per buffer to mixer_benchmark.json
+	if (pScmdline && strstr(pScmdline, "--mixer-benchmark"))
+	{
+		const unsigned int voice_counts[] = { 16, 64, 256, 512 };
+		RunMixerBenchmark(voice_counts, sizeof(voice_counts) / sizeof(voice_counts[0]), "mixer_benchmark.json");
+		return 0;
+	}
+
+	// play whole sessions headless for every store policy and write per day stats to session_sweep.json
+	// --sessions=N sets the sessions per policy and --threads=N the worker count, all cores by default
+	if (pScmdline && strstr(pScmdline, "--session-sweep"))
+	{
+		const char* sessions_arg = strstr(pScmdline, "--sessions=");
+		const char* threads_arg = strstr(pScmdline, "--threads=");
+		unsigned int sessions = sessions_arg ? (unsigned int)atoi(sessions_arg + strlen("--sessions=")) : 2000;
+		unsigned int threads = threads_arg ? (unsigned int)atoi(threads_arg + strlen("--threads=")) : 0;
+		return RunSessionSweep(sessions > 0 ? sessions : 1, threads, "session_sweep.json") ? 0 : 1;
+	}
+
+	// post audio commands from this thread to the audio thread with nothing behind it and write the rate and latency to command_ring_stress.json
+	// --commands=N sets how many are posted
+	if (pScmdline && strstr(pScmdline, "--command-ring-stress"))
+	{
+		const char* commands_arg = strstr(pScmdline, "--commands=");
+		unsigned long long commands = commands_arg ? strtoull(commands_arg + strlen("--commands="), NULL, 10) : 20000000;
+		return RunCommandRingStress(commands > 0 ? commands : 1, "command_ring_stress.json") ? 0 : 1;
+	}
 
 	SceneApp myApp(platform);
+	bool benchmark = pScmdline && strstr(pScmdline, "--benchmark");
+	if (benchmark)
+	{
+		myApp.setBenchmarkMode(true);
+	}
+	if (pScmdline && strstr(pScmdline, "--large-waves"))
+	{
+		myApp.setLargeWaveMode(true);
+	}
+	if (pScmdline && strstr(pScmdline, "--lane-movement"))
+	{
+		myApp.setLaneMovement(true);
+	}
+	// start in a saved game, e.g. --resume=checkpoint.sav for the last day reached or --resume=quicksave.sav for the F5 save
+	std::string resume_filename;
+	const char* resume_arg = pScmdline ? strstr(pScmdline, "--resume=") : NULL;
+	if (resume_arg)
+	{
+		resume_filename = resume_arg + strlen("--resume=");
+		resume_filename = resume_filename.substr(0, resume_filename.find(' '));
+		myApp.setResumeFile(resume_filename.c_str());
+	}
+	// write live counters in Prometheus text format to metrics.prom once a second
+	if (pScmdline && strstr(pScmdline, "--metrics"))
+	{
+		MetricsRegistry::instance().enable("metrics.prom", 1000.0);
+	}
+	// quit after the first frame, failing if start up took longer than its budget
+	bool startup_check = pScmdline && strstr(pScmdline, "--startup-check");
+	if (startup_check)
+	{
+		myApp.setStartupCheckMode(true);
+	}
 	myApp.Run();
 
+	// a headless run fails if any memory budget was broken
+	if (benchmark && MemoryTracker::instance().isOverBudget())
+	{
+		return 1;
+	}
+	if (startup_check && StartupTrace::instance().isOverBudget())
+	{
+		return 1;
+	}
 	return 0;
 }
\ No newline at end of file
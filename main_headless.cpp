@@ -0,0 +1,121 @@
+#include <NullPlatform.h>
+#include "scene_app.h"
+#include "MemoryTracker.h"
+#include "SessionSim.h"
+#include "Metrics.h"
+#include "StartupTrace.h"
+#include "AudioCommands.h"
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+// the Linux entry point, run from media. Nothing is drawn or played and input comes from a script,
+// so whole sessions can be played on machines with no display, sound or input devices
+int main(int argc, char** argv)
+{
+	StartupTrace::instance().start();
+	unsigned int platform_span = StartupTrace::instance().beginSpan("Platform");
+
+	// the same size as the Windows window, so scripted taps land in the same places
+	NullPlatform platform(960, 544, 1.0f / 60.0f);
+	StartupTrace::instance().endSpan(platform_span);
+
+	// the arguments as one line, so they are matched the same way as WinMain's
+	std::string command_line;
+	for (int i = 1; i < argc; i++)
+	{
+		command_line += argv[i];
+		command_line += ' ';
+	}
+	const char* pScmdline = command_line.c_str();
+
+	// play whole sessions headless for every store policy and write per day stats to session_sweep.json
+	// --sessions=N sets the sessions per policy and --threads=N the worker count, all cores by default
+	if (strstr(pScmdline, "--session-sweep"))
+	{
+		const char* sessions_arg = strstr(pScmdline, "--sessions=");
+		const char* threads_arg = strstr(pScmdline, "--threads=");
+		unsigned int sessions = sessions_arg ? (unsigned int)atoi(sessions_arg + strlen("--sessions=")) : 2000;
+		unsigned int threads = threads_arg ? (unsigned int)atoi(threads_arg + strlen("--threads=")) : 0;
+		return RunSessionSweep(sessions > 0 ? sessions : 1, threads, "session_sweep.json") ? 0 : 1;
+	}
+
+	// post audio commands from this thread to the audio thread with nothing behind it and write the rate and latency to command_ring_stress.json
+	// --commands=N sets how many are posted
+	if (strstr(pScmdline, "--command-ring-stress"))
+	{
+		const char* commands_arg = strstr(pScmdline, "--commands=");
+		unsigned long long commands = commands_arg ? strtoull(commands_arg + strlen("--commands="), NULL, 10) : 20000000;
+		return RunCommandRingStress(commands > 0 ? commands : 1, "command_ring_stress.json") ? 0 : 1;
+	}
+
+	SceneApp myApp(platform);
+	myApp.setHeadless(true);
+	bool benchmark = strstr(pScmdline, "--benchmark") != NULL;
+	if (benchmark)
+	{
+		myApp.setBenchmarkMode(true);
+	}
+	if (strstr(pScmdline, "--large-waves"))
+	{
+		myApp.setLargeWaveMode(true);
+	}
+	if (strstr(pScmdline, "--lane-movement"))
+	{
+		myApp.setLaneMovement(true);
+	}
+	// start in a saved game, e.g. --resume=checkpoint.sav
+	std::string resume_filename;
+	const char* resume_arg = strstr(pScmdline, "--resume=");
+	if (resume_arg)
+	{
+		resume_filename = resume_arg + strlen("--resume=");
+		resume_filename = resume_filename.substr(0, resume_filename.find(' '));
+		myApp.setResumeFile(resume_filename.c_str());
+	}
+	// write live counters in Prometheus text format to metrics.prom once a second
+	if (strstr(pScmdline, "--metrics"))
+	{
+		MetricsRegistry::instance().enable("metrics.prom", 1000.0);
+	}
+	// quit after the first frame, failing if start up took longer than its budget
+	bool startup_check = strstr(pScmdline, "--startup-check") != NULL;
+	if (startup_check)
+	{
+		myApp.setStartupCheckMode(true);
+	}
+
+	// otherwise soak: play the input script for --frames=N frames, 15 minutes of game time by default,
+	// and write sessions played, draw calls, frame times and memory peaks to soak_results.json
+	// --script=FILE picks the script, soak.input by default
+	bool soak = benchmark == false && startup_check == false;
+	if (soak)
+	{
+		std::string script_filename = "soak.input";
+		const char* script_arg = strstr(pScmdline, "--script=");
+		if (script_arg)
+		{
+			script_filename = script_arg + strlen("--script=");
+			script_filename = script_filename.substr(0, script_filename.find(' '));
+		}
+		if (myApp.loadInputScript(script_filename.c_str()) == false)
+		{
+			return 1;
+		}
+		const char* frames_arg = strstr(pScmdline, "--frames=");
+		unsigned int frames = frames_arg ? (unsigned int)atoi(frames_arg + strlen("--frames=")) : 54000;
+		myApp.setSoakFrames(frames > 0 ? frames : 1);
+	}
+	myApp.Run();
+
+	// a headless run fails if any memory budget was broken
+	if ((benchmark || soak) && MemoryTracker::instance().isOverBudget())
+	{
+		return 1;
+	}
+	if (startup_check && StartupTrace::instance().isOverBudget())
+	{
+		return 1;
+	}
+	return 0;
+}
@@ -5,15 +5,44 @@
 #include <maths/math_utils.h>
 #include <vector>
 #include <math.h>
+#include "PerfRecorder.h"
+#include "MemoryTracker.h"
+
+//Box index data is the same for every box, the faces' vertices are laid out in the same order
+static const int kNumBoxIndices = 6 * 6;
+static const Int32 box_indices[kNumBoxIndices] =
+{
+	// front
+	0, 1, 2,
+	1, 3, 2,
+
+	// back
+	4, 5, 6,
+	5, 7, 6,
+
+	// left
+	8, 9, 10,
+	9, 11, 10,
+
+	// right
+	12, 13, 14,
+	13, 15, 14,
+
+	// top
+	16, 17, 18,
+	17, 19, 18,
+
+	// bottom
+	20, 21, 22,
+	21, 23, 22
+};
 
 
 //
 // PrimitiveBuilder
 //
 PrimitiveBuilder::PrimitiveBuilder(gef::Platform& platform) :
-	platform_(platform),
-	default_cube_mesh_(NULL),
-	default_sphere_mesh_(NULL)
+	platform_(platform)
 {
 	Init();
 }
@@ -31,9 +60,7 @@ PrimitiveBuilder::~PrimitiveBuilder()
 //
 void PrimitiveBuilder::Init()
 {
-	// create helper geometry
-	default_cube_mesh_ = CreateBoxMesh(gef::Vector4(0.5f, 0.5f, 0.5f));
-	default_sphere_mesh_ = CreateSphereMesh(0.5f, 20, 20);
+	// helper geometry is built the first time it is asked for
 
 	// create materials for basic colours
 	red_material_.set_colour(0xff0000ff);
@@ -46,11 +73,102 @@ void PrimitiveBuilder::Init()
 //
 void PrimitiveBuilder::CleanUp()
 {
-	delete default_sphere_mesh_;
-	default_sphere_mesh_ = NULL;
+	for (size_t i = 0; i < cached_meshes_.size(); ++i)
+	{
+		delete cached_meshes_[i].mesh;
+	}
+	cached_meshes_.clear();
+
+	for (size_t i = 0; i < sphere_indices_.size(); ++i)
+	{
+		delete sphere_indices_[i];
+	}
+	sphere_indices_.clear();
+}
+
+//
+// FindCachedMesh
+//
+gef::Mesh* PrimitiveBuilder::FindCachedMesh(const CachedMesh& key)
+{
+	for (size_t i = 0; i < cached_meshes_.size(); ++i)
+	{
+		const CachedMesh& cached = cached_meshes_[i];
+		if (cached.shape == key.shape && cached.phi == key.phi && cached.theta == key.theta
+			&& cached.size[0] == key.size[0] && cached.size[1] == key.size[1] && cached.size[2] == key.size[2]
+			&& cached.centre[0] == key.centre[0] && cached.centre[1] == key.centre[1] && cached.centre[2] == key.centre[2])
+		{
+			stats_.cache_hits++;
+			return cached.mesh;
+		}
+	}
+	return NULL;
+}
+
+//
+// GetBoxMesh
+//
+const gef::Mesh* PrimitiveBuilder::GetBoxMesh(const gef::Vector4& half_size, const gef::Vector4& centre)
+{
+	CachedMesh key;
+	key.shape = kBox;
+	key.size[0] = half_size.x();
+	key.size[1] = half_size.y();
+	key.size[2] = half_size.z();
+	key.centre[0] = centre.x();
+	key.centre[1] = centre.y();
+	key.centre[2] = centre.z();
+	key.phi = 0;
+	key.theta = 0;
+
+	key.mesh = FindCachedMesh(key);
+	if (key.mesh == NULL)
+	{
+		key.mesh = CreateBoxMesh(half_size, centre);
+		cached_meshes_.push_back(key);
+	}
+	return key.mesh;
+}
+
+//
+// GetSphereMesh
+//
+const gef::Mesh* PrimitiveBuilder::GetSphereMesh(const float radius, const int phi, const int theta, const gef::Vector4& centre)
+{
+	CachedMesh key;
+	key.shape = kSphere;
+	key.size[0] = radius;
+	key.size[1] = radius;
+	key.size[2] = radius;
+	key.centre[0] = centre.x();
+	key.centre[1] = centre.y();
+	key.centre[2] = centre.z();
+	key.phi = phi;
+	key.theta = theta;
+
+	key.mesh = FindCachedMesh(key);
+	if (key.mesh == NULL)
+	{
+		key.mesh = CreateSphereMesh(radius, phi, theta, centre);
+		cached_meshes_.push_back(key);
+	}
+	return key.mesh;
+}
 
-	delete default_cube_mesh_;
-	default_cube_mesh_ = NULL;
+//
+// RecordBuild
+//
+void PrimitiveBuilder::RecordBuild(double start_time, UInt32 num_vertices, UInt32 num_indices)
+{
+	double build_time = PerfRecorder::nowMilliseconds() - start_time;
+	stats_.meshes_built++;
+	stats_.build_milliseconds += build_time;
+	stats_.vertex_bytes += num_vertices * sizeof(gef::Mesh::Vertex);
+	stats_.index_bytes += num_indices * sizeof(Int32);
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("Primitives/build_mesh", build_time);
+	}
 }
 
 //
@@ -58,6 +176,8 @@ void PrimitiveBuilder::CleanUp()
 //
 gef::Mesh* PrimitiveBuilder::CreateBoxMesh(const gef::Vector4& half_size, gef::Vector4 centre, gef::Material** materials)
 {
+	double start_time = PerfRecorder::nowMilliseconds();
+	ScopedMemoryTag memory_tag(MEMORY_TAG_ASSETS);
 	gef::Mesh* mesh = gef::Mesh::Create(platform_);
 
 	//
@@ -107,34 +227,6 @@ gef::Mesh* PrimitiveBuilder::CreateBoxMesh(const gef::Vector4& half_size, gef::V
 		{ centre.x() + half_size.x(),	centre.y() - half_size.y(), centre.z() - half_size.z(), 0.0f, -1.0f, 0.0f, 1.0f, 1.0f },
 	};
 
-	const int kNumIndices = 6 * 6;
-	Int32 indices[kNumIndices] =
-	{
-		// front
-		0, 1, 2,
-		1, 3, 2,
-
-		// back
-		4, 5, 6,
-		5, 7, 6,
-
-		// left
-		8, 9, 10,
-		9, 11, 10,
-
-		// right
-		12, 13, 14,
-		13, 15, 14,
-
-		// top
-		16, 17, 18,
-		17, 19, 18,
-
-		// bottom
-		20, 21, 22,
-		21, 23, 22
-	};
-
 	// create the vertex buffer for the box vertices
 	mesh->InitVertexBuffer(platform_, vertices, kNumVertices, sizeof(gef::Mesh::Vertex));
 
@@ -145,7 +237,7 @@ gef::Mesh* PrimitiveBuilder::CreateBoxMesh(const gef::Vector4& half_size, gef::V
 	for (int primitive_num = 0; primitive_num < num_faces; ++primitive_num)
 	{
 		gef::Primitive* primitive = mesh->GetPrimitive(primitive_num);
-		primitive->InitIndexBuffer(platform_, &indices[primitive_num*6], 6, sizeof(Int32));
+		primitive->InitIndexBuffer(platform_, &box_indices[primitive_num*6], 6, sizeof(Int32));
 		primitive->set_type(gef::TRIANGLE_LIST);
 
 		// if materials pointer is valid then assume we have an array of Material pointers
@@ -163,7 +255,8 @@ gef::Mesh* PrimitiveBuilder::CreateBoxMesh(const gef::Vector4& half_size, gef::V
 	// bounding sphere
 	gef::Sphere sphere(aabb);
 	mesh->set_bounding_sphere(sphere);
-	
+
+	RecordBuild(start_time, kNumVertices, kNumBoxIndices);
 	return mesh;
 }
 
@@ -186,6 +279,8 @@ gef::Vector4 CalculateSphereSurfaceNormal(const float radius, const gef::Vector4
 // http://www.visualizationlibrary.org/documentation/_geometry_primitives_8cpp_source.html#l00284
 gef::Mesh* PrimitiveBuilder::CreateSphereMesh(const float radius, const int phi, const int theta, gef::Vector4 origin, gef::Material* material)
 {
+	double start_time = PerfRecorder::nowMilliseconds();
+	ScopedMemoryTag memory_tag(MEMORY_TAG_ASSETS);
 	gef::Mesh* mesh = gef::Mesh::Create(platform_);
 
 	const int kNumVertices = theta*phi + 2;
@@ -255,8 +350,53 @@ gef::Mesh* PrimitiveBuilder::CreateSphereMesh(const float radius, const int phi,
 	mesh->InitVertexBuffer(platform_, &vertices[0], kNumVertices, sizeof(gef::Mesh::Vertex));
 	mesh->AllocatePrimitives(2);
 
+	const SphereIndices& indices = GetSphereIndices(phi, theta);
+
+	gef::Primitive* primitive;
+
+	// setup primitive for side quads
+	primitive = mesh->GetPrimitive(0);
+	primitive->set_type(gef::TRIANGLE_LIST);
+	primitive->set_material(material);
+	primitive->InitIndexBuffer(platform_, &indices.sides[0], (UInt32)indices.sides.size(), sizeof(Int32));
+
+	// setup primitive for top and bottom fans
+	primitive = mesh->GetPrimitive(1);
+	primitive->set_type(gef::TRIANGLE_LIST);
+	primitive->set_material(material);
+	primitive->InitIndexBuffer(platform_, &indices.caps[0], (UInt32)indices.caps.size(), sizeof(Int32));
+
+	// bounds
+	gef::Aabb aabb(gef::Vector4(-radius, -radius, -radius) - origin, gef::Vector4(radius, radius, radius)+ origin);
+	mesh->set_aabb(aabb);
+	gef::Sphere sphere(origin, radius);
+	mesh->set_bounding_sphere(sphere);
+
+	RecordBuild(start_time, kNumVertices, (UInt32)(indices.sides.size() + indices.caps.size()));
+	return mesh;
+}
+
+//
+// GetSphereIndices
+//
+const PrimitiveBuilder::SphereIndices& PrimitiveBuilder::GetSphereIndices(const int phi, const int theta)
+{
+	for (size_t i = 0; i < sphere_indices_.size(); ++i)
+	{
+		if (sphere_indices_[i]->phi == phi && sphere_indices_[i]->theta == theta)
+		{
+			stats_.index_sets_shared++;
+			return *sphere_indices_[i];
+		}
+	}
+
+	SphereIndices* indices = new SphereIndices();
+	indices->phi = phi;
+	indices->theta = theta;
+	const int kNumVertices = theta*phi + 2;
+
 	// side quads
-	std::vector<Int32> index_buffer;
+	std::vector<Int32>& index_buffer = indices->sides;
 	index_buffer.resize((theta - 1)*phi * 6);
 
 	int idx = 0;
@@ -275,45 +415,28 @@ gef::Mesh* PrimitiveBuilder::CreateSphereMesh(const float radius, const int phi,
 		}
 	}
 
-	gef::Primitive* primitive;
-
-	// setup primitive for side quads
-	primitive = mesh->GetPrimitive(0);
-	primitive->set_type(gef::TRIANGLE_LIST);
-	primitive->set_material(material);
-	primitive->InitIndexBuffer(platform_, &index_buffer[0], (UInt32)index_buffer.size(), sizeof(Int32));
-
 	// top/bottom triangles
-	index_buffer.resize(phi * 3 + phi * 3);
+	std::vector<Int32>& fan_buffer = indices->caps;
+	fan_buffer.resize(phi * 3 + phi * 3);
 
 	idx = 0;
 	// top fan
 	for (int j = 0; j<phi; ++j)
 	{
-		index_buffer.at(idx++) = 1 + (j + 1) % phi;
-		index_buffer.at(idx++) = 1 + (j + 0) % phi;
-		index_buffer.at(idx++) = 0;
+		fan_buffer.at(idx++) = 1 + (j + 1) % phi;
+		fan_buffer.at(idx++) = 1 + (j + 0) % phi;
+		fan_buffer.at(idx++) = 0;
 	}
-	
+
 	// bottom fan
 	for (int j = 0; j<phi; ++j)
 	{
-		index_buffer.at(idx++) = 1 + phi*(theta - 1) + (j + 0) % phi;
-		index_buffer.at(idx++) = 1 + phi*(theta - 1) + (j + 1) % phi;
-		index_buffer.at(idx++) = (int)kNumVertices - 1;
+		fan_buffer.at(idx++) = 1 + phi*(theta - 1) + (j + 0) % phi;
+		fan_buffer.at(idx++) = 1 + phi*(theta - 1) + (j + 1) % phi;
+		fan_buffer.at(idx++) = (int)kNumVertices - 1;
 	}
 
-	// setup primitive for top and bottom fans
-	primitive = mesh->GetPrimitive(1);
-	primitive->set_type(gef::TRIANGLE_LIST);
-	primitive->set_material(material);
-	primitive->InitIndexBuffer(platform_, &index_buffer[0], (UInt32)index_buffer.size(), sizeof(Int32));
-
-	// bounds
-	gef::Aabb aabb(gef::Vector4(-radius, -radius, -radius) - origin, gef::Vector4(radius, radius, radius)+ origin);
-	mesh->set_aabb(aabb);
-	gef::Sphere sphere(origin, radius);
-	mesh->set_bounding_sphere(sphere);
-
-	return mesh;
+	sphere_indices_.push_back(indices);
+	stats_.index_sets_built++;
+	return *indices;
 }
@@ -3,7 +3,9 @@
 
 #include <maths/vector4.h>
 #include <graphics/material.h>
+#include <gef.h>
 #include <cstddef>
+#include <vector>
 
 namespace gef
 {
@@ -11,9 +13,24 @@ namespace gef
 	class Platform;
 }
 
+/// Builds box and sphere meshes. Get*Mesh keeps one mesh per set of parameters and hands the same one back after,
+/// so a builder that lives for the whole run builds each shape once. Spheres with the same phi and theta share their index data.
 class PrimitiveBuilder
 {
 public:
+	/// @brief Counts for everything the builder has built.
+	struct Stats
+	{
+		unsigned int meshes_built = 0;
+		unsigned int cache_hits = 0;
+		unsigned int index_sets_built = 0;
+		unsigned int index_sets_shared = 0;
+		double build_milliseconds = 0.0;
+		/// Size of the vertex and index buffers made for the meshes
+		unsigned long long vertex_bytes = 0;
+		unsigned long long index_bytes = 0;
+	};
+
 	/// @brief Constructor.
 	/// @param[in] platform		The platform the primitive builder is being created on.
 	PrimitiveBuilder(gef::Platform& platform);
@@ -27,8 +44,20 @@ public:
 	/// @brief Clean up resources created by the primitive builder.
 	void CleanUp();
 
+	/// @brief Gets a box shaped mesh owned by the builder, building it the first time these parameters are used.
+	/// @return The mesh. It is deleted with the builder.
+	/// @param[in] half_size	The half size of the box.
+	/// @param[in] centre		The centre of the box.
+	const gef::Mesh* GetBoxMesh(const gef::Vector4& half_size, const gef::Vector4& centre = gef::Vector4(0.0f, 0.0f, 0.0f));
+
+	/// @brief Gets a sphere shaped mesh owned by the builder, building it the first time these parameters are used.
+	/// @return The mesh. It is deleted with the builder.
+	/// @param[in] radius		The radius of the sphere.
+	/// @param[in] centre		The centre of the sphere.
+	const gef::Mesh* GetSphereMesh(const float radius, const int phi, const int theta, const gef::Vector4& centre = gef::Vector4(0.0f, 0.0f, 0.0f));
+
 	/// @brief Creates a box shaped mesh
-	/// @return The mesh created
+	/// @return The mesh created. The caller owns it.
 	/// @param[in] half_size	The half size of the box.
 	/// @param[in] centre		The centre of the box.
 	/// @param[in] materials	an array of Material pointers. One for each face. 6 in total.
@@ -36,7 +65,7 @@ public:
 
 
 	/// @brief Creates a sphere shaped mesh
-	/// @return The mesh created
+	/// @return The mesh created. The caller owns it.
 	/// @param[in] radius		The radius of the sphere.
 	/// @param[in] centre		The centre of the centre.
 	/// @param[in] materials	Pointer to material used to render all faces. NULL is valid.
@@ -46,15 +75,15 @@ public:
 	/// @brief Get the default cube mesh.
 	/// @return The mesh for the default cube.
 	/// @note The default cube has dimensions 1 x 1 x 1 with the centre at 0, 0, 0.
-	inline const gef::Mesh* GetDefaultCubeMesh() const {
-		return default_cube_mesh_;
+	inline const gef::Mesh* GetDefaultCubeMesh() {
+		return GetBoxMesh(gef::Vector4(0.5f, 0.5f, 0.5f));
 	};
 
 	/// @brief Get the default sphere mesh.
 	/// @return The mesh for the default cube.
 	/// @note The default sphere has radius 0.5 with the centre at 0, 0, 0.
-	inline const gef::Mesh* GetDefaultSphereMesh() const {
-		return default_sphere_mesh_;
+	inline const gef::Mesh* GetDefaultSphereMesh() {
+		return GetSphereMesh(0.5f, 20, 20);
 	};
 
 
@@ -76,11 +105,48 @@ public:
 		return blue_material_;
 	}
 
+	/// @brief Get the build counts, time and buffer sizes.
+	inline const Stats& stats() const {
+		return stats_;
+	}
+
 protected:
+	enum Shape
+	{
+		kBox,
+		kSphere
+	};
+
+	/// A cached mesh and the parameters it was built from. Box meshes leave phi and theta at zero.
+	struct CachedMesh
+	{
+		Shape shape;
+		float size[3];
+		float centre[3];
+		int phi;
+		int theta;
+		gef::Mesh* mesh;
+	};
+
+	/// Index data for a sphere depends only on phi and theta
+	struct SphereIndices
+	{
+		int phi;
+		int theta;
+		std::vector<Int32> sides;
+		std::vector<Int32> caps;
+	};
+
+	gef::Mesh* FindCachedMesh(const CachedMesh& key);
+	const SphereIndices& GetSphereIndices(const int phi, const int theta);
+	void RecordBuild(double start_time, UInt32 num_vertices, UInt32 num_indices);
+
 	gef::Platform& platform_;
 
-	gef::Mesh* default_cube_mesh_;
-	gef::Mesh* default_sphere_mesh_;
+	/// Only a few shapes are ever used, so these are searched in order
+	std::vector<CachedMesh> cached_meshes_;
+	std::vector<SphereIndices*> sphere_indices_;
+	Stats stats_;
 
 	gef::Material red_material_;
 	gef::Material blue_material_;
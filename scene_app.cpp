@@ -10,8 +10,66 @@
 #include <input/keyboard.h>
 #include <input/touch_input_manager.h>
 #include <graphics/sprite.h>
+#include <system/memory_stream_buffer.h>
 #include "load_texture.h"
+#include "AssetPack.h"
+#include "StartupTrace.h"
 #include <iostream>
+#include <future>
+#include <cstdlib>
+#include <ctime>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+
+//Benchmark scenarios. Every scenario uses a fixed seed so runs are comparable between commits.
+static const int benchmarkEnemyCounts[] = { 10, 100, 1000, 10000 };
+static const unsigned int benchmarkStageCount = sizeof(benchmarkEnemyCounts) / sizeof(benchmarkEnemyCounts[0]);
+static const unsigned int benchmarkFramesPerStage = 300;
+static const unsigned int benchmarkShotsPerFrame = 8;
+static const unsigned int benchmarkSeed = 208;
+//Every enemy count is run once with Box2D movement and once with lane movement
+static const unsigned int benchmarkMovementModels = 2;
+//Scenario names bucketed by the number of live enemies, one more than the counts above for anything larger
+static const char* simulationScenarios[] = { "UpdateSimulation/enemies_10", "UpdateSimulation/enemies_100", "UpdateSimulation/enemies_1000", "UpdateSimulation/enemies_10000", "UpdateSimulation/enemies_more" };
+static const char* movementScenarios[benchmarkMovementModels][5] = {
+	{ "Movement/box2d_enemies_10", "Movement/box2d_enemies_100", "Movement/box2d_enemies_1000", "Movement/box2d_enemies_10000", "Movement/box2d_enemies_more" },
+	{ "Movement/lanes_enemies_10", "Movement/lanes_enemies_100", "Movement/lanes_enemies_1000", "Movement/lanes_enemies_10000", "Movement/lanes_enemies_more" } };
+//A volley from many riflemen plus the player's own shots should not stack dozens of gunshot voices
+static const unsigned int gunShotVoiceCap = 4;
+static const float gunShotVoiceHold = 1.0f;
+//The day's last few enemies, or a tenth of a large wave, start loading the store or win screen
+static const unsigned int prefetchEnemiesLeft = 2;
+static const unsigned int prefetchWaveFraction = 10;
+//Below this much health the fail screen is loaded in case it is next
+static const int prefetchHealth = 20;
+//Per tag memory budgets in bytes, zero for none. Going over one fails a --benchmark run.
+static const size_t memoryBudgets[MEMORY_TAG_COUNT] = { 0, 4 * 1024 * 1024, 192 * 1024 * 1024, 32 * 1024 * 1024, 128 * 1024 * 1024, 8 * 1024 * 1024 };
+static const char* pickingScenarios[] = { "ProcessTouchInput/picking_enemies_10", "ProcessTouchInput/picking_enemies_100", "ProcessTouchInput/picking_enemies_1000", "ProcessTouchInput/picking_enemies_10000", "ProcessTouchInput/picking_enemies_more" };
+//Time from WinMain to the first frame in milliseconds. Going over it fails a --startup-check run.
+static const double startupBudget = 1500.0;
+static const char* startupTraceFilename = "startup_trace.json";
+//Written when a day ends and again when the store is left, and by F5 mid-round. F9 loads the quick save back.
+static const char* checkpointFilename = "checkpoint.sav";
+static const char* quickSaveFilename = "quicksave.sav";
+//The benchmark's snapshot scenario, a heavy day captured and restored in place
+static const int benchmarkSnapshotEnemies = 1000;
+static const unsigned int benchmarkSnapshotRepeats = 20;
+//Live metrics, written to metrics.prom while the game runs with --metrics
+static const double allocationBuckets[] = { 0, 1, 4, 16, 64, 256, 1024, 4096 };
+static const double frameTimeBuckets[] = { 4, 8, 16.7, 33.3, 50, 100, 250 };
+static MetricGauge& stateMetric = MetricsRegistry::instance().gauge("game_state", "State on top of the state stack: 0 front end, 1 game, 2 store, 3 fail, 4 win, 5 splash");
+static MetricCounter& stateChangesMetric = MetricsRegistry::instance().counter("game_state_changes_total", "State machine transitions");
+static MetricGauge& enemiesAliveMetric = MetricsRegistry::instance().gauge("game_enemies_alive", "Enemies left in the current day");
+static MetricCounter& contactsMetric = MetricsRegistry::instance().counter("physics_contacts_processed_total", "Touching contacts passed to the contact handlers");
+static MetricGauge& awakeBodiesMetric = MetricsRegistry::instance().gauge("physics_awake_bodies", "Bodies awake after the last step");
+static MetricGauge& islandsMetric = MetricsRegistry::instance().gauge("physics_islands", "Islands the awake bodies formed after the last step");
+static MetricGauge& drawCallsMetric = MetricsRegistry::instance().gauge("render_draw_calls", "Meshes, sprites and text drawn in the last frame");
+static MetricCounter& shotsMetric = MetricsRegistry::instance().counter("input_shots_fired_total", "Rounds fired by the player");
+static MetricCounter& hitsMetric = MetricsRegistry::instance().counter("input_hits_total", "Enemy hits from the player's rounds");
+static MetricCounter& purchaseFailuresMetric = MetricsRegistry::instance().counter("store_purchase_failures_total", "Store items touched that the player could not afford");
+static MetricHistogram& allocationsMetric = MetricsRegistry::instance().histogram("memory_allocations_per_frame", "Heap allocations made in a frame", allocationBuckets, sizeof(allocationBuckets) / sizeof(allocationBuckets[0]));
+static MetricHistogram& frameTimeMetric = MetricsRegistry::instance().histogram("frame_time_ms", "Frame time in milliseconds", frameTimeBuckets, sizeof(frameTimeBuckets) / sizeof(frameTimeBuckets[0]));
 
 SceneApp::SceneApp(gef::Platform& platform) :
 	Application(platform),
@@ -23,7 +81,6 @@ SceneApp::SceneApp(gef::Platform& platform) :
 	button_icon_(NULL),
 	backgroundSprite(NULL),
 	audioManager(NULL),
-	activeTouchID(-1),
 	enemySceneAsset(NULL),
 	playerSceneAsset(NULL),
 	PB(NULL)
@@ -32,16 +89,100 @@ SceneApp::SceneApp(gef::Platform& platform) :
 
 void SceneApp::Init()
 {
-	sprite_renderer_ = gef::SpriteRenderer::Create(platform_);
-	InitFont();
+	for (int i = 0; i < MEMORY_TAG_COUNT; i++)
+	{
+		MemoryTracker::instance().setBudget((MemoryTag)i, memoryBudgets[i]);
+	}
+
+	StartupTrace::instance().setBudget(startupBudget);
+
+	//The asset pack is mounted and the splash screen decoded on a worker while the renderer, input and audio,
+	//which gef ties to the main thread, are created here. Nothing else uses the pack or the prefetcher until it is waited on.
+	std::future<void> assetsReady = std::async(std::launch::async, [this]()
+	{
+		{
+			ScopedStartupSpan span("Mount asset pack");
+			// use the asset pack when one has been built, otherwise everything comes from loose files
+			if (AssetPack::instance().mount("assets.pak"))
+			{
+				AssetPack::instance().readahead(ASSET_GROUP_SHARED);
+			}
+		}
+		if (benchmarkMode == false)
+		{
+			AssetPrefetcher::instance().prefetchTexture("SplashIcon.png", platform_);
+			AssetPrefetcher::instance().prefetchFile("SplashSfx.wav");
+		}
+	});
+
+	//The font and the 3D renderer are created when first needed, see GetFont and CreateRenderer3D
+	if (headless == false)
+	{
+		ScopedStartupSpan span("Sprite renderer");
+		ScopedMemoryTag memoryTag(MEMORY_TAG_UI);
+		sprite_renderer_ = gef::SpriteRenderer::Create(platform_);
+	}
 
 	// initialise input manager
-	input_manager_ = gef::InputManager::Create(platform_);
+	if (headless == false)
+	{
+		ScopedStartupSpan span("Input manager");
+		input_manager_ = gef::InputManager::Create(platform_);
+	}
+	inputQueue.watchKey(gef::Keyboard::KC_RETURN);
+	inputQueue.watchKey(gef::Keyboard::KC_L);
+	inputQueue.watchKey(gef::Keyboard::KC_K);
+	inputQueue.watchKey(gef::Keyboard::KC_M);
+	inputQueue.watchKey(gef::Keyboard::KC_F5);
+	inputQueue.watchKey(gef::Keyboard::KC_F9);
 
 	// Initialise our audio manager
-	audioManager = gef::AudioManager::Create();
+	{
+		ScopedStartupSpan span("Audio manager");
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		if (headless == false)
+		{
+			audioManager = gef::AudioManager::Create();
+			gefAudioBackend.setManager(audioManager);
+			audio = &gefAudioBackend;
+		}
+		else
+		{
+			audio = &nullAudioBackend;
+		}
+		audioCommands.start(audio);
+	}
+
+	SetupCamera();
 
-	SplashInit();
+	{
+		ScopedStartupSpan span("Wait for assets");
+		assetsReady.wait();
+	}
+
+	if (benchmarkMode == true)
+	{
+		BenchmarkInit();
+		return;
+	}
+
+	//--resume goes straight into the saved game, past the splash screen and front end
+	if (resumeFilename != NULL && snapshot.load(resumeFilename))
+	{
+		ScopedStartupSpan span("Resume");
+		MemoryTracker::instance().enterState("Game");
+		GameInit(0);
+		RestoreSnapshot(snapshot);
+		setState(Level1);
+	}
+	else
+	{
+		ScopedStartupSpan span("Splash");
+		MemoryTracker::instance().enterState("Splash");
+		setState(Splash);
+		SplashInit();
+		AssetPrefetcher::instance().discard();
+	}
 
 	//Seed a new seed for the random number generator
 	srand(time(NULL));
@@ -54,31 +195,131 @@ void SceneApp::CleanUp()
 
 	CleanUpFont();
 
+	delete renderer_3d_;
+	renderer_3d_ = NULL;
+
+	if (PB != NULL)
+	{
+		const PrimitiveBuilder::Stats& primitiveStats = PB->stats();
+		gef::DebugOut("Primitives: %u meshes built in %.3f ms, %u cache hits, %u index sets built, %u shared, %llu vertex bytes, %llu index bytes\n", primitiveStats.meshes_built, primitiveStats.build_milliseconds, primitiveStats.cache_hits, primitiveStats.index_sets_built, primitiveStats.index_sets_shared, primitiveStats.vertex_bytes, primitiveStats.index_bytes);
+		delete PB;
+		PB = NULL;
+	}
+
 	delete sprite_renderer_;
 	sprite_renderer_ = NULL;
 
-	audioManager->UnloadAllSamples();
-	audioManager->UnloadMusic();
+	audioCommands.stop();
+	const NanosecondHistogram& audioLatency = audioCommands.getLatency();
+	gef::DebugOut("Audio commands: %llu posted, latency p50 %llu ns p99 %llu ns max %llu ns, %llu stalls\n", audioCommands.getPostedCount(), audioLatency.percentile(0.5), audioLatency.percentile(0.99), audioLatency.maxNanoseconds, audioCommands.getStallCount());
+
+	audio->unloadAllSamples();
+	audio->unloadMusic();
 
 	delete audioManager;
 	audioManager = NULL;
+
+	enemyPool.clear();
+	gef::DebugOut("Arenas: day %u resets, %llu byte peak, %u chunks; game %llu byte peak, %u chunks\n", enemyPool.getArena().getResetCount(), (unsigned long long)enemyPool.getArena().getPeakBytes(), enemyPool.getArena().getChunkCount(), (unsigned long long)gameArena.getPeakBytes(), gameArena.getChunkCount());
+
+	handgun.releaseIcon();
+	sniper.releaseIcon();
+	assualtRifle.releaseIcon();
+	shotgun.releaseIcon();
+
+	MemoryTracker::instance().report();
+
+	gef::DebugOut("Input: %u touches, touch to hit %.3fms avg %.3fms max\n", inputQueue.getLatencyCount(), inputQueue.getAverageLatency(), inputQueue.getMaxLatency());
+
+	AssetPrefetcher& prefetcher = AssetPrefetcher::instance();
+	prefetcher.discard();
+	gef::DebugOut("Prefetch: %u requested, %u hits, %u late, %u misses, %u unused\n", prefetcher.getRequestedCount(), prefetcher.getHitCount(), prefetcher.getLateCount(), prefetcher.getMissCount(), prefetcher.getUnusedCount());
+
+	if (AssetPack::instance().isMounted())
+	{
+		gef::DebugOut("Asset pack: %u file opens, %u reads, %llu bytes\n", AssetPack::instance().getFileOpenCount(), AssetPack::instance().getReadCount(), AssetPack::instance().getBytesRead());
+		AssetPack::instance().unmount();
+	}
 }
 
 bool SceneApp::Update(float frame_time)
 {
+	//Quit as soon as the first frame is out
+	if (startupCheckMode == true && StartupTrace::instance().isRecording() == false)
+	{
+		return false;
+	}
+
+	frameCount++;
+	if (soakFrames > 0)
+	{
+		double now = PerfRecorder::nowMilliseconds();
+		if (frameCount == 1)
+		{
+			soakStartTime = now;
+		}
+		else
+		{
+			soakFrameTimes.add((unsigned long long)((now - lastFrameStartTime) * 1000000.0));
+		}
+		lastFrameStartTime = now;
+
+		if (frameCount > soakFrames)
+		{
+			WriteSoakResults("soak_results.json");
+			return false;
+		}
+	}
+
 	audioStatusChanged = false;
 
 	fps_ = 1.0f / frame_time;
 
-	input_manager_->Update();
+	if (MetricsRegistry::isEnabled())
+	{
+		unsigned long long allocations = MemoryTracker::instance().getTotalAllocations();
+		allocationsMetric.observe((double)(allocations - lastFrameAllocations));
+		lastFrameAllocations = allocations;
+		frameTimeMetric.observe(frame_time * 1000.0);
+		MetricsRegistry::instance().update();
+	}
+
+	if (input_manager_ != NULL)
+	{
+		input_manager_->Update();
+	}
+
+	if (benchmarkMode == true)
+	{
+		return BenchmarkUpdate(frame_time);
+	}
 
-	gef::Keyboard* keyboard = input_manager_->keyboard();
-	const gef::SonyController* controller = input_manager_->controller_input()->GetController(0);
+	if (input_manager_ != NULL && scriptedInput == false)
+	{
+		inputQueue.gather(input_manager_);
+	}
+	else
+	{
+		//Headless runs without a script press nothing
+		scriptedEvents.clear();
+		if (scriptedInput == true)
+		{
+			inputScript.getEvents(frameCount, scriptedEvents);
+		}
+		inputQueue.gatherScripted(scriptedEvents);
+	}
 
-	if (keyboard)
+	const std::vector<InputEvent>& events = inputQueue.getEvents();
+	for (unsigned int i = 0; i < events.size(); i++)
 	{
-		if (keyboard->IsKeyPressed(gef::Keyboard::KC_RETURN))
+		if (events[i].type != InputEvent::KeyPressed)
+		{
+			continue;
+		}
+
+		switch (events[i].key)
 		{
+		case gef::Keyboard::KC_RETURN:
 			switch (gameState)
 			{
 			case SceneApp::INIT:
@@ -96,15 +337,25 @@ bool SceneApp::Update(float frame_time)
 			default:
 				break;
 			}
-		}
-
-		if (keyboard->IsKeyPressed(gef::Keyboard::KC_M))
-		{
+			break;
+		case gef::Keyboard::KC_L:
+			if (gameState == INIT)
+			{
+				largeWaveMode = !largeWaveMode;
+			}
+			break;
+		case gef::Keyboard::KC_K:
+			if (gameState == INIT)
+			{
+				laneMovement = !laneMovement;
+			}
+			break;
+		case gef::Keyboard::KC_M:
 			switch (playAudio)
 			{
 			case true:
 				playAudio = false;
-				audioManager->StopMusic();
+				audioCommands.stopMusic();
 				break;
 			case false:
 				playAudio = true;
@@ -113,6 +364,21 @@ bool SceneApp::Update(float frame_time)
 				break;
 			}
 			audioStatusChanged = true;
+			break;
+		case gef::Keyboard::KC_F5:
+			if (gameState == Level1)
+			{
+				QuickSave();
+			}
+			break;
+		case gef::Keyboard::KC_F9:
+			if (gameState == Level1 && snapshot.load(quickSaveFilename))
+			{
+				RestoreSnapshot(snapshot);
+			}
+			break;
+		default:
+			break;
 		}
 	}
 
@@ -145,6 +411,13 @@ bool SceneApp::Update(float frame_time)
 
 void SceneApp::Render()
 {
+	//The benchmark tears the game down between scenarios, so there may be nothing to draw
+	if (benchmarkMode == true && world_ == NULL)
+	{
+		StartupTrace::instance().firstFrame(startupTraceFilename);
+		return;
+	}
+
 	switch (gameState)
 	{
 	case SceneApp::INIT:
@@ -168,12 +441,95 @@ void SceneApp::Render()
 	default:
 		break;
 	}
+
+	//Every state draws through the queue, so these are the frame just drawn
+	const RenderQueue::Stats& drawStats = renderQueue.getStats();
+	drawCallsMetric.set(drawStats.meshDraws + drawStats.spriteDraws + drawStats.textDraws);
+	soakStats.meshDraws += drawStats.meshDraws;
+	soakStats.spriteDraws += drawStats.spriteDraws;
+	soakStats.textDraws += drawStats.textDraws;
+
+	StartupTrace::instance().firstFrame(startupTraceFilename);
+}
+
+//The splash screen has no text, so the font loads with the first state that does
+gef::Font* SceneApp::GetFont()
+{
+	//Text is only counted when headless, so there is nothing to load
+	if (headless == true)
+	{
+		return NULL;
+	}
+
+	if (font_ == NULL)
+	{
+		ScopedStartupSpan span("Font");
+		ScopedMemoryTag memoryTag(MEMORY_TAG_UI);
+		ScopedLongLivedAllocations longLived;
+		font_ = new gef::Font(platform_);
+		font_->Load("comic_sans");
+	}
+	return font_;
+}
+
+//Kept from the first state that draws in 3D until CleanUp, so states switch without recreating it
+void SceneApp::CreateRenderer3D()
+{
+	if (renderer_3d_ != NULL || headless == true)
+	{
+		return;
+	}
+
+	ScopedLongLivedAllocations longLived;
+	renderer_3d_ = gef::Renderer3D::Create(platform_);
+	SetupLights();
+}
+
+void SceneApp::SetupCamera()
+{
+	// projection
+	cameraFov = gef::DegToRad(45.0f);
+	float aspect_ratio = (float)platform_.width() / (float)platform_.height();
+	projectionMatrix = platform_.PerspectiveProjectionFov(cameraFov, aspect_ratio, 0.1f, 100.0f);
+
+	// view
+	cameraEye = gef::Vector4(-2.0f, 2.0f, 15.0f);
+	gef::Vector4 camera_lookat(0.0f, 0.0f, 0.0f);
+	gef::Vector4 camera_up(0.0f, 1.0f, 0.0f);
+	viewMatrix.LookAt(cameraEye, camera_lookat, camera_up);
+
+	if (renderer_3d_ != NULL)
+	{
+		renderer_3d_->set_projection_matrix(projectionMatrix);
+		renderer_3d_->set_view_matrix(viewMatrix);
+	}
+}
+
+void SceneApp::Draw3D()
+{
+	if (renderer_3d_ == NULL)
+	{
+		renderQueue.draw3D(NULL);
+		return;
+	}
+
+	renderer_3d_->Begin();
+	renderQueue.draw3D(renderer_3d_);
+	renderer_3d_->End();
 }
 
-void SceneApp::InitFont()
+void SceneApp::DrawSprites(bool clear)
 {
-	font_ = new gef::Font(platform_);
-	font_->Load("comic_sans");
+	if (sprite_renderer_ == NULL)
+	{
+		renderQueue.drawSprites(NULL);
+		return;
+	}
+
+	sprite_renderer_->Begin(clear);
+	renderQueue.drawSprites(sprite_renderer_);
+	DrawHUD();
+	sprite_renderer_->End();
 }
 
 void SceneApp::CleanUpFont()
@@ -207,8 +563,35 @@ void SceneApp::SetupLights()
 	default_shader_data.AddPointLight(default_point_light);
 }
 
+//Enemies that reach the house or a frozen enemy are frozen once the contact list has been walked.
+//Frozen enemies are static, so their contacts go away and the per frame damage is taken in UpdateEnemies.
+void SceneApp::ContactHandler::operator()(PlayerObject& player, b2Body* playerBody, EnemyObject& enemy, b2Body* enemyBody)
+{
+	app.playerData.decrementHealth(app.gameTime, 1);
+	app.pendingFreezes.push_back({ &enemy, true });
+}
+
+//The wall is the front of the house, so enemies reaching it hurt the player
+void SceneApp::ContactHandler::operator()(WallObject& wall, b2Body* wallBody, EnemyObject& enemy, b2Body* enemyBody)
+{
+	app.playerData.decrementHealth(app.gameTime, 1);
+	app.pendingFreezes.push_back({ &enemy, true });
+}
+
+//Two walking enemies keep the same speed and are left alone, a walking one that catches up with a frozen one joins the queue
+void SceneApp::ContactHandler::operator()(EnemyObject& enemyA, b2Body* bodyA, EnemyObject& enemyB, b2Body* bodyB)
+{
+	if (enemyA.getStoppedMoving() != enemyB.getStoppedMoving())
+	{
+		app.pendingFreezes.push_back({ enemyA.getStoppedMoving() ? &enemyB : &enemyA, false });
+	}
+}
+
 void SceneApp::UpdateSimulation(float frame_time)
 {
+	ScopedBudgetTimer budgetTimer(frameBudget, FrameBudget::Physics);
+	ScopedPerfTimer timer(simulationScenarios[EnemyCountBucket()]);
+
 	// update physics world
 	float timeStep = 1.0f / 60.f;
 
@@ -217,15 +600,15 @@ void SceneApp::UpdateSimulation(float frame_time)
 
 	world_->Step(timeStep, velocityIterations, positionIterations);
 
-	// update object visuals from simulation data
-	Player->UpdateFromSimulation(Player->getBody());
+	//Transforms are built after the step and after UpdateEnemies has moved the bodyless enemies, so culling and drawing see this frame's positions with their scale and rotation
+	Player->update();
 
 	for (int i = 0; i < enemies.size(); i++)
 	{
-		enemies[i]->UpdateFromSimulation(enemies[i]->getBody());
+		enemies[i]->update();
 	}
 
-	wallObject->UpdateFromSimulation(wallObject->getBody());
+	wallObject->update();
 
 	// collision detection
 	// get the head of the contact list
@@ -233,109 +616,102 @@ void SceneApp::UpdateSimulation(float frame_time)
 	// get contact count
 	int contact_count = world_->GetContactCount();
 
+	ContactHandler handler = { *this };
+	unsigned int touching = 0;
 	for (int contact_num = 0; contact_num<contact_count; ++contact_num)
 	{
 		if (contact->IsTouching())
 		{
-			// get the colliding bodies
-			b2Body* bodyA = contact->GetFixtureA()->GetBody();
-			b2Body* bodyB = contact->GetFixtureB()->GetBody();
+			CollisionDispatcher<ContactHandler>::dispatch(handler, contact);
+			touching++;
+		}
+		// Get next contact point
+		contact = contact->GetNext();
+	}
+	contactsMetric.add(touching);
 
-			// DO COLLISION RESPONSE HERE
-			PlayerObject* player = NULL;
-			//Enemy* enemy = NULL;
-			EnemyObject* enemy = NULL;
-			GameObject* gameObjectA = NULL;
-			GameObject* gameObjectB = NULL;
+	for (unsigned int i = 0; i < pendingFreezes.size(); i++)
+	{
+		pendingFreezes[i].enemy->freeze(pendingFreezes[i].atHouse);
+	}
+	pendingFreezes.clear();
 
-			gameObjectA = (GameObject*)bodyA->GetUserData();
-			gameObjectB = (GameObject*)bodyB->GetUserData();
+	CountPhysicsIslands();
+}
 
-			if (gameObjectA)
-			{
-				if (gameObjectA->type() == PLAYER)
-				{
-					player = (PlayerObject*)bodyA->GetUserData();
-				}
-				else if (gameObjectA->type() == ENEMY)
-				{
-					enemy = (EnemyObject*)bodyA->GetUserData();
-				}
-			}
+//The same flood fill Box2D builds islands with: awake bodies joined by touching contacts, with static bodies never joining two islands
+void SceneApp::CountPhysicsIslands()
+{
+	physicsAwakeBodies = 0;
+	physicsIslands = 0;
+	islandVisited.clear();
+	for (b2Body* body = world_->GetBodyList(); body != NULL; body = body->GetNext())
+	{
+		if (body->GetType() == b2_staticBody || body->IsAwake() == false || body->IsActive() == false)
+			continue;
 
-			if (gameObjectB)
-			{
-				if (gameObjectB->type() == PLAYER)
-				{
-					player = (PlayerObject*)bodyB->GetUserData();
-				}
-				else if (gameObjectB->type() == ENEMY)
-				{
-					enemy = (EnemyObject*)bodyB->GetUserData();
-				}
-			}
+		physicsAwakeBodies++;
+		if (islandVisited.insert(body).second == false)
+			continue;
 
-			if (player && enemy)
+		physicsIslands++;
+		islandStack.clear();
+		islandStack.push_back(body);
+		while (islandStack.empty() == false)
+		{
+			b2Body* current = islandStack.back();
+			islandStack.pop_back();
+			for (b2ContactEdge* edge = current->GetContactList(); edge != NULL; edge = edge->next)
 			{
-				playerData.decrementHealth(gameTime,1);
-
-				if (gameObjectA->type() == ENEMY)
-				{
-					bodyA->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
-				}
-				else if (gameObjectB->type() == ENEMY)
-				{
-					bodyB->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
-				}
-				enemy->setCollidingWithPlayer(true);
-			}
+				b2Body* other = edge->other;
+				if (edge->contact->IsTouching() == false || edge->contact->IsEnabled() == false || other->GetType() == b2_staticBody || other->IsAwake() == false)
+					continue;
 
-			if (enemy)
-			{
-				if (enemy->getStoppedMoving() == true )
-				{
-					if (gameObjectA->type() == ENEMY)
-					{
-						bodyA->ApplyForceToCenter(b2Vec2(5, 0), true);
-					}
-					if (gameObjectB->type() == ENEMY)
-					{
-						bodyB->ApplyForceToCenter(b2Vec2(5, 0),true);
-					}
-					enemy->setStoppedMoving(false);
-				}
-				if (gameObjectA->type() == ENEMY && gameObjectB->type() == ENEMY)
+				if (islandVisited.insert(other).second)
 				{
-					bodyA->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
-					bodyB->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
-					enemy->setStoppedMoving(true);
+					islandStack.push_back(other);
 				}
 			}
 		}
-		// Get next contact point
-		contact = contact->GetNext();
+	}
+
+	awakeBodiesMetric.set(physicsAwakeBodies);
+	islandsMetric.set(physicsIslands);
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addCount("Physics/awake_bodies", physicsAwakeBodies);
+		PerfRecorder::instance().addCount("Physics/islands", physicsIslands);
 	}
 }
 
 void SceneApp::FrontendInit()
 {
+	SwitchAssetGroup(ASSET_GROUP_FRONTEND);
 	roundCounter = 1;
 
-	renderer_3d_ = gef::Renderer3D::Create(platform_);
+	CreateRenderer3D();
 
 	button_icon_ = CreateTextureFromPNG("playbuttonWhite.png", platform_);
 	backgroundSprite = CreateTextureFromPNG("mainMenuBackground.png", platform_);
-	audioManager->LoadMusic("MainMenuMusic.wav", platform_);
+	audioCommands.flush();
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		audio->loadMusic("MainMenuMusic.wav", platform_);
+	}
 
 	if (playAudio == true)
 	{
-		audioManager->PlayMusic();
+		audioCommands.playMusic();
 	}
 
 	//Create our menu button
 	b2Vec2 gravity(0.0f, 0.0f);
-	world_ = new b2World(gravity);
-	
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_PHYSICS);
+		world_ = new b2World(gravity);
+	}
+
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UI);
 	mainMenuButtons.push_back(new MainMenuButton("fast-forward-button.png", &platform_, "Increase", world_, b2Vec2(6, 0)));
 	mainMenuButtons[0]->set_position(gef::Vector4(platform_.width() * 0.75f, platform_.height() * 0.5f, 0));
 
@@ -348,17 +724,15 @@ void SceneApp::FrontendInit()
 
 void SceneApp::FrontendRelease()
 {
-	button_icon_->~Texture();
 	delete button_icon_;
 	button_icon_ = NULL;
 
-	backgroundSprite->~Texture();
 	delete backgroundSprite;
 	backgroundSprite = NULL;
 
+	//Each button deletes its own icon
 	for (int i = 0; i < mainMenuButtons.size(); i++)
 	{
-		mainMenuButtons[i]->getIcon()->~Texture();
 		delete mainMenuButtons[i];
 	}
 
@@ -368,46 +742,29 @@ void SceneApp::FrontendRelease()
 	delete world_;
 	world_ = NULL;
 
-	delete renderer_3d_;
-	renderer_3d_ = NULL;
-
-	audioManager->StopMusic();
-	audioManager->UnloadMusic();
+	audioCommands.stopMusic();
+	audioCommands.flush();
+	audio->unloadMusic();
 }
 
 void SceneApp::FrontendUpdate(float frame_time)
 {
-	const gef::SonyController* controller = input_manager_->controller_input()->GetController(0);
-
 	ProcessTouchInput();
 
 	if (audioStatusChanged == true)
 	{
 		if (playAudio == true)
 		{
-			audioManager->PlayMusic();
+			audioCommands.playMusic();
 		}
 	}
 }
 
 void SceneApp::FrontendRender()
 {
-	// projection
-	float fov = gef::DegToRad(45.0f);
-	float aspect_ratio = (float)platform_.width() / (float)platform_.height();
-	gef::Matrix44 projection_matrix;
-	projection_matrix = platform_.PerspectiveProjectionFov(fov, aspect_ratio, 0.1f, 100.0f);
-	renderer_3d_->set_projection_matrix(projection_matrix);
-
-	// view
-	gef::Vector4 camera_eye(-2.0f, 2.0f, 15.0f);
-	gef::Vector4 camera_lookat(0.0f, 0.0f, 0.0f);
-	gef::Vector4 camera_up(0.0f, 1.0f, 0.0f);
-	gef::Matrix44 view_matrix;
-	view_matrix.LookAt(camera_eye, camera_lookat, camera_up);
-	renderer_3d_->set_view_matrix(view_matrix);
+	SetupCamera();
 
-	sprite_renderer_->Begin();
+	renderQueue.begin(cameraEye);
 
 	//Render our background 
 	gef::Sprite background;
@@ -415,11 +772,11 @@ void SceneApp::FrontendRender()
 	background.set_position(gef::Vector4(platform_.width() - 480.f, platform_.height() - 273.f, 0.f));
 	background.set_height(platform_.height());
 	background.set_width(platform_.width());
-	sprite_renderer_->DrawSprite(background);
+	renderQueue.addSprite(background, RenderQueue::Background);
 
 	// Render Title Text
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f - 270.f , 0.f),
 		1.0f,
 		0xffffffff,
@@ -427,26 +784,42 @@ void SceneApp::FrontendRender()
 		"Save The House!");
 
 	//Render audio text
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f + 240.f, 0.f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Press 'm' at any time to mute/unmute audio.");
 
+	renderQueue.addText(
+		GetFont(),
+		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f + 210.f, 0.f),
+		1.0f,
+		0xffffffff,
+		gef::TJ_CENTRE,
+		"Large waves: %s (press 'l')", largeWaveMode ? "On" : "Off");
+
+	renderQueue.addText(
+		GetFont(),
+		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f + 180.f, 0.f),
+		1.0f,
+		0xffffffff,
+		gef::TJ_CENTRE,
+		"Enemy movement: %s (press 'k')", laneMovement ? "Lanes" : "Box2D");
+
 	//Render our rounds to beat text
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.85f, platform_.height() * 0.6f, 0.f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Rounds to beat");
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.85f, platform_.height() * 0.5f, 0.f),
 		1.0f,
 		0xffffffff,
@@ -456,48 +829,46 @@ void SceneApp::FrontendRender()
 	//Render the increment button and decrement button
 	for (int i = 0; i < mainMenuButtons.size(); i++)
 	{
-		sprite_renderer_->DrawSprite(*mainMenuButtons[i]);		
+		renderQueue.addSprite(*mainMenuButtons[i]);
 	}
 
-	DrawHUD();
-	sprite_renderer_->End();
+	DrawSprites(true);
 }
 
+//Starts a new game. Everything the game state loads stays resident across days until GameRelease.
 void SceneApp::GameInit(int enemiesToMake)
 {
+	double startTime = PerfRecorder::nowMilliseconds();
+	SwitchAssetGroup(ASSET_GROUP_GAME);
 	playerData.resetData();
 	const char* sceneAssetFilename;
 	// initialise the physics world
 	b2Vec2 gravity(0.0f,0.0f);
-	world_ = new b2World(gravity);
-
-	//Initialise primitive builder
-	PB = new PrimitiveBuilder(platform_);
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_PHYSICS);
+		world_ = new b2World(gravity);
+	}
 
-	//Initalize our time variable
-	gameTime = 0;
+	//The primitive builder caches its meshes, so it is made by the first game and kept until CleanUp
+	if (PB == NULL)
+	{
+		ScopedLongLivedAllocations longLived;
+		PB = new PrimitiveBuilder(platform_);
+	}
 
-	//Reset our player damage time
-	playerData.setLastDamageTime(0.0f);
-	//Reset our rifleman attack time
-	lastRfilemenAttackTime = 0;
-	//Rest our repair time
-	lastRepairTime = 0;
 	// Make sure there is a panel to detect touch, activate if it exists
 	if (input_manager_ && input_manager_->touch_manager() && (input_manager_->touch_manager()->max_num_panels() > 0))
 	{
 		input_manager_->touch_manager()->EnablePanel(0);
 	}
 
-	//Create the first weapons if it's not been made yet.
-	if (firstRun == true)
+	//Every new game starts with just the handgun. Its icon is loaded by the first game and kept.
 	{
-		Weapon handgun = Weapon();
-		handgun.create("handgun.png", &platform_, 100, 30, 10, 2.5f, "Handgun","handgunSfx.wav");
-		playerData.addWeapon(handgun);
-		playerData.setActiveWeapon("Handgun");
-		firstRun = false;
+		ScopedLongLivedAllocations longLived;
+		handgun.create("handgun.png", &platform_, handgunBalance.cost, handgunBalance.damage, handgunBalance.maxAmmo, handgunBalance.reloadTime, "Handgun","handgunSfx.wav");
 	}
+	playerData.addWeapon(handgun);
+	playerData.setActiveWeapon("Handgun");
 
 	sceneAssetFilename = "NewHouse.scn";
 	playerSceneAsset = LoadSceneAssets(platform_, sceneAssetFilename);
@@ -522,58 +893,346 @@ void SceneApp::GameInit(int enemiesToMake)
 	}
 
 	// create the renderer for draw 3D geometry
-	renderer_3d_ = gef::Renderer3D::Create(platform_);
-
-	//Load our audio samples
-	gunShotSampleID = audioManager->LoadSample(playerData.getActiveWeapon().getSfxPath(), platform_);
-	backgroundSFXID = audioManager->LoadMusic("gamebackgroundsfx.wav", platform_);
-	reloadSfx = audioManager->LoadSample("ReloadSfx.wav", platform_);
-
-	//start our background sfx
-	if (playAudio == true)
-	{
-		audioManager->PlayMusic();
-	}
+	CreateRenderer3D();
 
-	SetupLights();
+	LoadGameAudio();
 
 	//Setup player
-	Player = new PlayerObject(playerSceneAsset, world_);
+	Player = gameArena.create<PlayerObject>(playerSceneAsset, world_);
 	Player->updateScale(gef::Vector4(0.1f, 0.2f, 0.1f));
 	Player->updateRotationY(80);
 
 	//Setup wall
-	wallObject = new WallObject(wallSceneAsset, world_);
+	wallObject = gameArena.create<WallObject>(wallSceneAsset, world_);
 	wallObject->updateScale(gef::Vector4(0.55f, 0.1f, 0.1f));
 	wallObject->updateRotationZ(90);
 
-	gef::Mesh* enemyMesh = getMeshFromSceneAssets(enemySceneAsset);
-
-	for (unsigned int i = 0; i < enemiesToMake; i++)
 	{
-		enemies.push_back(new EnemyObject(enemySceneAsset,world_,-10.0f - (i), enemyMesh));
+		ScopedMemoryTag memoryTag(MEMORY_TAG_ASSETS);
+		enemyLODs.build(platform_, enemySceneAsset);
 	}
 
-	//Move alive enemeies
-	for (int i = 0; i < enemies.size(); i++)
-	{
-		enemies[i]->getBody()->ApplyForceToCenter(b2Vec2(5, 0), true);
-	}
+	gameBackgroundSprite = CreateTextureFromPNG("groundSprite.png", platform_);
 
-	activeWeapon = playerData.getActiveWeapon();
+	GameStartDay(enemiesToMake);
 
-	gameBackgroundSprite = CreateTextureFromPNG("groundSprite.png", platform_);
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("GameInit/day_" + std::to_string(roundCounter), PerfRecorder::nowMilliseconds() - startTime);
+	}
+}
+
+//Per-round set up: the clock, the timers and a fresh wave. Runs for the first day and again after each visit to the store.
+void SceneApp::GameStartDay(int enemiesToMake)
+{
+	//Initalize our time variable
+	gameTime = 0;
+	//The limiter's voices were started on the old day's clock
+	sfxLimiter.forgetVoices();
+
+	//Reset our player damage time
+	playerData.setLastDamageTime(0.0f);
+	ScheduleDayTimers(gameTime);
+	dayEnemyCount = enemiesToMake;
+	prefetchedStates = 0;
+
+	gef::Mesh* enemyMesh = getMeshFromSceneAssets(enemySceneAsset);
+
+	laneModel.clear();
+	laneModel.setWalkSpeed(EnemyObject::getWalkSpeed());
+	laneModel.setStopX(houseStopX);
+	laneModel.setSpacing(enemySpacing);
+
+	//Normal days line enemies up a metre apart and give them all bodies straight away.
+	//Large waves pack them tighter and leave them without bodies until they get near the house.
+	//The lane model never gives them bodies.
+	enemies.reserve(enemiesToMake);
+	for (unsigned int i = 0; i < enemiesToMake; i++)
+	{
+		EnemyObject* enemy = NULL;
+		if (largeWaveMode == true)
+		{
+			enemy = enemyPool.acquire(world_, enemySpawnX - (i / largeWaveSpawnDensity), enemyMesh, false);
+		}
+		else
+		{
+			enemy = enemyPool.acquire(world_, enemySpawnX - (i), enemyMesh, laneMovement == false);
+		}
+
+		if (laneMovement == true)
+		{
+			laneModel.add(enemy, enemy->getLane(), enemy->getPosition().x);
+		}
+		enemies.push_back(enemy);
+	}
+	frameBudget.reset();
+
+	activeWeapon = playerData.getActiveWeapon();
+
+	//start our background sfx
+	if (playAudio == true)
+	{
+		audioCommands.playMusic();
+	}
+}
+
+//Riflemen and repair guys work on their own timers, ticking at whole multiples of their interval into the day
+void SceneApp::ScheduleDayTimers(float dayTime)
+{
+	gameTimers.clear();
+	reloadTimerID = 0;
+	gameTimers.scheduleRepeating(NextHelperTick(dayTime, riflemanInterval), riflemanInterval, [this](float time) { RiflemenAttack(); });
+	gameTimers.scheduleRepeating(NextHelperTick(dayTime, repairGuyInterval), repairGuyInterval, [this](float time) { RepairGuysRepair(); });
+}
+
+//Loads the samples and music the game plays. The gunshot follows the active weapon.
+void SceneApp::LoadGameAudio()
+{
+	audioCommands.flush();
+	ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+	gunShotSfxPath = playerData.getActiveWeapon().getSfxPath();
+	gunShotSampleID = audio->loadSample(gunShotSfxPath, platform_);
+	backgroundSFXID = audio->loadMusic("gamebackgroundsfx.wav", platform_);
+	reloadSfx = audio->loadSample("ReloadSfx.wav", platform_);
+	sfxLimiter.clear();
+	sfxLimiter.setVoiceCap(gunShotSampleID, gunShotVoiceCap, gunShotVoiceHold);
+	sfxLimiter.setVoiceCap(reloadSfx, 1, 0.0f);
+}
+
+//Undoes GameStartDay and moves on a day, leaving the world, scenes and renderer loaded
+void SceneApp::GameEndDay()
+{
+	//Normally every enemy is dead by now, this is a failsafe
+	for (unsigned int i = 0; i < enemies.size(); i++)
+	{
+		enemyPool.release(enemies[i], world_);
+	}
+	enemies.clear();
+	laneModel.clear();
+	//The day's enemies go in one arena reset rather than one delete each
+	enemyPool.clear();
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("RoundArena/day_reset", enemyPool.getArena().getLastResetMilliseconds());
+	}
+
+	gameTime = 0;
+	gameTimers.clear();
+	reloadTimerID = 0;
+
+	audioCommands.stopMusic();
+	audioCommands.stopSampleVoice(gunShotSampleID);
+	audioCommands.stopSampleVoice(reloadSfx);
+
+	roundCounter += 1;
+}
+
+//The store plays its own music over the paused game
+void SceneApp::GameSuspend()
+{
+	audioCommands.flush();
+	audio->unloadMusic();
+}
+
+void SceneApp::GameResume()
+{
+	SwitchAssetGroup(ASSET_GROUP_GAME);
+
+	//A new weapon from the store brings its own gunshot, otherwise the samples are still loaded
+	if (strcmp(gunShotSfxPath, playerData.getActiveWeapon().getSfxPath()) != 0)
+	{
+		audioCommands.flush();
+		audio->unloadAllSamples();
+		LoadGameAudio();
+	}
+	else
+	{
+		audioCommands.flush();
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		backgroundSFXID = audio->loadMusic("gamebackgroundsfx.wav", platform_);
+	}
+}
+
+//The store's weapons, loaded on the first visit or when a snapshot says they were bought, and kept as bought weapons share their icons
+void SceneApp::CreateStoreWeapons()
+{
+	ScopedLongLivedAllocations longLived;
+	sniper.create("sniper_icon_2.png", &platform_, sniperBalance.cost, sniperBalance.damage, sniperBalance.maxAmmo, sniperBalance.reloadTime, "Sniper","sniperSfx.wav");
+	assualtRifle.create("assault_rifle_icon_1.png", &platform_, assaultRifleBalance.cost, assaultRifleBalance.damage, assaultRifleBalance.maxAmmo, assaultRifleBalance.reloadTime, "AssaultRifle", "AssaultRifleSfx.wav");
+	shotgun.create("shotgun_icon_2.png", &platform_, shotgunBalance.cost, shotgunBalance.damage, shotgunBalance.maxAmmo, shotgunBalance.reloadTime, "shotgun", "shotgunSfx.wav");
+}
+
+void SceneApp::CaptureSnapshot(GameSnapshot& target, bool includeDay)
+{
+	Weapon* weapons[GameSnapshot::SNAPSHOT_WEAPON_COUNT] = { &handgun, &sniper, &assualtRifle, &shotgun };
+
+	GameSnapshot::CampaignState& campaign = target.campaign;
+	campaign.roundCounter = roundCounter;
+	campaign.roundsToBeat = roundsToBeat;
+	campaign.credits = playerData.getCredits();
+	campaign.health = playerData.getHealth();
+	campaign.lastDamageTime = playerData.getLastDamageTime();
+	campaign.riflemen = playerData.getRiflemen();
+	campaign.repairGuys = playerData.getReapirGuys();
+	campaign.ownedWeapons = 0;
+	campaign.activeWeapon = GameSnapshot::SNAPSHOT_WEAPON_HANDGUN;
+	for (unsigned int i = 0; i < GameSnapshot::SNAPSHOT_WEAPON_COUNT; i++)
+	{
+		//Weapons that were never created have an empty name
+		if (weapons[i]->getName()[0] == '\0')
+			continue;
+
+		if (playerData.hasWeapon(weapons[i]->getName()))
+		{
+			campaign.ownedWeapons |= 1u << i;
+		}
+		if (strcmp(playerData.getActiveWeapon().getName(), weapons[i]->getName()) == 0)
+		{
+			campaign.activeWeapon = i;
+		}
+	}
+	//The game's copy of the active weapon is the one that fires, so its ammo is the live count
+	campaign.activeAmmo = activeWeapon.getAmmo();
+	campaign.ranOutOfAmmoTime = activeWeapon.getRanOutOfAmmoTime();
+	campaign.reloading = reloadTimerID != 0 && gameTimers.isScheduled(reloadTimerID);
+
+	target.hasDay = includeDay;
+	target.enemies.resize(includeDay ? enemies.size() : 0);
+	if (includeDay)
+	{
+		target.day.gameTime = gameTime;
+		target.day.dayEnemyCount = dayEnemyCount;
+		target.day.laneMovement = laneMovement ? 1 : 0;
+		target.day.largeWaveMode = largeWaveMode ? 1 : 0;
+		for (unsigned int i = 0; i < enemies.size(); i++)
+		{
+			enemies[i]->saveState(target.enemies[i]);
+		}
+	}
+}
+
+//Rebuilds the game from a snapshot in place. The world, scenes and renderer GameInit loaded are kept,
+//only the day's enemies are swapped, so the game must already be running.
+void SceneApp::RestoreSnapshot(const GameSnapshot& source)
+{
+	double startTime = PerfRecorder::nowMilliseconds();
+	const GameSnapshot::CampaignState& campaign = source.campaign;
+
+	//Drop the current day as GameEndDay does, without moving on a day
+	for (unsigned int i = 0; i < enemies.size(); i++)
+	{
+		enemyPool.release(enemies[i], world_);
+	}
+	enemies.clear();
+	laneModel.clear();
+	enemyPool.clear();
+
+	roundCounter = campaign.roundCounter;
+	roundsToBeat = campaign.roundsToBeat;
+
+	Weapon* weapons[GameSnapshot::SNAPSHOT_WEAPON_COUNT] = { &handgun, &sniper, &assualtRifle, &shotgun };
+	if (campaign.ownedWeapons & ~(1u << GameSnapshot::SNAPSHOT_WEAPON_HANDGUN))
+	{
+		CreateStoreWeapons();
+	}
+	playerData.resetData();
+	for (unsigned int i = 0; i < GameSnapshot::SNAPSHOT_WEAPON_COUNT; i++)
+	{
+		if (campaign.ownedWeapons & (1u << i))
+		{
+			playerData.addWeapon(*weapons[i]);
+		}
+	}
+	unsigned int active = campaign.activeWeapon < GameSnapshot::SNAPSHOT_WEAPON_COUNT ? campaign.activeWeapon : GameSnapshot::SNAPSHOT_WEAPON_HANDGUN;
+	if (playerData.setActiveWeapon(weapons[active]->getName()) == false)
+	{
+		//addWeapon left the last weapon added active
+		gef::DebugOut("Snapshot: active weapon %s is not owned, keeping %s\n", weapons[active]->getName(), playerData.getActiveWeapon().getName());
+	}
+	playerData.restore(campaign.credits, campaign.health, campaign.riflemen, campaign.repairGuys);
+
+	//The gunshot follows the active weapon
+	if (strcmp(gunShotSfxPath, playerData.getActiveWeapon().getSfxPath()) != 0)
+	{
+		audioCommands.flush();
+		audio->unloadAllSamples();
+		LoadGameAudio();
+	}
+
+	if (source.hasDay == false)
+	{
+		//A checkpoint is taken between days, so it starts the next one fresh
+		GameStartDay(EnemiesForDay(roundCounter));
+	}
+	else
+	{
+		const GameSnapshot::DayState& day = source.day;
+		laneMovement = day.laneMovement != 0;
+		largeWaveMode = day.largeWaveMode != 0;
+		//Also forgets the sound limiter's voices before the clock jumps to the saved time
+		GameStartDay(0);
+
+		gameTime = day.gameTime;
+		dayEnemyCount = day.dayEnemyCount;
+		playerData.setLastDamageTime(campaign.lastDamageTime);
+		ScheduleDayTimers(gameTime);
+
+		gef::Mesh* enemyMesh = getMeshFromSceneAssets(enemySceneAsset);
+		enemies.reserve(source.enemies.size());
+		for (unsigned int i = 0; i < source.enemies.size(); i++)
+		{
+			const GameSnapshot::EnemyState& state = source.enemies[i];
+			EnemyObject* enemy = enemyPool.acquire(world_, state.x, enemyMesh, false);
+			enemy->restoreState(state, world_);
+			if (laneMovement == true && enemy->getBody() == NULL)
+			{
+				laneModel.add(enemy, enemy->getLane(), state.x);
+			}
+			enemies.push_back(enemy);
+		}
+
+		activeWeapon.setAmmo(campaign.activeAmmo);
+		activeWeapon.setRanOutOfAmmoTime(campaign.ranOutOfAmmoTime);
+		if (campaign.reloading)
+		{
+			reloadTimerID = gameTimers.schedule(campaign.ranOutOfAmmoTime + activeWeapon.getReloadTime(), [this](float time) { ReloadWeapon(); });
+		}
+	}
+
+	if (benchmarkMode == false)
+	{
+		gef::DebugOut("Snapshot: restored day %u with %u enemies in %.3f ms\n", (unsigned int)roundCounter, (unsigned int)enemies.size(), PerfRecorder::nowMilliseconds() - startTime);
+	}
+}
+
+void SceneApp::SaveCheckpoint()
+{
+	CaptureSnapshot(snapshot, false);
+	snapshot.save(checkpointFilename);
+}
+
+void SceneApp::QuickSave()
+{
+	double startTime = PerfRecorder::nowMilliseconds();
+	CaptureSnapshot(snapshot, true);
+	snapshot.encode();
+	double captureTime = PerfRecorder::nowMilliseconds() - startTime;
+	if (snapshot.save(quickSaveFilename))
+	{
+		gef::DebugOut("Snapshot: captured %u enemies in %.3f ms\n", (unsigned int)snapshot.enemies.size(), captureTime);
+	}
 }
 
 void SceneApp::GameRelease()
 {
+	double startTime = PerfRecorder::nowMilliseconds();
+
 	// destroying the physics world also destroys all the objects within it
 	delete world_;
 	world_ = NULL;
 
-	delete renderer_3d_;
-	renderer_3d_ = NULL;
-
+	//The first LOD belongs to the scene, so the others go before it
+	enemyLODs.release();
 	delete enemySceneAsset;
 	enemySceneAsset = NULL;
 
@@ -583,285 +1242,541 @@ void SceneApp::GameRelease()
 	delete wallSceneAsset;
 	wallSceneAsset = NULL;
 
-	delete Player;
+	gameArena.reset();
 	Player = NULL;
-
-	delete wallObject;
 	wallObject = NULL;
 
-	delete PB;
-	PB = NULL;
-
-	gameBackgroundSprite->~Texture();
 	delete gameBackgroundSprite;
 	gameBackgroundSprite = NULL;
 
 	//We really shouldn't need to run this code or the claer. This is just a failsafe in case the user somehow finishes the level without killing all enemies.
+	//The world is already gone, so the pool only needs to forget the bodies
 	for (unsigned int i = 0; i < enemies.size(); i++)
 	{
-		delete enemies[i];
+		enemyPool.release(enemies[i], NULL);
 	}
 	enemies.clear();
+	laneModel.clear();
+	enemyPool.clear();
 
 
 	enemies.shrink_to_fit();
 
 	gameTime = 0;
+	gameTimers.clear();
+	reloadTimerID = 0;
 
 	//Audio unload
-	audioManager->StopMusic();
-	audioManager->UnloadMusic();
-	audioManager->StopPlayingSampleVoice(gunShotSampleID);
-	audioManager->StopPlayingSampleVoice(backgroundSFXID);
-	audioManager->UnloadAllSamples();
-	gunShotSampleID = NULL;
-	backgroundSFXID = NULL;
-	reloadSfx = NULL;
-	roundCounter += 1;
+	audioCommands.stopMusic();
+	audioCommands.stopSampleVoice(gunShotSampleID);
+	audioCommands.stopSampleVoice(backgroundSFXID);
+	audioCommands.flush();
+	audio->unloadMusic();
+	audio->unloadAllSamples();
+	gunShotSampleID = 0;
+	backgroundSFXID = 0;
+	reloadSfx = 0;
+	gunShotSfxPath = "";
+
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample("GameRelease/day_" + std::to_string(roundCounter), PerfRecorder::nowMilliseconds() - startTime);
+	}
 }
 
 void SceneApp::GameUpdate(float frame_time)
 {
-	const gef::SonyController* controller = input_manager_->controller_input()->GetController(0);
-
 	gameTime = gameTime + frame_time;
-	Player->update();
-	wallObject->update();
+	sfxLimiter.beginFrame(gameTime);
+
+	UpdateEnemies(frame_time);
+
+	//Fire any riflemen, repair guy and reload timers that are due
+	gameTimers.update(gameTime);
 
-	//check all the alive enemies to see if they need to be killed
-	for (int i = 0; i < enemies.size(); i++)
 	{
-		enemies[i]->update();
-		if (enemies[i]->getHealth() <= 0)
+		ScopedBudgetTimer budgetTimer(frameBudget, FrameBudget::Input);
+		ProcessTouchInput();
+	}
+
+	UpdateSimulation(frame_time);
+
+	//Get the likely next screen loading while the day plays out
+	if (enemies.size() <= prefetchEnemiesLeft || enemies.size() <= dayEnemyCount / prefetchWaveFraction)
+	{
+		PrefetchState(roundCounter == roundsToBeat ? 4 : 2);
+	}
+	if (playerData.getHealth() <= prefetchHealth)
+	{
+		PrefetchState(3);
+	}
+
+	if (enemies.size() == 0)
+	{
+		if (roundCounter == roundsToBeat)
 		{
-			world_->DestroyBody(enemies[i]->getBody());
-			delete enemies[i];
-			enemies.erase(enemies.begin() + i);//Remove the now dead enemy
-			playerData.addCredits(10);
+			updateStateMachine(4, 1);
+			return;
 		}
+		else
+		{
+			updateStateMachine(2,1);
+			return;
+		}
+	}
+
+	if (playerData.getHealth() <= 0)
+	{
+		updateStateMachine(3, 1);
+		return;
 	}
 
-	//Use any riflemen the player has
-	if (lastRfilemenAttackTime + 2 <= gameTime)
+	if (audioStatusChanged == true)
 	{
-		for (int i = 0; i < playerData.getRiflemen(); i++)
+		if (playAudio == true)
 		{
-			if (i < enemies.size())
-			{
-				enemies[i]->decrementHealth(5);
-				if (playAudio == true)
-				{
-					audioManager->PlaySample(gunShotSampleID);
-				}
-			}
+			audioCommands.playMusic();
 		}
-		lastRfilemenAttackTime = gameTime;
 	}
+}
+
+void SceneApp::UpdateEnemies(float frame_time)
+{
+	ScopedBudgetTimer budgetTimer(frameBudget, FrameBudget::Enemies);
 
-	//Use any Repair Guys the player has
-	if (lastRepairTime + 5 <= gameTime)
+	if (laneMovement == true)
 	{
-		for (int i = 0; i < playerData.getReapirGuys(); i++)
+		laneModel.update(frame_time);
+
+		//The front of a lane is pressed against the house
+		if (laneModel.getLanesAtHouse() > 0)
 		{
-			playerData.addHealth(1);
+			playerData.decrementHealth(gameTime, 1);
 		}
-		lastRepairTime = gameTime;
 	}
 
-	ProcessTouchInput();
-
-	if (activeWeapon.getAmmo() <= 0)
+	//Rearmost body in each lane. Enemies without a body get one when they reach it or the activation line.
+	float laneTail[5];
+	for (int lane = 0; lane < 5; lane++)
+	{
+		laneTail[lane] = largeWaveActivationX + enemySpacing;
+	}
+	for (unsigned int i = 0; i < enemies.size(); i++)
 	{
-		if (gameTime >= activeWeapon.getReloadTime() + activeWeapon.getRanOutOfAmmoTime())
+		if (enemies[i]->getBody() && enemies[i]->getPosition().x < laneTail[enemies[i]->getLane()])
 		{
-			activeWeapon.setAmmo(activeWeapon.getMaxAmmo());
+			laneTail[enemies[i]->getLane()] = enemies[i]->getPosition().x;
 		}
 	}
 
-	UpdateSimulation(frame_time);
+	//Frozen enemies behind one that dies walk on again, this far up each lane
+	float laneWakeX[5];
+	bool wakeLanes = false;
+	for (int lane = 0; lane < 5; lane++)
+	{
+		laneWakeX[lane] = -FLT_MAX;
+	}
+	bool enemiesAtHouse = false;
 
-	if (enemies.size() == 0)
+	enemiesWithBodies = 0;
+	//The dead are dropped in order, so the ones nearest the house stay at the front for RiflemenAttack
+	KeepInOrder(enemies, [&](EnemyObject* enemy)
 	{
-		if (roundCounter == roundsToBeat)
+		//check all the alive enemies to see if they need to be killed
+		if (enemy->getHealth() <= 0)
 		{
-			updateStateMachine(4, 1);
-			return;
+			if (laneMovement == true)
+			{
+				laneModel.remove(enemy);
+			}
+			else if (enemy->getBody())
+			{
+				laneWakeX[enemy->getLane()] = std::max(laneWakeX[enemy->getLane()], enemy->getPosition().x);
+				wakeLanes = true;
+			}
+			enemyPool.release(enemy, world_);
+			playerData.addCredits(enemyKillCredits);
+			return false;
 		}
-		else
+
+		if (enemy->getBody() == NULL && laneMovement == false)
 		{
-			updateStateMachine(2,1);
-			return;
+			enemy->advanceWithoutBody(frame_time);
+			if (enemy->getPosition().x >= laneTail[enemy->getLane()] - enemySpacing)
+			{
+				enemy->activateBody(world_);
+			}
+		}
+
+		if (enemy->getBody())
+		{
+			enemiesWithBodies++;
+		}
+		if (laneMovement == false && enemy->getCollidingWithPlayer())
+		{
+			enemiesAtHouse = true;
+		}
+		return true;
+	});
+
+	if (wakeLanes)
+	{
+		for (unsigned int i = 0; i < enemies.size(); i++)
+		{
+			if (enemies[i]->getStoppedMoving() && enemies[i]->getPosition().x < laneWakeX[enemies[i]->getLane()])
+			{
+				enemies[i]->wake();
+			}
 		}
 	}
 
-	if (playerData.getHealth() <= 0)
+	//Frozen enemies no longer touch the house in Box2D, so the damage they do is taken here
+	if (enemiesAtHouse)
+	{
+		playerData.decrementHealth(gameTime, 1);
+	}
+
+	enemiesAliveMetric.set((double)enemies.size());
+}
+
+int SceneApp::EnemiesForDay(int day)
+{
+	return DayEnemyCount(day, largeWaveMode);
+}
+
+//Each rifleman takes one target, so N riflemen hit the first N enemies, the ones nearest the house, in a single pass
+void SceneApp::RiflemenAttack()
+{
+	unsigned int targets = RiflemanTargetCount(playerData.getRiflemen(), enemies.size());
+
+	for (unsigned int i = 0; i < targets; i++)
+	{
+		enemies[i]->decrementHealth(riflemanDamage);
+	}
+
+	//One shot sound for the whole volley
+	if (targets > 0 && playAudio == true && sfxLimiter.allow(gunShotSampleID))
+	{
+		audioCommands.playSample(gunShotSampleID);
+	}
+}
+
+void SceneApp::RepairGuysRepair()
+{
+	playerData.addHealth(playerData.getReapirGuys());
+}
+
+//Fires a round for each ray while there is ammo. Rays that didn't get a round are removed.
+void SceneApp::FireWeapon(std::vector<PickRay>& rays)
+{
+	unsigned int fired = 0;
+	while (fired < rays.size() && activeWeapon.getAmmo() > 0)
+	{
+		activeWeapon.decrementAmmo(1);
+		fired++;
+	}
+	rays.resize(fired);
+	shotsMetric.add(fired);
+	if (fired == 0)
 	{
-		updateStateMachine(3, 1);
 		return;
 	}
 
-	if (audioStatusChanged == true)
+	if (activeWeapon.getAmmo() <= 0)
 	{
-		if (playAudio == true)
+		activeWeapon.setRanOutOfAmmoTime(gameTime);
+		reloadTimerID = gameTimers.schedule(gameTime + activeWeapon.getReloadTime(), [this](float time) { ReloadWeapon(); });
+		if (playAudio == true && sfxLimiter.allow(reloadSfx))
 		{
-			audioManager->PlayMusic();
+			audioCommands.playSample(reloadSfx, false);
 		}
 	}
+
+	ShootEnemiesAlongRays(rays);
+
+	//Shots in the same frame would be merged by the limiter anyway
+	if (playAudio == true && sfxLimiter.allow(gunShotSampleID))
+	{
+		audioCommands.playSample(gunShotSampleID, false);
+	}
+}
+
+//Each enemy is visited once and tested against every ray, rather than walking the enemies once per shot
+int SceneApp::ShootEnemiesAlongRays(std::vector<PickRay>& rays)
+{
+	int hits = 0;
+
+	//Here we need to loop through all the enemy bodies and see if the player hits them.
+	for (int i = 0; i < enemies.size(); i++)
+	{
+		// Create a sphere around the position of the enemy
+		// the radius can be changed for larger objects
+		// radius= 0.5f is a sensible value for a 1x1x1 cube
+		b2Vec2 enemyPosition = enemies[i]->getPosition();
+		gef::Vector4 sphere_centre(enemyPosition.x, enemyPosition.y, 0.0f);
+		float  sphere_radius = enemyPickRadius;
+
+		for (unsigned int ray = 0; ray < rays.size(); ray++)
+		{
+			// check to see if the ray intersects with the bound sphere that is around the player
+			if (RaySphereIntersect(rays[ray].start, rays[ray].direction, sphere_centre, sphere_radius))
+			{
+				//Player touched an enemy do something
+				enemies[i]->decrementHealth(activeWeapon.getDamage()); //Lower this by the damage of the current weapon
+				enemies[i]->setHit(true);
+				hits++;
+			}
+		}
+	}
+
+	hitsMetric.add(hits);
+	return hits;
+}
+
+void SceneApp::ReloadWeapon()
+{
+	activeWeapon.setAmmo(activeWeapon.getMaxAmmo());
+	reloadTimerID = 0;
 }
 
 void SceneApp::GameRender()
 {
+	ScopedPerfTimer timer("GameRender");
+
 	// setup camera
 
-	// projection
-	float fov = gef::DegToRad(45.0f);
-	float aspect_ratio = (float)platform_.width() / (float)platform_.height();
-	gef::Matrix44 projection_matrix;
-	projection_matrix = platform_.PerspectiveProjectionFov(fov, aspect_ratio, 0.1f, 100.0f);
-	renderer_3d_->set_projection_matrix(projection_matrix);
+	SetupCamera();
 
-	// view
-	gef::Vector4 camera_eye(-2.0f, 2.0f, 15.0f);
-	gef::Vector4 camera_lookat(0.0f, 0.0f, 0.0f);
-	gef::Vector4 camera_up(0.0f, 1.0f, 0.0f);
-	gef::Matrix44 view_matrix;
-	view_matrix.LookAt(camera_eye, camera_lookat, camera_up);
-	renderer_3d_->set_view_matrix(view_matrix);
+	//Anything whose bounds are outside the camera is skipped before it reaches the renderer
+	frustum.set(viewMatrix * projectionMatrix);
+	frustum.beginFrame();
+
+	renderQueue.begin(cameraEye);
 
 	// draw 3d geometry
-	renderer_3d_->Begin();
+	{
+		ScopedBudgetTimer budgetTimer(frameBudget, FrameBudget::Render3D);
 
-	// draw player
-	Player->render(renderer_3d_);	
+		if (frustum.isVisible(*Player))
+		{
+			renderQueue.addMesh(*Player);
+		}
 
-	//Draw enemy
-	for (int i = 0; i < enemies.size(); i++)
-	{
-		if (enemies[i]->getHit() == true)
+		//The queue groups hit enemies under the override material and orders everything front to back.
+		//Each enemy uses the LOD that suits its size on screen.
+		enemyLODs.setCamera(cameraEye, cameraFov, (float)platform_.height());
+		enemyLODs.beginFrame();
+		for (int i = 0; i < enemies.size(); i++)
 		{
-			renderer_3d_->set_override_material(&PB->red_material());
-			enemies[i]->render(renderer_3d_);
-			renderer_3d_->set_override_material(NULL);
+			if (frustum.isVisible(*enemies[i]) == true)
+			{
+				enemies[i]->selectLOD(&enemyLODs);
+				renderQueue.addMesh(*enemies[i], enemies[i]->getHit() ? &PB->red_material() : NULL);
+			}
 			enemies[i]->setHit(false);
 		}
-		else
+
+		if (frustum.isVisible(*wallObject))
 		{
-			enemies[i]->render(renderer_3d_);
+			renderQueue.addMesh(*wallObject);
 		}
-	}
-
-	wallObject->render(renderer_3d_);
 
-	renderer_3d_->End();
-
-	// start drawing sprites, but don't clear the frame buffer
-	sprite_renderer_->Begin(false);
+		Draw3D();
+	}
 
+	ScopedBudgetTimer budgetTimer(frameBudget, FrameBudget::Sprites);
 
 	gef::Sprite background;
 	background.set_texture(gameBackgroundSprite);
 	background.set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f, 1.0f));
 	background.set_height(platform_.height());
 	background.set_width(platform_.width());
-	sprite_renderer_->DrawSprite(background);
-
-	DrawHUD();
+	renderQueue.addSprite(background, RenderQueue::Background);
 
 	// Render Title Text
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f + 400.0f, platform_.height() * 0.5f - 270.f, 0.f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Health: %i", playerData.getHealth());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f + 400.0f, platform_.height() * 0.5f - 250.0f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Credits: %i", playerData.getCredits());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f + 400.0f, platform_.height() * 0.5f - 230.0f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Riflemen: %i", playerData.getRiflemen());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f + 400.0f, platform_.height() * 0.5f - 210.0f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"RepairGuys: %i", playerData.getReapirGuys());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.15f, platform_.height() * 0.05f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Ammo count: %i", activeWeapon.getAmmo());
 
-	font_->RenderText(
-		sprite_renderer_,
-		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.1f, 0.0f),
-		1.0f,
-		0xffffffff,
-		gef::TJ_CENTRE,
-		"Day: %i", roundCounter);
+	renderQueue.addText(
+		GetFont(),
+		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.1f, 0.0f),
+		1.0f,
+		0xffffffff,
+		gef::TJ_CENTRE,
+		"Day: %i", roundCounter);
+
+	//Large waves are too big to reason about enemy by enemy, so show totals and where the frame is going
+	if (largeWaveMode == true)
+	{
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.15f, 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Enemies: %i (%i simulated)", (int)enemies.size(), (int)enemiesWithBodies);
+
+		for (int i = 0; i < FrameBudget::SubsystemCount; i++)
+		{
+			FrameBudget::Subsystem subsystem = (FrameBudget::Subsystem)i;
+			renderQueue.addText(
+				GetFont(),
+				gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * i, 0.0f),
+				1.0f,
+				frameBudget.isOverBudget(subsystem) ? 0xff0000ff : 0xffffffff,
+				gef::TJ_LEFT,
+				"%s: %.2f/%.1fms", frameBudget.getName(subsystem), frameBudget.getAverage(subsystem), frameBudget.getBudget(subsystem));
+		}
+
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * FrameBudget::SubsystemCount, 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Sfx: %u merged, %u capped", sfxLimiter.getCoalescedCount(), sfxLimiter.getCappedCount());
+
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * (FrameBudget::SubsystemCount + 1), 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Enemy triangles: %u (LOD %u/%u/%u)", enemyLODs.getFrameTriangles(), enemyLODs.getFrameInstances(0), enemyLODs.getFrameInstances(1), enemyLODs.getFrameInstances(2));
+
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * (FrameBudget::SubsystemCount + 2), 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Meshes: %u drawn, %u culled", frustum.getDrawnCount(), frustum.getCulledCount());
+
+		//draw3D has already counted into this frame, so copy the finished last frame rather than mixing the two
+		const RenderQueue::Stats queueStats = renderQueue.getStats();
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * (FrameBudget::SubsystemCount + 3), 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"State changes: %u material, %u mesh, %u texture", queueStats.materialChanges, queueStats.meshChanges, queueStats.textureChanges);
+
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * (FrameBudget::SubsystemCount + 4), 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Touch to hit: %.2fms avg, %.2fms max, %u touches held", inputQueue.getAverageLatency(), inputQueue.getMaxLatency(), inputQueue.getHeldTouchCount());
+
+		LinearArena& dayArena = enemyPool.getArena();
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * (FrameBudget::SubsystemCount + 5), 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Day arena: %u objects, %uKB in %u chunks", dayArena.getAllocationCount(), (unsigned int)(dayArena.getUsedBytes() / 1024), dayArena.getChunkCount());
+
+		renderQueue.addText(
+			GetFont(),
+			gef::Vector4(platform_.width() * 0.02f, platform_.height() * 0.2f + 20.0f * (FrameBudget::SubsystemCount + 6), 0.0f),
+			1.0f,
+			0xffffffff,
+			gef::TJ_LEFT,
+			"Physics: %u awake bodies, %u islands", physicsAwakeBodies, physicsIslands);
+	}
 
 	activeWeapon.set_position(gef::Vector4(platform_.width() * 0.03f, platform_.height() * 0.05f , 0));
-	sprite_renderer_->DrawSprite(activeWeapon);
+	renderQueue.addSprite(activeWeapon);
 
-	sprite_renderer_->End();
+	// start drawing sprites, but don't clear the frame buffer
+	DrawSprites(false);
 }
 
 void SceneApp::StoreInit()
 {
+	SwitchAssetGroup(ASSET_GROUP_STORE);
+	//The store has its own world for its buttons so the suspended game's world is left alone
 	b2Vec2 gravity(0.0f, 0.0f);
-	world_ = new b2World(gravity);
-	// create the renderer for draw 3D geometry
-	renderer_3d_ = gef::Renderer3D::Create(platform_);
-
-	purchaseSfx = audioManager->LoadSample("purchasemade.wav", platform_);
-	purchasefailSFX = audioManager->LoadSample("purchasefail.wav", platform_);
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_PHYSICS);
+		storeWorld_ = new b2World(gravity);
+	}
 
-	audioManager->LoadMusic("StoreMusic.wav", platform_);
+	audioCommands.flush();
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		purchaseSfx = audio->loadSample("purchasemade.wav", platform_);
+		purchasefailSFX = audio->loadSample("purchasefail.wav", platform_);
+		audio->loadMusic("StoreMusic.wav", platform_);
+	}
 	if (playAudio == true)
 	{
-		audioManager->PlayMusic();
+		audioCommands.playMusic();
 	}
 
+	ScopedMemoryTag memoryTag(MEMORY_TAG_UI);
+
 	//Healthpack
-	storeItem.push_back(new StoreItem("healthpackicon.png", &platform_, 50, "Health", world_, b2Vec2(-9,5)));
+	storeItem.push_back(new StoreItem("healthpackicon.png", &platform_, healthPackCost, "Health", storeWorld_, b2Vec2(-9,5)));
 	storeItem[0]->set_position(gef::Vector4(platform_.width() * 0.05f, platform_.height() * 0.1f,0));
 	
 	//Rifeman
-	storeItem.push_back(new StoreItem("on-sight.png", &platform_, 100, "Rifleman", world_, b2Vec2(-9, 2.5f)));
+	storeItem.push_back(new StoreItem("on-sight.png", &platform_, riflemanCost, "Rifleman", storeWorld_, b2Vec2(-9, 2.5f)));
 	storeItem[1]->set_position(gef::Vector4(platform_.width() * 0.05f, platform_.height() * 0.3f,0));
 
 	//Repair guy
-	storeItem.push_back(new StoreItem("hammer-nails.png", &platform_, 100, "RepairGuy", world_, b2Vec2(-9, 0.0f)));
+	storeItem.push_back(new StoreItem("hammer-nails.png", &platform_, repairGuyCost, "RepairGuy", storeWorld_, b2Vec2(-9, 0.0f)));
 	storeItem[2]->set_position(gef::Vector4(platform_.width() * 0.05f, platform_.height() * 0.5f,0));
 
-	//Weapons
+	CreateStoreWeapons();
 	//Sniper
-	sniper.create("sniper_icon_2.png", &platform_, 250, 40, 1, 1.0f, "Sniper","sniperSfx.wav");
-	storeWeapons.push_back(new StoreWeaponItem("sniper_icon_2.png", &platform_, 250, world_, b2Vec2(0, 5),sniper));
+	storeWeapons.push_back(new StoreWeaponItem("sniper_icon_2.png", &platform_, sniperBalance.cost, storeWorld_, b2Vec2(0, 5),sniper));
 	storeWeapons[0]->set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.1, 0));
 	//Assault rifle
-	assualtRifle.create("assault_rifle_icon_1.png", &platform_, 200, 20, 25, 3.0f, "AssaultRifle", "AssaultRifleSfx.wav");
-	storeWeapons.push_back(new StoreWeaponItem("assault_rifle_icon_1.png", &platform_, 200, world_, b2Vec2(4, 5), assualtRifle));
+	storeWeapons.push_back(new StoreWeaponItem("assault_rifle_icon_1.png", &platform_, assaultRifleBalance.cost, storeWorld_, b2Vec2(4, 5), assualtRifle));
 	storeWeapons[1]->set_position(gef::Vector4(platform_.width() * 0.7f, platform_.height() * 0.1, 0));
 	//Shotgun
-	shotgun.create("shotgun_icon_2.png", &platform_, 300, 50, 2, 1.5f, "shotgun", "shotgunSfx.wav");
-	storeWeapons.push_back(new StoreWeaponItem("shotgun_icon_2.png", &platform_, 300, world_, b2Vec2(0, 2.25), shotgun));
+	storeWeapons.push_back(new StoreWeaponItem("shotgun_icon_2.png", &platform_, shotgunBalance.cost, storeWorld_, b2Vec2(0, 2.25), shotgun));
 	storeWeapons[2]->set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.3, 0));
 
 	selectedWeaponTexture = CreateTextureFromPNG("SelectedWeaponSprite.png", platform_);
@@ -869,19 +1784,19 @@ void SceneApp::StoreInit()
 
 void SceneApp::StoreRelease()
 {
+	//Items delete their own icons
 	for (unsigned int i = 0; i < storeItem.size(); i++)
 	{
-		storeItem[i]->getIcon()->~Texture();
 		delete storeItem[i];
 	}
 
 	for (unsigned int i = 0; i < storeWeapons.size(); i++)
 	{
-		storeWeapons[i]->getIcon()->~Texture();
 		delete storeWeapons[i];
 	}
 
-	selectedWeaponTexture->~Texture();
+	delete selectedWeaponTexture;
+	selectedWeaponTexture = NULL;
 
 	storeItem.clear();
 	storeItem.shrink_to_fit();
@@ -889,70 +1804,55 @@ void SceneApp::StoreRelease()
 	storeWeapons.clear();
 	storeWeapons.shrink_to_fit();
 
-	audioManager->StopMusic();
-	audioManager->StopPlayingSampleVoice(purchaseSfx);
-	audioManager->StopPlayingSampleVoice(purchasefailSFX);
-	audioManager->UnloadMusic();
-	audioManager->UnloadAllSamples();
-
-	purchaseSfx = NULL;
-	purchasefailSFX = NULL;
+	audioCommands.stopMusic();
+	audioCommands.stopSampleVoice(purchaseSfx);
+	audioCommands.stopSampleVoice(purchasefailSFX);
+	audioCommands.flush();
+	audio->unloadMusic();
+	//Newest first so the game's sample IDs underneath are untouched
+	audio->unloadSample(purchasefailSFX);
+	audio->unloadSample(purchaseSfx);
 
-	delete renderer_3d_;
-	renderer_3d_ = NULL;
+	purchaseSfx = 0;
+	purchasefailSFX = 0;
 
-	delete world_;
-	world_ = NULL;
+	delete storeWorld_;
+	storeWorld_ = NULL;
 }
 
 void SceneApp::StoreUpdate(float frame_time)
 {
-	const gef::SonyController* controller = input_manager_->controller_input()->GetController(0);
-
 	ProcessTouchInput();
 
 	if (audioStatusChanged == true)
 	{
 		if (playAudio == true)
 		{
-			audioManager->PlayMusic();
+			audioCommands.playMusic();
 		}
 	}
 }
 
 void SceneApp::StoreRender()
 {
-	// projection
-	float fov = gef::DegToRad(45.0f);
-	float aspect_ratio = (float)platform_.width() / (float)platform_.height();
-	gef::Matrix44 projection_matrix;
-	projection_matrix = platform_.PerspectiveProjectionFov(fov, aspect_ratio, 0.1f, 100.0f);
-	renderer_3d_->set_projection_matrix(projection_matrix);
-
-	// view
-	gef::Vector4 camera_eye(-2.0f, 2.0f, 15.0f);
-	gef::Vector4 camera_lookat(0.0f, 0.0f, 0.0f);
-	gef::Vector4 camera_up(0.0f, 1.0f, 0.0f);
-	gef::Matrix44 view_matrix;
-	view_matrix.LookAt(camera_eye, camera_lookat, camera_up);
-	renderer_3d_->set_view_matrix(view_matrix);
+	SetupCamera();
 
-	sprite_renderer_->Begin();
+	renderQueue.begin(cameraEye);
 
 	for (int i = 0; i < storeItem.size(); i++)
 	{
-		sprite_renderer_->DrawSprite(*storeItem[i]);
+		renderQueue.addSprite(*storeItem[i]);
 
-		font_->RenderText(
-			sprite_renderer_,
+		renderQueue.addText(
+			GetFont(),
 			gef::Vector4(storeItem[i]->position().x(), storeItem[i]->position().y() + 25.0f, 0.0f),
 			1.0f,
 			0xffffffff,
 			gef::TJ_CENTRE,
 			"%i", storeItem[i]->getCost());
 
-		font_->RenderText(
-			sprite_renderer_,
+		renderQueue.addText(
+			GetFont(),
 			gef::Vector4(storeItem[i]->position().x() + 90.0f, storeItem[i]->position().y(), 0.0f),
 			1.0f,
 			0xffffffff,
@@ -963,10 +1863,10 @@ void SceneApp::StoreRender()
 	//Draw weapons
 	for (int i = 0; i < storeWeapons.size(); i++)
 	{
-		sprite_renderer_->DrawSprite(*storeWeapons[i]);
+		renderQueue.addSprite(*storeWeapons[i]);
 
-		font_->RenderText(
-			sprite_renderer_,
+		renderQueue.addText(
+			GetFont(),
 			gef::Vector4(storeWeapons[i]->position().x(), storeWeapons[i]->position().y(),0.0f),
 			1.0f,
 			0xffffffff,
@@ -975,19 +1875,20 @@ void SceneApp::StoreRender()
 	}
 
 	//Draw our weapon selector icon
-	if (playerData.getActiveWeapon().getName() != "Handgun")
+	const char* activeWeaponName = playerData.getActiveWeapon().getName();
+	if (strcmp(activeWeaponName, "Handgun") != 0)
 	{
 		gef::Sprite selectedWeaponSprite;
 		selectedWeaponSprite.set_texture(selectedWeaponTexture);
-		if (playerData.getActiveWeapon().getName() == "Sniper")
+		if (strcmp(activeWeaponName, "Sniper") == 0)
 		{
 			selectedWeaponSprite.set_position(gef::Vector4(storeWeapons[0]->position().x(), storeWeapons[0]->position().y(), 0.0f));
 		}
-		else if (playerData.getActiveWeapon().getName() == "AssaultRifle")
+		else if (strcmp(activeWeaponName, "AssaultRifle") == 0)
 		{
 			selectedWeaponSprite.set_position(gef::Vector4(storeWeapons[1]->position().x(), storeWeapons[1]->position().y(), 0.0f));
 		}
-		else if (playerData.getActiveWeapon().getName() == "shotgun")
+		else if (strcmp(activeWeaponName, "shotgun") == 0)
 		{
 			selectedWeaponSprite.set_position(gef::Vector4(storeWeapons[2]->position().x(), storeWeapons[2]->position().y(), 0.0f));
 		}
@@ -997,60 +1898,69 @@ void SceneApp::StoreRender()
 		}
 		selectedWeaponSprite.set_height(64.0f);
 		selectedWeaponSprite.set_width(64.0f);
-		sprite_renderer_->DrawSprite(selectedWeaponSprite);
+		//Sits on top of the weapon icon, so it needs a later layer than the icons
+		renderQueue.addSprite(selectedWeaponSprite, RenderQueue::Overlay);
 	}
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.9f, platform_.height() * 0.01, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Health: %i", playerData.getHealth());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width()* 0.9f, platform_.height() * 0.05f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Credits: %i", playerData.getCredits());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.9f, platform_.height() * 0.09f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Riflemen: %i", playerData.getRiflemen());
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.9f, platform_.height() * 0.13f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"RepairGuys: %i", playerData.getReapirGuys());
 
-
-	sprite_renderer_->End();
+	DrawSprites(true);
 }
 
 void SceneApp::FailInit()
 {
+	SwitchAssetGroup(ASSET_GROUP_FAIL);
 	failBackgroundSprite = CreateTextureFromPNG("failScreenBackground.png", platform_);
 
-	failBackgroundsfx = audioManager->LoadSample("DeathSfx.wav", platform_);
+	audioCommands.flush();
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		failBackgroundsfx = audio->loadSample("DeathSfx.wav", platform_);
+	}
 	if (playAudio == true)
 	{
-		audioManager->PlaySample(failBackgroundsfx, true);
+		audioCommands.playSample(failBackgroundsfx, true);
 	}
 }
 
 void SceneApp::FailRelease()
 {
-	audioManager->UnloadSample(failBackgroundsfx);
-	failBackgroundsfx = NULL;
+	audioCommands.flush();
+	audio->unloadSample(failBackgroundsfx);
+	failBackgroundsfx = 0;
+
+	delete failBackgroundSprite;
+	failBackgroundSprite = NULL;
 }
 
 void SceneApp::FailUpdate(float frame_time)
@@ -1059,18 +1969,18 @@ void SceneApp::FailUpdate(float frame_time)
 	{
 		if (playAudio == true)
 		{
-			audioManager->PlaySample(failBackgroundsfx, true);
+			audioCommands.playSample(failBackgroundsfx, true);
 		}
 		else
 		{
-			audioManager->StopPlayingSampleVoice(failBackgroundsfx);
+			audioCommands.stopSampleVoice(failBackgroundsfx);
 		}
 	}
 }
 
 void SceneApp::FailRender()
 {
-	sprite_renderer_->Begin();
+	renderQueue.begin(cameraEye);
 
 	//Render our background 
 	gef::Sprite background;
@@ -1078,41 +1988,47 @@ void SceneApp::FailRender()
 	background.set_position(gef::Vector4(platform_.width() - 480.f, platform_.height() - 273.f, 0.0f));
 	background.set_height(platform_.height());
 	background.set_width(platform_.width());
-	sprite_renderer_->DrawSprite(background);
+	renderQueue.addSprite(background, RenderQueue::Background);
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.1f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"You have been defeated, your house is yours no longer.");
 
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.9f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Press 'Enter' to go back to the main menu.");
 
-
-	sprite_renderer_->End();
+	DrawSprites(true);
 }
 
 void SceneApp::WinInit()
 {
+	SwitchAssetGroup(ASSET_GROUP_WIN);
 	winBackgroundSprite = CreateTextureFromPNG("groundSprite.png", platform_);
-	audioManager->LoadMusic("WinMusic.wav", platform_);
+	audioCommands.flush();
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		audio->loadMusic("WinMusic.wav", platform_);
+	}
 
 	if (playAudio == true)
 	{
-		audioManager->PlayMusic();
+		audioCommands.playMusic();
 	}
 }
 
 void SceneApp::WinRelease()
 {
+	delete winBackgroundSprite;
+	winBackgroundSprite = NULL;
 }
 
 void SceneApp::WinUpdate(float frame_time)
@@ -1121,18 +2037,18 @@ void SceneApp::WinUpdate(float frame_time)
 	{
 		if (playAudio == true)
 		{
-			audioManager->PlayMusic();
+			audioCommands.playMusic();
 		}
 		else
 		{
-			audioManager->StopMusic();
+			audioCommands.stopMusic();
 		}
 	}
 }
 
 void SceneApp::WinRender()
 {
-	sprite_renderer_->Begin();
+	renderQueue.begin(cameraEye);
 
 	//Render our background 
 	gef::Sprite background;
@@ -1140,32 +2056,38 @@ void SceneApp::WinRender()
 	background.set_position(gef::Vector4(platform_.width() - 480.f, platform_.height() - 273.f, 0.0f));
 	background.set_height(platform_.height());
 	background.set_width(platform_.width());
-	sprite_renderer_->DrawSprite(background);
+	renderQueue.addSprite(background, RenderQueue::Background);
 
-
-	font_->RenderText(
-		sprite_renderer_,
+	renderQueue.addText(
+		GetFont(),
 		gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f, 0.0f),
 		1.0f,
 		0xffffffff,
 		gef::TJ_CENTRE,
 		"Victory! Your house is now safe.");
 
-	sprite_renderer_->End();
+	DrawSprites(true);
 }
 
 void SceneApp::SplashInit()
 {
+	SwitchAssetGroup(ASSET_GROUP_SPLASH);
 	gameTime = 0;
 	SplashBackground = CreateTextureFromPNG("SplashIcon.png", platform_);
-	splashSfx = audioManager->LoadSample("SplashSfx.wav", platform_);
-	audioManager->PlaySample(splashSfx, false);
+	audioCommands.flush();
+	{
+		ScopedMemoryTag memoryTag(MEMORY_TAG_AUDIO);
+		splashSfx = audio->loadSample("SplashSfx.wav", platform_);
+	}
+	audioCommands.playSample(splashSfx, false);
 }
 
 void SceneApp::SplashRelease()
 {
-	audioManager->UnloadSample(splashSfx);
-	SplashBackground->~Texture();
+	audioCommands.flush();
+	audio->unloadSample(splashSfx);
+	delete SplashBackground;
+	SplashBackground = NULL;
 }
 
 void SceneApp::SplashUpdate(float frame_time)
@@ -1179,16 +2101,16 @@ void SceneApp::SplashUpdate(float frame_time)
 
 void SceneApp::SplashRender()
 {
-	sprite_renderer_->Begin();
+	renderQueue.begin(cameraEye);
 	//Render our background 
 	gef::Sprite background;
 	background.set_texture(SplashBackground);
 	background.set_position(gef::Vector4(platform_.width() - 480.f, platform_.height() - 273.f, 0.f));
 	background.set_height(platform_.height());
 	background.set_width(platform_.width());
-	sprite_renderer_->DrawSprite(background);
+	renderQueue.addSprite(background, RenderQueue::Background);
 
-	sprite_renderer_->End();
+	DrawSprites(true);
 }
 
 //New ID represent where we want to go. Old represent where we came from.
@@ -1209,8 +2131,9 @@ void SceneApp::updateStateMachine(int newID, int oldID)
 		{
 			SplashRelease();
 		}
+		MemoryTracker::instance().enterState("Frontend");
 		FrontendInit();
-		gameState = INIT;
+		setState(INIT);
 		break;
 	case 1://Game
 		if (oldID == 0)
@@ -1219,191 +2142,249 @@ void SceneApp::updateStateMachine(int newID, int oldID)
 		}
 		if (oldID == 2)
 		{
+			//Back to the suspended game for the next day
+			double startTime = PerfRecorder::nowMilliseconds();
 			StoreRelease();
+			MemoryTracker::instance().popState();
+			popState();
+			//Again with what was bought
+			SaveCheckpoint();
+			GameResume();
+			GameStartDay(EnemiesForDay(roundCounter));
+			if (PerfRecorder::instance().isEnabled())
+			{
+				PerfRecorder::instance().addSample("RoundTrip/store_to_game", PerfRecorder::nowMilliseconds() - startTime);
+			}
+			break;
 		}
-		GameInit(roundCounter * 2);
-		gameState = Level1;
+		MemoryTracker::instance().enterState("Game");
+		GameInit(EnemiesForDay(roundCounter));
+		setState(Level1);
+		soakStats.sessions++;
 		break;
 	case 2://Store
-		GameRelease();
+	{
+		//The store goes on top of the game, which keeps its world and assets for the next day
+		double startTime = PerfRecorder::nowMilliseconds();
+		soakStats.daysCleared++;
+		GameEndDay();
+		GameSuspend();
+		SaveCheckpoint();
+		MemoryTracker::instance().pushState("Store");
 		StoreInit();
-		gameState = Store;
+		AssetPrefetcher::instance().discard();
+		pushState(Store);
+		if (PerfRecorder::instance().isEnabled())
+		{
+			PerfRecorder::instance().addSample("RoundTrip/game_to_store", PerfRecorder::nowMilliseconds() - startTime);
+		}
 		break;
+	}
 	case 3://Fail
+		soakStats.fails++;
 		GameRelease();
+		MemoryTracker::instance().enterState("Fail");
 		FailInit();
-		gameState = Fail;
+		AssetPrefetcher::instance().discard();
+		setState(Fail);
 		break;
 	case 4://Win
+		soakStats.daysCleared++;
+		soakStats.wins++;
 		GameRelease();
+		MemoryTracker::instance().enterState("Win");
 		WinInit();
-		gameState = Win;
+		AssetPrefetcher::instance().discard();
+		setState(Win);
 		break;
 	case 5://Splash
+		MemoryTracker::instance().enterState("Splash");
 		SplashInit();
-		gameState = Splash;
+		setState(Splash);
 		break;
 	default:
 		break;
 	}
+	if (gameState == Level1)
+	{
+		soakStats.highestDay = std::max(soakStats.highestDay, (unsigned int)roundCounter);
+	}
+	stateMetric.set(newID);
+	stateChangesMetric.add();
 	return;
 }
 
+//The state stack holds the state being run on top. States underneath are suspended, they are neither updated nor drawn.
+void SceneApp::setState(GAMESTATE state)
+{
+	stateStack.clear();
+	pushState(state);
+}
+
+void SceneApp::pushState(GAMESTATE state)
+{
+	stateStack.push_back(state);
+	gameState = state;
+}
+
+void SceneApp::popState()
+{
+	if (stateStack.size() > 1)
+	{
+		stateStack.pop_back();
+	}
+	gameState = stateStack.back();
+}
+
+//Every touch that started this frame is handled, not just the first. Shots from all of them are
+//gathered up and resolved together in one pass over the enemies.
 void SceneApp::ProcessTouchInput()
 {
-	const gef::TouchInputManager* touchInput = input_manager_->touch_manager();
+	const std::vector<InputEvent>& events = inputQueue.getEvents();
+	pickRays.clear();
+	pickEventIndices.clear();
 
-	if (touchInput && (touchInput->max_num_panels() > 0))
+	for (unsigned int eventIndex = 0; eventIndex < events.size(); eventIndex++)
 	{
-		//Get the active touches for this panel
-		const gef::TouchContainer& panelTouches = touchInput->touches(0);
+		const InputEvent& event = events[eventIndex];
+		if (event.type != InputEvent::TouchPressed)
+		{
+			continue;
+		}
+
+		// convert the touch position to a ray that starts on the camera near plane
+		// and shoots into the camera view frustum
+		gef::Vector2 screen_position = event.position;
+		gef::Vector4 ray_start_position, ray_direction;
+		GetScreenPosRay(screen_position, projectionMatrix, viewMatrix, ray_start_position, ray_direction);
 
-		//Go through the touches
-		for (gef::ConstTouchIterator touch = panelTouches.begin(); touch != panelTouches.end(); ++touch )
+		switch (gameState)
 		{
-			//If active touch ID is -1, then we are not currently processing a touch
-			if (activeTouchID == -1)
+		case SceneApp::Level1:
+		{
+			PickRay ray;
+			ray.start = ray_start_position;
+			ray.direction = ray_direction;
+			pickRays.push_back(ray);
+			pickEventIndices.push_back(eventIndex);
+			break;
+		}
+		case SceneApp::Store:
+			//Here we need to loop through all the store items and see if the player interacts with them.
+			for (int i = 0; i < storeItem.size(); i++)
 			{
-				//Check for the start of a new touch
-				if (touch->type == gef::TT_NEW)
+				if (storeItem[i])
 				{
-					activeTouchID = touch->id;
+					gef::Vector4 sphere_centre(storeItem[i]->getBody()->GetPosition().x, storeItem[i]->getBody()->GetPosition().y, 0.0f);
+					float  sphere_radius = 1.0f;
 
-					//Do any processing for a new touch here
-
-					// convert the touch position to a ray that starts on the camera near plane
-					// and shoots into the camera view frustum
-					gef::Vector2 screen_position = touch->position;
-					gef::Vector4 ray_start_position, ray_direction;
-					GetScreenPosRay(screen_position, renderer_3d_->projection_matrix(), renderer_3d_->view_matrix(), ray_start_position, ray_direction);
-					
-					switch (gameState)
+					// check to see if the ray intersects with the bound sphere that is around the player
+					if (RaySphereIntersect(ray_start_position, ray_direction, sphere_centre, sphere_radius))
 					{
-					case SceneApp::Level1:
-						if (activeWeapon.getAmmo() <= 0)
-						{
-							break;
-						}
-						activeWeapon.decrementAmmo(1);
-
-						if (activeWeapon.getAmmo() <= 0)
-						{
-							activeWeapon.setRanOutOfAmmoTime(gameTime);
-							if (playAudio == true)
-							{
-								audioManager->PlaySample(reloadSfx, false);
-							}
-						}
-						//Here we need to loop through all the enemy bodies and see if the player hits them.
-						for (int i = 0; i < enemies.size(); i++)
+						//Player touched an enemy do something
+						playerData = storeItem[i]->run(playerData); //Lower this by the damage of the current weapon
+						if (storeItem[i]->didPurchaseSucced() == true)
 						{
-							if (enemies[i]->getBody())
+							//Labelled by item, looked up on the purchase as they are rare
+							if (MetricsRegistry::isEnabled())
 							{
-								// Create a sphere around the position of the enemy body
-								// the radius can be changed for larger objects
-								// radius= 0.5f is a sensible value for a 1x1x1 cube
-								gef::Vector4 sphere_centre(enemies[i]->getBody()->GetPosition().x, enemies[i]->getBody()->GetPosition().y, 0.0f);
-								float  sphere_radius = 0.9f;
-
-								// check to see if the ray intersects with the bound sphere that is around the player
-								if (RaySphereIntersect(ray_start_position, ray_direction, sphere_centre, sphere_radius))
-								{
-									//Player touched an enemy do something
-									enemies[i]->decrementHealth(activeWeapon.getDamage()); //Lower this by the damage of the current weapon
-									enemies[i]->setHit(true);
-								}
+								MetricsRegistry::instance().counter("store_purchases_total", "Store items bought", std::string("item=\"") + storeItem[i]->getName() + "\"").add();
 							}
-						}
-						if (playAudio == true)
-						{
-							audioManager->PlaySample(gunShotSampleID, false);
-						}
-						break;
-					case SceneApp::Store:
-						//Here we need to loop through all the store items and see if the player interacts with them.
-						for (int i = 0; i < storeItem.size(); i++)
-						{
-							if (storeItem[i])
+							if (playAudio == true)
 							{
-								gef::Vector4 sphere_centre(storeItem[i]->getBody()->GetPosition().x, storeItem[i]->getBody()->GetPosition().y, 0.0f);
-								float  sphere_radius = 1.0f;
-
-								// check to see if the ray intersects with the bound sphere that is around the player
-								if (RaySphereIntersect(ray_start_position, ray_direction, sphere_centre, sphere_radius))
-								{
-									//Player touched an enemy do something
-									playerData = storeItem[i]->run(playerData); //Lower this by the damage of the current weapon
-									if (storeItem[i]->didPurchaseSucced() == true)
-									{
-										if (playAudio == true)
-										{
-											audioManager->PlaySample(purchaseSfx,false);
-										}
-									}
-									else
-									{
-										if (playAudio == true)
-										{
-											audioManager->PlaySample(purchasefailSFX, false);
-										}
-									}
-								}
+								audioCommands.playSample(purchaseSfx,false);
 							}
 						}
-						break;
-					case SceneApp::INIT:
-						//Here we need to loop through all the main menu buttons and see if the player interacts with them.
-						for (int i = 0; i < mainMenuButtons.size(); i++)
+						else
 						{
-							if (mainMenuButtons[i])
+							purchaseFailuresMetric.add();
+							if (playAudio == true)
 							{
-								gef::Vector4 sphere_centre(mainMenuButtons[i]->getBody()->GetPosition().x, mainMenuButtons[i]->getBody()->GetPosition().y, 0.0f);
-								float  sphere_radius = 1.0f;
-								// check to see if the ray intersects with the bound sphere that is around the player
-								if (RaySphereIntersect(ray_start_position, ray_direction, sphere_centre, sphere_radius))
-								{
-									//Player touched an enemy do something
-									unsigned short int tempRTB = 10;
-									tempRTB = mainMenuButtons[i]->run(tempRTB);
-
-									if (tempRTB == 0)
-									{
-										updateStateMachine(1, 0);
-									}
-									else
-									{
-										roundsToBeat = mainMenuButtons[i]->run(roundsToBeat);
-									}
-								}
+								audioCommands.playSample(purchasefailSFX, false);
 							}
 						}
-						break;
-					default:
-						break;
 					}
-
 				}
 			}
-			else if (activeTouchID == touch->id)
+			inputQueue.recordLatency(event);
+			break;
+		case SceneApp::INIT:
+			//Here we need to loop through all the main menu buttons and see if the player interacts with them.
+			for (int i = 0; i < mainMenuButtons.size(); i++)
 			{
-				if (touch->type == gef::TT_RELEASED)
+				if (mainMenuButtons[i])
 				{
-					activeTouchID = -1;
+					gef::Vector4 sphere_centre(mainMenuButtons[i]->getBody()->GetPosition().x, mainMenuButtons[i]->getBody()->GetPosition().y, 0.0f);
+					float  sphere_radius = 1.0f;
+					// check to see if the ray intersects with the bound sphere that is around the player
+					if (RaySphereIntersect(ray_start_position, ray_direction, sphere_centre, sphere_radius))
+					{
+						//Player touched an enemy do something
+						unsigned short int tempRTB = 10;
+						tempRTB = mainMenuButtons[i]->run(tempRTB);
+
+						if (tempRTB == 0)
+						{
+							//The menu is gone once the game starts, later touches this frame have nothing to press
+							inputQueue.recordLatency(event);
+							updateStateMachine(1, 0);
+							return;
+						}
+						else
+						{
+							roundsToBeat = mainMenuButtons[i]->run(roundsToBeat);
+						}
+					}
 				}
 			}
+			inputQueue.recordLatency(event);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!pickRays.empty())
+	{
+		FireWeapon(pickRays);
+		//Touches past the last round in the magazine fired nothing
+		for (unsigned int i = 0; i < pickRays.size(); i++)
+		{
+			inputQueue.recordLatency(events[pickEventIndices[i]]);
 		}
 	}
 }
 
 gef::Scene* SceneApp::LoadSceneAssets(gef::Platform& platform, const char* filename)
 {
+	double startTime = PerfRecorder::nowMilliseconds();
+	ScopedMemoryTag memoryTag(MEMORY_TAG_ASSETS);
 	gef::Scene* scene = new gef::Scene();
 
-	if (scene->ReadSceneFromFile(platform, filename))
+	// read from the asset pack when it has the file
+	bool loaded = false;
+	const char* packData = NULL;
+	unsigned int packSize = 0;
+	if (AssetPack::instance().isMounted() && AssetPack::instance().find(filename, packData, packSize))
+	{
+		gef::MemoryStreamBuffer stream_buffer(const_cast<char*>(packData), packSize);
+		std::istream input_stream(&stream_buffer);
+		loaded = scene->ReadScene(input_stream);
+	}
+	else
+	{
+		loaded = scene->ReadSceneFromFile(platform, filename);
+	}
+
+	if (loaded)
 	{
 		// if scene file loads successful
 		// create material and mesh resources from the scene data
-		scene->CreateMaterials(platform);
+		// headless runs have no textures to give the materials, the meshes are still built for their bounds
+		if (headless == false)
+		{
+			scene->CreateMaterials(platform);
+		}
 		scene->CreateMeshes(platform);
 	}
 	else
@@ -1412,9 +2393,73 @@ gef::Scene* SceneApp::LoadSceneAssets(gef::Platform& platform, const char* filen
 		scene = NULL;
 	}
 
+	if (PerfRecorder::instance().isEnabled())
+	{
+		PerfRecorder::instance().addSample(string("LoadSceneAssets/") + filename, PerfRecorder::nowMilliseconds() - startTime);
+	}
+
 	return scene;
 }
 
+//Keep only the shared group and the one the next state loads from in memory
+void SceneApp::SwitchAssetGroup(AssetGroup group)
+{
+	AssetPack& pack = AssetPack::instance();
+	if (pack.isMounted() == false)
+	{
+		return;
+	}
+
+	//Prefetch threads may still be reading from a group that is about to be dropped
+	AssetPrefetcher::instance().wait();
+	for (int i = 0; i < ASSET_GROUP_COUNT; i++)
+	{
+		if (i != ASSET_GROUP_SHARED && i != group)
+		{
+			pack.evict((AssetGroup)i);
+		}
+	}
+	pack.readahead(group);
+}
+
+//Only the textures are decoded ahead. gef's audio manager loads samples itself on the main thread,
+//so audio files are just read through once to have them in the OS file cache.
+void SceneApp::PrefetchState(int stateID)
+{
+	if (prefetchedStates & (1u << stateID))
+	{
+		return;
+	}
+	prefetchedStates |= 1u << stateID;
+
+	AssetPrefetcher& prefetcher = AssetPrefetcher::instance();
+	switch (stateID)
+	{
+	case 2://Store
+		prefetcher.prefetchTexture("healthpackicon.png", platform_);
+		prefetcher.prefetchTexture("on-sight.png", platform_);
+		prefetcher.prefetchTexture("hammer-nails.png", platform_);
+		prefetcher.prefetchTexture("sniper_icon_2.png", platform_);
+		prefetcher.prefetchTexture("assault_rifle_icon_1.png", platform_);
+		prefetcher.prefetchTexture("shotgun_icon_2.png", platform_);
+		prefetcher.prefetchTexture("SelectedWeaponSprite.png", platform_);
+		prefetcher.prefetchFile("purchasemade.wav");
+		prefetcher.prefetchFile("purchasefail.wav");
+		prefetcher.prefetchFile("StoreMusic.wav");
+		break;
+	case 3://Fail
+		prefetcher.prefetchTexture("failScreenBackground.png", platform_);
+		prefetcher.prefetchFile("DeathSfx.wav");
+		break;
+	case 4://Win
+		prefetcher.prefetchTexture("groundSprite.png", platform_);
+		prefetcher.prefetchFile("WinMusic.wav");
+		break;
+	default:
+		break;
+	}
+}
+
 gef::Mesh* SceneApp::getMeshFromSceneAssets(gef::Scene* scene)
 {
 	gef::Mesh* mesh = NULL;
@@ -1481,3 +2526,271 @@ bool SceneApp::RaySphereIntersect(gef::Vector4& startPoint, gef::Vector4& direct
 
 	return true;
 }
+
+void SceneApp::setBenchmarkMode(bool value)
+{
+	benchmarkMode = value;
+}
+
+void SceneApp::setResumeFile(const char* filename)
+{
+	resumeFilename = filename;
+}
+
+void SceneApp::setStartupCheckMode(bool value)
+{
+	startupCheckMode = value;
+}
+
+void SceneApp::setLargeWaveMode(bool value)
+{
+	largeWaveMode = value;
+}
+
+void SceneApp::setLaneMovement(bool value)
+{
+	laneMovement = value;
+}
+
+void SceneApp::setHeadless(bool value)
+{
+	headless = value;
+}
+
+bool SceneApp::loadInputScript(const char* filename)
+{
+	scriptedInput = inputScript.load(filename);
+	if (scriptedInput)
+	{
+		inputScript.setAimTarget([this](gef::Vector2& screenPosition) { return AimAtNearestEnemy(screenPosition); });
+		gef::DebugOut("InputScript: %u commands from %s\n", inputScript.getCommandCount(), filename);
+	}
+	return scriptedInput;
+}
+
+void SceneApp::setSoakFrames(unsigned int frames)
+{
+	soakFrames = frames;
+}
+
+//Enemies walk towards +x, so the one closest to the house has the largest x
+bool SceneApp::AimAtNearestEnemy(gef::Vector2& screenPosition)
+{
+	if (gameState != Level1 || enemies.empty())
+	{
+		return false;
+	}
+
+	EnemyObject* nearest = enemies[0];
+	for (unsigned int i = 1; i < enemies.size(); i++)
+	{
+		if (enemies[i]->getPosition().x > nearest->getPosition().x)
+		{
+			nearest = enemies[i];
+		}
+	}
+
+	//The reverse of GetScreenPosRay
+	b2Vec2 position = nearest->getPosition();
+	gef::Vector4 clip = gef::Vector4(position.x, position.y, 0.0f, 1.0f).TransformW(viewMatrix * projectionMatrix);
+	if (clip.w() <= 0.0f)
+	{
+		return false;
+	}
+
+	float hw = platform_.width() * 0.5f;
+	float hh = platform_.height() * 0.5f;
+	screenPosition.x = hw + (clip.x() / clip.w()) * hw;
+	screenPosition.y = hh - (clip.y() / clip.w()) * hh;
+	return true;
+}
+
+void SceneApp::WriteSoakResults(const char* filename)
+{
+	double elapsed = PerfRecorder::nowMilliseconds() - soakStartTime;
+	unsigned long long draws = soakStats.meshDraws + soakStats.spriteDraws + soakStats.textDraws;
+	gef::DebugOut("Soak: %u frames in %.1f ms, %u sessions, %u days cleared, highest day %u, %u wins, %u fails, %llu draws, frame p50 %llu ns p99 %llu ns max %llu ns\n",
+		soakFrames, elapsed, soakStats.sessions, soakStats.daysCleared, soakStats.highestDay, soakStats.wins, soakStats.fails, draws,
+		soakFrameTimes.percentile(0.5), soakFrameTimes.percentile(0.99), soakFrameTimes.maxNanoseconds);
+
+	FILE* file = fopen(filename, "w");
+	if (file == NULL)
+	{
+		gef::DebugOut("Soak: Could not write %s\n", filename);
+		return;
+	}
+	fprintf(file, "{\n  \"frames\": %u,\n  \"wall_ms\": %.3f,\n  \"sessions\": %u,\n  \"days_cleared\": %u,\n  \"highest_day\": %u,\n  \"wins\": %u,\n  \"fails\": %u,\n"
+		"  \"mesh_draws\": %llu,\n  \"sprite_draws\": %llu,\n  \"text_draws\": %llu,\n  \"draws_per_frame\": %.2f,\n"
+		"  \"frame_ns_p50\": %llu,\n  \"frame_ns_p99\": %llu,\n  \"frame_ns_p999\": %llu,\n  \"frame_ns_max\": %llu,\n  \"memory_peak_bytes\": {",
+		soakFrames, elapsed, soakStats.sessions, soakStats.daysCleared, soakStats.highestDay, soakStats.wins, soakStats.fails,
+		soakStats.meshDraws, soakStats.spriteDraws, soakStats.textDraws, soakFrames > 0 ? (double)draws / soakFrames : 0.0,
+		soakFrameTimes.percentile(0.5), soakFrameTimes.percentile(0.99), soakFrameTimes.percentile(0.999), soakFrameTimes.maxNanoseconds);
+	for (int i = 0; i < MEMORY_TAG_COUNT; i++)
+	{
+		fprintf(file, "%s\n    \"%s\": %llu", i == 0 ? "" : ",", MemoryTracker::getTagName((MemoryTag)i), (unsigned long long)MemoryTracker::instance().getPeakBytes((MemoryTag)i));
+	}
+	fprintf(file, "\n  },\n  \"over_budget\": %s\n}\n", MemoryTracker::instance().isOverBudget() ? "true" : "false");
+	fclose(file);
+}
+
+void SceneApp::BenchmarkInit()
+{
+	PerfRecorder::instance().reset();
+	PerfRecorder::instance().setEnabled(true);
+	playAudio = false;
+
+	//Day to day transitions, the same enemy counts a normal session uses
+	for (unsigned short int day = 1; day <= roundsToBeat; day++)
+	{
+		srand(benchmarkSeed);
+		roundCounter = day;
+		GameInit(EnemiesForDay(roundCounter));
+		GameRelease();
+	}
+
+	//End of day -> store -> next day, first rebuilding the game as it used to and then keeping it resident
+	srand(benchmarkSeed);
+	roundCounter = 1;
+	for (unsigned short int day = 1; day < roundsToBeat; day++)
+	{
+		GameInit(EnemiesForDay(roundCounter));
+		double startTime = PerfRecorder::nowMilliseconds();
+		GameRelease();
+		roundCounter += 1;
+		StoreInit();
+		StoreRelease();
+		GameInit(EnemiesForDay(roundCounter));
+		PerfRecorder::instance().addSample("RoundTrip/release_and_reload", PerfRecorder::nowMilliseconds() - startTime);
+		GameRelease();
+	}
+
+	roundCounter = 1;
+	GameInit(EnemiesForDay(roundCounter));
+	for (unsigned short int day = 1; day < roundsToBeat; day++)
+	{
+		double startTime = PerfRecorder::nowMilliseconds();
+		GameEndDay();
+		GameSuspend();
+		StoreInit();
+		StoreRelease();
+		GameResume();
+		GameStartDay(EnemiesForDay(roundCounter));
+		PerfRecorder::instance().addSample("RoundTrip/resident", PerfRecorder::nowMilliseconds() - startTime);
+	}
+	GameRelease();
+
+	//Snapshots of a heavy day, captured mid-round and restored in place, against building the same day with GameInit.
+	//The walk in is left out of the samples, it only gets bodies moving, queued and frozen.
+	srand(benchmarkSeed);
+	roundCounter = roundsToBeat;
+	{
+		PerfRecorder::instance().setEnabled(false);
+		double startTime = PerfRecorder::nowMilliseconds();
+		GameInit(benchmarkSnapshotEnemies);
+		double gameInitTime = PerfRecorder::nowMilliseconds() - startTime;
+		const float timeStep = 1.0f / 60.0f;
+		for (unsigned int frame = 0; frame < benchmarkFramesPerStage; frame++)
+		{
+			gameTime = gameTime + timeStep;
+			UpdateEnemies(timeStep);
+			UpdateSimulation(timeStep);
+		}
+		PerfRecorder::instance().setEnabled(true);
+		PerfRecorder::instance().addSample("Snapshot/game_init", gameInitTime);
+	}
+	for (unsigned int i = 0; i < benchmarkSnapshotRepeats; i++)
+	{
+		{
+			ScopedPerfTimer timer("Snapshot/capture");
+			CaptureSnapshot(snapshot, true);
+			snapshot.encode();
+		}
+		{
+			ScopedPerfTimer timer("Snapshot/restore");
+			RestoreSnapshot(snapshot);
+		}
+	}
+	GameRelease();
+
+	//Primitive meshes, built on first use and served from the builder's cache after, which outlives the game
+	{
+		ScopedPerfTimer timer("Primitives/first_use");
+		PB->GetDefaultCubeMesh();
+		PB->GetDefaultSphereMesh();
+	}
+	{
+		ScopedPerfTimer timer("Primitives/cached");
+		PB->GetDefaultCubeMesh();
+		PB->GetDefaultSphereMesh();
+	}
+
+	benchmarkStage = 0;
+	benchmarkFrame = 0;
+}
+
+bool SceneApp::BenchmarkUpdate(float frame_time)
+{
+	if (benchmarkStage >= benchmarkStageCount * benchmarkMovementModels)
+	{
+		PerfRecorder::instance().writeJSON("benchmark_results.json");
+		PerfRecorder::instance().setEnabled(false);
+		return false;
+	}
+
+	//Day transitions are measured in BenchmarkInit, so keep these set ups out of those samples
+	if (benchmarkFrame == 0)
+	{
+		srand(benchmarkSeed);
+		roundCounter = 1;
+		laneMovement = benchmarkStage >= benchmarkStageCount;
+		PerfRecorder::instance().setEnabled(false);
+		//Each stage is its own state so anything the last one left behind is reported
+		MemoryTracker::instance().enterState("Benchmark");
+		GameInit(benchmarkEnemyCounts[benchmarkStage % benchmarkStageCount]);
+		PerfRecorder::instance().setEnabled(true);
+		setState(Level1);
+	}
+
+	//Fixed time step so the simulation does the same work every run
+	const float timeStep = 1.0f / 60.0f;
+	gameTime = gameTime + timeStep;
+	{
+		ScopedPerfTimer timer(movementScenarios[laneMovement ? 1 : 0][EnemyCountBucket()]);
+		UpdateEnemies(timeStep);
+		UpdateSimulation(timeStep);
+	}
+
+	//Picking throughput, a spread of shots across the middle of the screen
+	{
+		ScopedPerfTimer timer(pickingScenarios[EnemyCountBucket()]);
+		pickRays.resize(benchmarkShotsPerFrame);
+		for (unsigned int shot = 0; shot < benchmarkShotsPerFrame; shot++)
+		{
+			gef::Vector2 screen_position(platform_.width() * (shot + 0.5f) / benchmarkShotsPerFrame, platform_.height() * 0.5f);
+			GetScreenPosRay(screen_position, projectionMatrix, viewMatrix, pickRays[shot].start, pickRays[shot].direction);
+		}
+		ShootEnemiesAlongRays(pickRays);
+	}
+
+	benchmarkFrame++;
+	if (benchmarkFrame > benchmarkFramesPerStage)
+	{
+		PerfRecorder::instance().setEnabled(false);
+		GameRelease();
+		PerfRecorder::instance().setEnabled(true);
+		benchmarkFrame = 0;
+		benchmarkStage++;
+	}
+
+	return true;
+}
+
+unsigned int SceneApp::EnemyCountBucket()
+{
+	unsigned int bucket = 0;
+	while (bucket < benchmarkStageCount && enemies.size() > (unsigned int)benchmarkEnemyCounts[bucket])
+	{
+		bucket++;
+	}
+	return bucket;
+}
@@ -3,6 +3,7 @@
 
 #include <system/application.h>
 #include <maths/vector2.h>
+#include <maths/matrix44.h>
 #include <graphics/mesh_instance.h>
 #include <input/input_manager.h>
 #include <box2d/Box2D.h>
@@ -11,6 +12,7 @@
 #include <graphics/sprite.h>
 #include "graphics/scene.h"
 #include <vector>
+#include <unordered_set>
 #include "EnemyObject.h"
 #include <math.h>
 #include "PlayerObject.h"
@@ -22,6 +24,28 @@
 #include "StoreWeaponItem.h"
 #include "primitive_builder.h"
 #include "MainMenuButton.h"
+#include "TimerScheduler.h"
+#include "PerfRecorder.h"
+#include "EnemyPool.h"
+#include "FrameBudget.h"
+#include "LaneMovementModel.h"
+#include "AssetPack.h"
+#include "SoftwareMixer.h"
+#include "MeshLOD.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "AssetPrefetcher.h"
+#include "InputQueue.h"
+#include "MemoryTracker.h"
+#include "LinearArena.h"
+#include "CollisionDispatch.h"
+#include "GameBalance.h"
+#include "GameRules.h"
+#include "Metrics.h"
+#include "GameSnapshot.h"
+#include "AudioCommands.h"
+#include "InputScript.h"
+#include "NanosecondHistogram.h"
 // FRAMEWORK FORWARD DECLARATIONS
 namespace gef
 {
@@ -43,18 +67,71 @@ public:
 	void CleanUp();
 	bool Update(float frame_time);
 	void Render();
+	//Runs the scripted benchmark scenarios instead of the game and writes benchmark_results.json
+	void setBenchmarkMode(bool value);
+	//Start in the game saved in filename, which must outlive Init. Falls back to the splash screen if it won't load.
+	void setResumeFile(const char* filename);
+	//Exit after the first frame, for timing start up
+	void setStartupCheckMode(bool value);
+	//Horde sized days, see largeWaveEnemiesPerDay
+	void setLargeWaveMode(bool value);
+	//Move enemies with LaneMovementModel instead of Box2D dynamics
+	void setLaneMovement(bool value);
+	//No sprite renderer, 3D renderer, font, input manager or audio manager is created. Draws are counted rather than made
+	//and audio goes to a NullAudioBackend, so the game runs on a platform with no devices.
+	void setHeadless(bool value);
+	//Play from a script instead of the input manager, see InputScript. False if it won't load.
+	bool loadInputScript(const char* filename);
+	//Stop after this many frames and write soak_results.json
+	void setSoakFrames(unsigned int frames);
 private:
 	//void InitPlayer();
-	void InitFont();
+	//Loads the font on first use
+	gef::Font* GetFont();
 	void CleanUpFont();
+	//Creates the 3D renderer and its lights the first time it is called
+	void CreateRenderer3D();
 	void DrawHUD();
+	//Sets the camera every state shares and hands it to the 3D renderer if there is one
+	void SetupCamera();
+	//Draw what is in the render queue, or only count it when headless
+	void Draw3D();
+	void DrawSprites(bool clear);
 	void SetupLights();
 	void UpdateSimulation(float frame_time);
+	//Contact responses, picked by CollisionDispatcher from the types of the two objects touching
+	struct ContactHandler
+	{
+		SceneApp& app;
+		void operator()(PlayerObject& player, b2Body* playerBody, EnemyObject& enemy, b2Body* enemyBody);
+		void operator()(WallObject& wall, b2Body* wallBody, EnemyObject& enemy, b2Body* enemyBody);
+		void operator()(EnemyObject& enemyA, b2Body* bodyA, EnemyObject& enemyB, b2Body* bodyB);
+	};
+	struct PendingFreeze
+	{
+		EnemyObject* enemy;
+		bool atHouse;
+	};
+	std::vector<PendingFreeze> pendingFreezes;
+	//Awake bodies and the islands the solver splits them into, counted after each step
+	void CountPhysicsIslands();
+	unsigned int physicsAwakeBodies = 0;
+	unsigned int physicsIslands = 0;
+	//Allocation count at the start of the last frame, for the per frame metric
+	unsigned long long lastFrameAllocations = 0;
+	std::unordered_set<b2Body*> islandVisited;
+	std::vector<b2Body*> islandStack;
     
 	gef::SpriteRenderer* sprite_renderer_;
 	gef::Font* font_;
 	gef::InputManager* input_manager_;
 	gef::AudioManager* audioManager;
+	//Play and stop go through the audio thread, loads and unloads are made directly after a flush
+	AudioCommandQueue audioCommands;
+	GefAudioBackend gefAudioBackend;
+	NullAudioBackend nullAudioBackend;
+	//One of the two above
+	AudioBackend* audio = NULL;
 
 	//Splash Declarations
 	gef::Texture* SplashBackground;
@@ -63,11 +140,21 @@ private:
 	//
 	gef::Renderer3D* renderer_3d_;
 	PrimitiveBuilder* PB;
+	//Picking uses these rather than the renderer's, which a headless run doesn't have
+	gef::Matrix44 projectionMatrix;
+	gef::Matrix44 viewMatrix;
+	gef::Vector4 cameraEye;
+	float cameraFov = 0.0f;
 	//Game State declarations
 	enum GAMESTATE{INIT, Level1, Store, Fail, Win, Splash};
 	GAMESTATE gameState = Splash;
+	std::vector<GAMESTATE> stateStack;
+	void setState(GAMESTATE state);
+	void pushState(GAMESTATE state);
+	void popState();
 	// create the physics world
 	b2World* world_;
+	b2World* storeWorld_ = NULL;
 
 	float fps_;
 
@@ -77,6 +164,21 @@ private:
 	void FrontendRender();
 
 	void GameInit(int enemiesToMake);
+	void GameStartDay(int enemiesToMake);
+	void GameEndDay();
+	void GameSuspend();
+	void GameResume();
+	void LoadGameAudio();
+	void ScheduleDayTimers(float dayTime);
+	void CreateStoreWeapons();
+	//Snapshots. A campaign only snapshot resumes at the start of the next day, with the day included it resumes mid-round.
+	void CaptureSnapshot(GameSnapshot& target, bool includeDay);
+	void RestoreSnapshot(const GameSnapshot& source);
+	void SaveCheckpoint();
+	void QuickSave();
+	//Reused so taking a snapshot doesn't allocate once it has grown to the wave
+	GameSnapshot snapshot;
+	const char* resumeFilename = NULL;
 	void GameRelease();
 	void GameUpdate(float frame_time);
 	void GameRender();
@@ -104,7 +206,7 @@ private:
 	//Global variables
 	bool playAudio = true;
 	bool audioStatusChanged = false;
-	unsigned short int roundsToBeat = 10;
+	unsigned short int roundsToBeat = defaultRoundsToBeat;
 
 	//Splash variables
 	unsigned short int splashSfx = 0;
@@ -115,36 +217,71 @@ private:
 	gef::Texture* backgroundSprite;
 	//Game Variables
 	unsigned short int roundCounter = 1;
-	float lastRfilemenAttackTime = 0.0f;
-	float lastRepairTime = 0.0f;
+	TimerScheduler gameTimers;
+	unsigned int reloadTimerID = 0;
 	gef::Texture* gameBackgroundSprite;
-	bool firstRun = true;
 	gef::Vector2 touchPosition;
-	Int32 activeTouchID = 0;
 	unsigned short int gunShotSampleID = 0;
+	const char* gunShotSfxPath = "";
 	unsigned short int backgroundSFXID = 0;
 	unsigned short int reloadSfx = 0;
+	VoiceLimiter sfxLimiter;
 	std::vector <EnemyObject*> enemies;
+	EnemyPool enemyPool;
+	//Player and wall live for the whole game and go in one reset at GameRelease
+	LinearArena gameArena{ 64 * 1024, MEMORY_TAG_ENTITIES };
+	unsigned int enemiesWithBodies = 0;
 	PlayerObject* Player;
 	WallObject* wallObject;
 	gef::Scene* enemySceneAsset;
+	MeshLODSet enemyLODs;
+	Frustum frustum;
+	RenderQueue renderQueue;
 	gef::Scene* playerSceneAsset;
 	gef::Scene* wallSceneAsset;
 	Weapon activeWeapon;
 	float gameTime;
 	PlayerData playerData;
-	//Used for 2D -> 3D projection
-	float ndc_z_min_;
+	//Used for 2D -> 3D projection. The near plane is at 0 in the D3D style projections gef makes.
+	float ndc_z_min_ = 0.0f;
 	//Game functions
+	InputQueue inputQueue;
+	InputScript inputScript;
+	bool scriptedInput = false;
+	std::vector<InputEvent> scriptedEvents;
+	//Screen position of the enemy closest to the house, for the script's aim commands
+	bool AimAtNearestEnemy(gef::Vector2& screenPosition);
 	void ProcessTouchInput();
+	void UpdateEnemies(float frame_time);
+	int EnemiesForDay(int day);
+	struct PickRay
+	{
+		gef::Vector4 start;
+		gef::Vector4 direction;
+	};
+	//This frame's shots and the touch event behind each one
+	std::vector<PickRay> pickRays;
+	std::vector<unsigned int> pickEventIndices;
+	void FireWeapon(std::vector<PickRay>& rays);
+	int ShootEnemiesAlongRays(std::vector<PickRay>& rays);
+	void RiflemenAttack();
+	void RepairGuysRepair();
+	void ReloadWeapon();
 	gef::Scene* LoadSceneAssets(gef::Platform& platform, const char* filename);
 	gef::Mesh* getMeshFromSceneAssets(gef::Scene* scene);
+	void SwitchAssetGroup(AssetGroup group);
+	//Start loading the textures and audio a state will need in the background
+	void PrefetchState(int stateID);
+	//One bit per state ID already prefetched this day
+	unsigned int prefetchedStates = 0;
+	unsigned int dayEnemyCount = 0;
 	void GetScreenPosRay(const gef::Vector2& screen_position, const gef::Matrix44& projection, const gef::Matrix44& view, gef::Vector4& startPoint, gef::Vector4& direction);
 	bool RaySphereIntersect(gef::Vector4& startPoint, gef::Vector4& direction, gef::Vector4& sphere_centre, float sphere_radius);
 
 	//Store Variables
 	std::vector<StoreItem*> storeItem;
 	std::vector<StoreWeaponItem*> storeWeapons;
+	Weapon handgun = Weapon();
 	Weapon sniper = Weapon();
 	Weapon assualtRifle = Weapon();
 	Weapon shotgun = Weapon();
@@ -160,6 +297,49 @@ private:
 	gef::Texture* winBackgroundSprite;
 	// Global Functions
 	void updateStateMachine(int newID, int oldID);
+
+	//Large wave variables
+	bool largeWaveMode = false;
+	//Enemies per metre of spawn line, spread over the five lanes
+	float largeWaveSpawnDensity = 20.0f;
+	//Enemies walk without a physics body until they reach this x or the back of their lane's queue
+	float largeWaveActivationX = 0.0f;
+	FrameBudget frameBudget;
+
+	//Enemy movement, Box2D bodies by default or the lane queue model for comparison
+	bool laneMovement = false;
+	LaneMovementModel laneModel;
+
+	//Headless and soak variables
+	bool headless = false;
+	unsigned int frameCount = 0;
+	unsigned int soakFrames = 0;
+	double soakStartTime = 0.0;
+	double lastFrameStartTime = 0.0;
+	//Wall time of each frame, not the fixed step the platform reports
+	NanosecondHistogram soakFrameTimes;
+	struct SoakStats
+	{
+		unsigned int sessions = 0;
+		unsigned int daysCleared = 0;
+		unsigned int highestDay = 0;
+		unsigned int wins = 0;
+		unsigned int fails = 0;
+		unsigned long long meshDraws = 0;
+		unsigned long long spriteDraws = 0;
+		unsigned long long textDraws = 0;
+	};
+	SoakStats soakStats;
+	void WriteSoakResults(const char* filename);
+
+	//Benchmark variables
+	bool benchmarkMode = false;
+	bool startupCheckMode = false;
+	unsigned int benchmarkStage = 0;
+	unsigned int benchmarkFrame = 0;
+	void BenchmarkInit();
+	bool BenchmarkUpdate(float frame_time);
+	unsigned int EnemyCountBucket();
 };
 
 #endif // _SCENE_APP_H
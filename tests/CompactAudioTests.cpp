@@ -0,0 +1,138 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "CompactAudio.h"
+
+static const char* wavFilename = "compact_audio_tests.wav";
+static const char* compactFilename = "compact_audio_tests.adp";
+static const char* corruptFilename = "compact_audio_tests_corrupt.adp";
+//Not a whole number of blocks, so the last block is short
+static const UInt32 testFrames = 2500;
+
+static bool check(bool condition, const char* what)
+{
+	if (condition == false)
+	{
+		printf("FAILED: %s\n", what);
+	}
+	return condition;
+}
+
+static void writeValue(FILE* file, UInt32 value, size_t bytes)
+{
+	fwrite(&value, bytes, 1, file);
+}
+
+//A mono 16-bit WAV of a ramp
+static bool writeWav()
+{
+	FILE* file = fopen(wavFilename, "wb");
+	if (file == NULL)
+		return false;
+
+	UInt32 dataBytes = testFrames * sizeof(Int16);
+	fwrite("RIFF", 1, 4, file);
+	writeValue(file, 36 + dataBytes, 4);
+	fwrite("WAVEfmt ", 1, 8, file);
+	writeValue(file, 16, 4);
+	writeValue(file, 1, 2);
+	writeValue(file, 1, 2);
+	writeValue(file, 22050, 4);
+	writeValue(file, 22050 * sizeof(Int16), 4);
+	writeValue(file, sizeof(Int16), 2);
+	writeValue(file, 16, 2);
+	fwrite("data", 1, 4, file);
+	writeValue(file, dataBytes, 4);
+	for (UInt32 i = 0; i < testFrames; i++)
+	{
+		writeValue(file, (UInt32)(Int16)((i * 37) % 20000 - 10000), 2);
+	}
+	fclose(file);
+	return true;
+}
+
+static bool readFile(const char* filename, std::vector<UInt8>& bytes)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	bytes.resize((size_t)ftell(file));
+	fseek(file, 0, SEEK_SET);
+	bool success = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	fclose(file);
+	return success;
+}
+
+//Writes the good file with its header changed and payloadBytes of payload, and checks it won't load
+static bool rejects(const std::vector<UInt8>& good, const CompactAudioHeader& header, size_t payloadBytes, const char* what)
+{
+	FILE* file = fopen(corruptFilename, "wb");
+	if (file == NULL)
+		return check(false, "could not write the corrupt file");
+
+	fwrite(&header, sizeof(header), 1, file);
+	std::vector<UInt8> payload(good.begin() + sizeof(header), good.end());
+	payload.resize(payloadBytes, 0);
+	fwrite(payload.data(), 1, payload.size(), file);
+	fclose(file);
+
+	CompactSound sound;
+	return check(sound.load(corruptFilename) == false && sound.isLoaded() == false, what);
+}
+
+int main()
+{
+	bool passed = check(writeWav() && ConvertWavToCompact(wavFilename, compactFilename), "converting the test WAV");
+
+	std::vector<UInt8> good;
+	passed &= check(readFile(compactFilename, good) && good.size() > sizeof(CompactAudioHeader), "reading the converted file");
+	if (passed == false)
+	{
+		printf("CompactAudioTests: FAILED\n");
+		return 1;
+	}
+
+	CompactSound sound;
+	passed &= check(sound.load(compactFilename), "a converted file loads");
+	std::vector<Int16> samples;
+	sound.decodeAll(samples);
+	passed &= check(samples.size() == testFrames, "decodeAll gives every frame");
+
+	CompactAudioHeader header;
+	memcpy(&header, good.data(), sizeof(header));
+	size_t payloadBytes = good.size() - sizeof(header);
+
+	CompactAudioHeader corrupt = header;
+	corrupt.frameCount = header.blockCount * header.blockFrames + 1;
+	passed &= rejects(good, corrupt, payloadBytes, "frameCount past the last block");
+
+	corrupt = header;
+	corrupt.frameCount = (header.blockCount - 1) * header.blockFrames;
+	passed &= rejects(good, corrupt, payloadBytes, "frameCount that leaves the last block empty");
+
+	corrupt = header;
+	corrupt.blockCount = header.blockCount + 1;
+	passed &= rejects(good, corrupt, payloadBytes, "more blocks than the payload holds");
+
+	passed &= rejects(good, header, payloadBytes - 1, "truncated payload");
+	passed &= rejects(good, header, payloadBytes + 1, "payload longer than its blocks");
+
+	//blockCount * blockBytes wraps to a small number in 32 bits
+	corrupt = header;
+	corrupt.blockFrames = 0x80000000u;
+	corrupt.blockCount = 0x80000000u;
+	corrupt.frameCount = 0xffffffffu;
+	passed &= rejects(good, corrupt, payloadBytes, "block sizes that overflow");
+
+	corrupt = header;
+	corrupt.blockFrames = header.blockFrames + 1;
+	passed &= rejects(good, corrupt, payloadBytes, "odd blockFrames");
+
+	remove(wavFilename);
+	remove(compactFilename);
+	remove(corruptFilename);
+	printf("CompactAudioTests: %s\n", passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include <cstdio>
+#include "SoftwareMixer.h"
+
+//The caps SceneApp::LoadGameAudio sets
+static const Int32 gunShotID = 0;
+static const Int32 reloadID = 1;
+static const unsigned int gunShotVoiceCap = 4;
+static const float gunShotVoiceHold = 1.0f;
+static const float frameTime = 1.0f / 60.0f;
+
+static bool check(bool condition, const char* what)
+{
+	if (condition == false)
+	{
+		printf("FAILED: %s\n", what);
+	}
+	return condition;
+}
+
+//A day of firing every frame and reloading every two seconds, on a clock that starts at 0 like gameTime
+static void playDay(VoiceLimiter& limiter, float dayLength, bool newDay)
+{
+	if (newDay)
+	{
+		limiter.forgetVoices();
+	}
+	float lastReload = 0.0f;
+	for (float time = 0.0f; time < dayLength; time += frameTime)
+	{
+		limiter.beginFrame(time);
+		limiter.allow(gunShotID);
+		if (time - lastReload >= 2.0f)
+		{
+			limiter.allow(reloadID);
+			lastReload = time;
+		}
+	}
+}
+
+static void setCaps(VoiceLimiter& limiter)
+{
+	limiter.clear();
+	limiter.setVoiceCap(gunShotID, gunShotVoiceCap, gunShotVoiceHold);
+	limiter.setVoiceCap(reloadID, 1, 0.0f);
+}
+
+//Shots and the reload are allowed on the first frame of day two
+static bool secondDayStartsUnmuted(bool forgetVoices)
+{
+	VoiceLimiter limiter;
+	setCaps(limiter);
+	playDay(limiter, 30.0f, false);
+	playDay(limiter, 0.0f, forgetVoices);
+
+	bool passed = true;
+	limiter.beginFrame(0.0f);
+	passed &= check(limiter.allow(gunShotID), "gunshot allowed at the start of day two");
+	passed &= check(limiter.allow(reloadID), "reload allowed at the start of day two");
+	return passed;
+}
+
+//Forgetting voices keeps the caps, so day two still stops at four overlapping shots
+static bool capsSurviveNewDay()
+{
+	VoiceLimiter limiter;
+	setCaps(limiter);
+	playDay(limiter, 30.0f, false);
+	limiter.forgetVoices();
+
+	unsigned int allowed = 0;
+	for (unsigned int i = 0; i < gunShotVoiceCap + 2; i++)
+	{
+		limiter.beginFrame(i * frameTime);
+		if (limiter.allow(gunShotID))
+		{
+			allowed++;
+		}
+	}
+	return check(allowed == gunShotVoiceCap, "day two gunshots still capped");
+}
+
+int main()
+{
+	bool passed = true;
+	passed &= secondDayStartsUnmuted(true);
+	//A reset clock alone mustn't leave voices stuck, in case a caller forgets to call forgetVoices
+	passed &= secondDayStartsUnmuted(false);
+	passed &= capsSurviveNewDay();
+	printf("VoiceLimiterTests: %s\n", passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}